@@ -141,10 +141,12 @@ void print_ast(AST *node, int indent) {
 /**
  * Creates a new abstract syntax tree node.
  *
- * This function allocates memory for a new abstract syntax tree node and
- * initializes it with the given type, left and right children, value, and
- * source location.
+ * This function allocates memory for a new abstract syntax tree node from
+ * the given arena and initializes it with the given type, left and right
+ * children, value, and source location. The node lives until the arena is
+ * released.
  *
+ * @param arena The arena to allocate the node from.
  * @param type The type of the new node.
  * @param left The left child of the new node.
  * @param right The right child of the new node.
@@ -153,8 +155,8 @@ void print_ast(AST *node, int indent) {
  *
  * @return A pointer to the newly allocated abstract syntax tree node.
  */
-AST *create_ast_node(ASTNodeType type, AST *left, AST *right, ASTValue value, bool val_is_ast, SrcLoc srcloc) {
-    AST *node = apexMem_alloc(sizeof(AST));
+AST *create_ast_node(ApexArena *arena, ASTNodeType type, AST *left, AST *right, ASTValue value, bool val_is_ast, SrcLoc srcloc) {
+    AST *node = apexMem_arenaalloc(arena, sizeof(AST));
     node->type = type;
     node->left = left;
     node->right = right;
@@ -162,22 +164,23 @@ AST *create_ast_node(ASTNodeType type, AST *left, AST *right, ASTValue value, bo
     node->next = NULL;
     node->val_is_ast = val_is_ast;
     node->srcloc = srcloc;
+    node->value_type = AST_TYPE_UNKNOWN;
     return node;
 }
 
 /**
  * Creates an error abstract syntax tree node.
  *
- * This function allocates memory for an AST node and initializes it
- * as an error node with the given source location. The node has no
- * children and has a default value of zero.
+ * This function allocates memory for an AST node from the given arena and
+ * initializes it as an error node. The node has no children and has a
+ * default value of zero.
  *
- * @param srcloc The source location to associate with the error node.
+ * @param arena The arena to allocate the node from.
  * @return A pointer to the newly allocated error AST node.
  */
 
-AST *create_error_ast(void) {
-    AST *node = apexMem_alloc(sizeof(AST));
+AST *create_error_ast(ApexArena *arena) {
+    AST *node = apexMem_arenaalloc(arena, sizeof(AST));
     node->type = AST_ERROR;
     node->left = NULL;
     node->right = NULL;
@@ -186,6 +189,7 @@ AST *create_error_ast(void) {
     node->srcloc.lineno = 0;
     node->val_is_ast = false;
     node->value = ast_value_zero();
+    node->value_type = AST_TYPE_UNKNOWN;
     return node;
 }
 
@@ -228,24 +232,3 @@ ASTValue ast_value_ast(AST *ast) {
     value.ast_node = ast;
     return value;
 }
-
-/**
- * Frees an abstract syntax tree node and all its children.
- *
- * This function recursively calls itself on the left and right children of
- * the given node, and then frees the given node itself.
- *
- * @param node The abstract syntax tree node to be freed. If NULL, this
- *             function does nothing.
- */
-void free_ast(AST *node) {
-    if (node) {
-        free_ast(node->left);
-        free_ast(node->right);
-        free_ast(node->next);
-        if (node->val_is_ast) {
-            free_ast(node->value.ast_node);
-        }
-        free(node);
-    }
-}
@@ -76,6 +76,15 @@ typedef enum {
     AST_DEFAULT              /** AST default */
 } ASTNodeType;
 
+/**
+ * Enumerates the value types that type inference can prove for a node.
+ */
+typedef enum {
+    AST_TYPE_UNKNOWN,        /** Type not proven */
+    AST_TYPE_INT,            /** Always an int */
+    AST_TYPE_DBL             /** Always a dbl */
+} ASTValueType;
+
 /**
  * Union that can hold either a string or an abstract syntax tree node.
  *
@@ -125,6 +134,10 @@ typedef struct AST {
      * Source location of the node.
      */
     SrcLoc srcloc;
+    /**
+     * Type of the node's value, as proven by type inference.
+     */
+    ASTValueType value_type;
     /**
      * Flag that indicates whether the value is an abstract syntax tree node
      * or a string.
@@ -132,17 +145,16 @@ typedef struct AST {
     bool val_is_ast;
 } AST;
 
-#define CREATE_AST_STR(type, left, right, value, srcloc) create_ast_node(type, left, right, ast_value_str(value), false, srcloc)
-#define CREATE_AST_AST(type, left, right, value, srcloc) create_ast_node(type, left, right, ast_value_ast(value), true, srcloc)
-#define CREATE_AST_ZERO(type, left, right, srcloc) create_ast_node(type, left, right, ast_value_zero(), false, srcloc)
+#define CREATE_AST_STR(arena, type, left, right, value, srcloc) create_ast_node(arena, type, left, right, ast_value_str(value), false, srcloc)
+#define CREATE_AST_AST(arena, type, left, right, value, srcloc) create_ast_node(arena, type, left, right, ast_value_ast(value), true, srcloc)
+#define CREATE_AST_ZERO(arena, type, left, right, srcloc) create_ast_node(arena, type, left, right, ast_value_zero(), false, srcloc)
 
 extern void print_ast(AST *node, int indent);
-extern AST *create_ast_node(ASTNodeType type, AST *left, AST *right, ASTValue value, bool val_is_ast, SrcLoc srcloc);
-extern AST *create_error_ast(void);
+extern AST *create_ast_node(ApexArena *arena, ASTNodeType type, AST *left, AST *right, ASTValue value, bool val_is_ast, SrcLoc srcloc);
+extern AST *create_error_ast(ApexArena *arena);
 extern ASTValue ast_value_zero(void);
 extern ASTValue ast_value_str(ApexString *str);
 extern ASTValue ast_value_ast(AST *ast);
-extern void free_ast(AST *node);
 extern void print_ast(AST *node, int indent);
 
 #endif
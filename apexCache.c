@@ -0,0 +1,852 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "apexCache.h"
+#include "apexMem.h"
+#include "apexStr.h"
+#include "apexSym.h"
+#include "apexUtil.h"
+#include "apexVal.h"
+
+/*
+ * A cache file holds the compiled program of a script so that later runs can
+ * skip lexing, parsing and compiling it. It is laid out as a header followed
+ * by these sections, each aligned to 8 bytes:
+ *
+ *   sources   one CacheSource per module the program was compiled from
+ *   strings   one CacheString per constant, pointing into the string bytes
+ *   fns       one CacheFn per function
+ *   params    the string indices of the function parameters
+ *   globals   the globals defined at compile time, as CacheGlobal records
+ *   ins       one CacheIns per instruction, including its source line
+ *   bytes     the NUL-terminated string constants
+ *
+ * A program with an include that was resolved against the working directory
+ * also records that directory, since running it elsewhere may include
+ * other files. The header records which optimising passes the program was
+ * compiled with, so that switching one off or on compiles it again.
+ *
+ * All references between sections are indices, so the file is position
+ * independent and can be used straight from a read-only mapping. Loading it
+ * interns the string constants and rebuilds the instructions around them.
+ *
+ * A missing or stale cache is not an error, so the functions below restore
+ * errno before returning, since errors reported later would include it.
+ *
+ * CACHE_VERSION must be bumped whenever the layout or the meaning of a
+ * record changes. Adding or removing an opcode invalidates existing caches
+ * on its own, since the header records the number of opcodes.
+ */
+
+#define CACHE_MAGIC "APXC"
+#define CACHE_VERSION 2
+#define CACHE_ENDIAN 0x01020304
+#define CACHE_NONE UINT32_MAX
+#define CACHE_SUFFIX ".apxc"
+
+#define cache_align(n) (((n) + 7) & ~(size_t)7)
+
+/**
+ * The header of a cache file.
+ */
+typedef struct {
+    char magic[4]; /** CACHE_MAGIC */
+    uint32_t version; /** CACHE_VERSION */
+    uint32_t endian; /** CACHE_ENDIAN, as written by the host */
+    uint32_t opcode_count; /** The number of opcodes known to the writer */
+    uint32_t codegen; /** The APEX_CODEGEN_* flags the program was compiled with */
+    uint32_t source_count; /** The number of source records */
+    uint32_t string_count; /** The number of string records */
+    uint32_t string_bytes; /** The size of the string bytes section */
+    uint32_t fn_count; /** The number of function records */
+    uint32_t param_count; /** The number of parameter entries */
+    uint32_t global_count; /** The number of global records */
+    uint32_t ins_count; /** The number of instruction records */
+    uint32_t cwd; /** String index of the working directory, or CACHE_NONE */
+} CacheHeader;
+
+/**
+ * Identifies the version of a source file the program was compiled from.
+ */
+typedef struct {
+    uint32_t path; /** String index of the file's path */
+    uint32_t hash; /** Hash of the file's contents */
+    int64_t size; /** Size of the file in bytes */
+    int64_t mtime_sec; /** Modification time, seconds */
+    int64_t mtime_nsec; /** Modification time, nanoseconds */
+} CacheSource;
+
+/**
+ * Locates a string constant in the string bytes section.
+ */
+typedef struct {
+    uint32_t offset; /** Offset of the first byte */
+    uint32_t len; /** Length, excluding the NUL-terminator */
+} CacheString;
+
+/**
+ * Describes a function.
+ */
+typedef struct {
+    uint32_t name; /** String index of the name */
+    uint32_t params; /** Index of the first parameter in the params section */
+    int32_t argc; /** The number of parameters */
+    int32_t addr; /** The address of the function */
+    uint32_t have_variadic; /** Whether the last parameter is variadic */
+} CacheFn;
+
+/**
+ * Kinds of globals defined at compile time.
+ */
+typedef enum {
+    CACHE_GLOBAL_FN, /** A function */
+    CACHE_GLOBAL_TYPE, /** An object type */
+    CACHE_GLOBAL_METHOD /** A method of the preceding object type */
+} CacheGlobalKind;
+
+/**
+ * Describes a global defined at compile time.
+ */
+typedef struct {
+    uint32_t kind; /** The CacheGlobalKind of the global */
+    uint32_t name; /** String index of the global or method name */
+    uint32_t fn; /** Function index of a function or method */
+} CacheGlobal;
+
+/**
+ * Describes an instruction.
+ */
+typedef struct {
+    uint32_t opcode; /** The opcode */
+    uint32_t type; /** The ApexValueType of the value */
+    uint32_t file; /** String index of the source file, or CACHE_NONE */
+    int32_t lineno; /** The source line */
+    union {
+        int64_t intval; /** Integer and boolean values */
+        double dblval; /** Double values */
+        uint32_t index; /** String or function index */
+    } value; /** The value of the instruction */
+} CacheIns;
+
+/**
+ * Offsets of the sections of a cache file.
+ */
+typedef struct {
+    size_t sources, strings, fns, params, globals, ins, bytes, end;
+} CacheLayout;
+
+/**
+ * Collects the records of a cache file while it is being written.
+ */
+typedef struct {
+    ApexArray *string_index; /** Maps interned strings to their index */
+    ApexString **strings; /** The string constants */
+    int string_count, string_size;
+    size_t string_bytes; /** The size of the string bytes section */
+    ApexFn **fns; /** The functions */
+    int fn_count, fn_size;
+    uint32_t *params; /** The parameter names of the functions */
+    int param_count, param_size;
+    CacheGlobal *globals; /** The globals */
+    int global_count, global_size;
+} CacheWriter;
+
+/**
+ * Grows a writer array so that it can hold one more element.
+ */
+#define writer_reserve(array, count, size) do {                         \
+    if ((count) == (size)) {                                            \
+        (size) = (size) ? (size) * 2 : 16;                              \
+        (array) = apexMem_realloc((array), sizeof(*(array)) * (size));  \
+    }                                                                   \
+} while (0)
+
+/**
+ * Computes the offsets of the sections described by a header.
+ *
+ * @param header The header of the cache file.
+ * @param layout Receives the section offsets.
+ */
+static void cache_layout(const CacheHeader *header, CacheLayout *layout) {
+    layout->sources = cache_align(sizeof(CacheHeader));
+    layout->strings = cache_align(layout->sources + sizeof(CacheSource) * (size_t)header->source_count);
+    layout->fns = cache_align(layout->strings + sizeof(CacheString) * (size_t)header->string_count);
+    layout->params = cache_align(layout->fns + sizeof(CacheFn) * (size_t)header->fn_count);
+    layout->globals = cache_align(layout->params + sizeof(uint32_t) * (size_t)header->param_count);
+    layout->ins = cache_align(layout->globals + sizeof(CacheGlobal) * (size_t)header->global_count);
+    layout->bytes = layout->ins + sizeof(CacheIns) * (size_t)header->ins_count;
+    layout->end = layout->bytes + header->string_bytes;
+}
+
+/**
+ * Maps a file read-only into memory.
+ *
+ * @param path The path of the file.
+ * @param size Receives the size of the file.
+ * @return The mapping, or NULL if the file cannot be mapped or is empty.
+ */
+static const char *map_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return data;
+}
+
+/**
+ * Hashes the contents of a file.
+ *
+ * @param hash Receives the hash.
+ * @param path The path of the file.
+ * @param size The size of the file.
+ * @return true if the file could be read, false otherwise.
+ */
+static bool hash_file(uint32_t *hash, const char *path, int64_t size) {
+    if (size == 0) {
+        *hash = apexUtil_hashbytes("", 0);
+        return true;
+    }
+    size_t len;
+    const char *data = map_file(path, &len);
+    if (!data) {
+        return false;
+    }
+    *hash = apexUtil_hashbytes(data, len);
+    munmap((void *)data, len);
+    return true;
+}
+
+/**
+ * Records the size, modification time and hash of a source file.
+ *
+ * @param source The record to fill in, apart from its path.
+ * @param path The path of the file.
+ * @return true if the file could be read, false otherwise.
+ */
+static bool stamp_source(CacheSource *source, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    source->size = st.st_size;
+    source->mtime_sec = st.st_mtim.tv_sec;
+    source->mtime_nsec = st.st_mtim.tv_nsec;
+    return hash_file(&source->hash, path, source->size);
+}
+
+/**
+ * Checks whether a source file is unchanged since it was stamped.
+ *
+ * A file whose size differs has changed. A file with the same size and
+ * modification time is taken to be unchanged; if only the modification time
+ * differs, as after a checkout, the contents are hashed to decide.
+ *
+ * @param source The stamp of the file.
+ * @param path The path of the file.
+ * @return true if the file is unchanged, false otherwise.
+ */
+static bool source_fresh(const CacheSource *source, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size != source->size) {
+        return false;
+    }
+    if (st.st_mtim.tv_sec == source->mtime_sec && st.st_mtim.tv_nsec == source->mtime_nsec) {
+        return true;
+    }
+    uint32_t hash;
+    return hash_file(&hash, path, st.st_size) && hash == source->hash;
+}
+
+/**
+ * Returns the path of the cache file of a script.
+ *
+ * The cache is written next to the script, replacing a ".apx" extension
+ * with ".apxc" or appending ".apxc" otherwise. If the APEX_CACHE_DIR
+ * environment variable is set, the cache is written to that directory
+ * instead, named after the script's absolute path with slashes replaced by
+ * '%'. Setting APEX_CACHE to 0 disables the cache.
+ *
+ * @param script The path of the script.
+ * @return A newly allocated path, or NULL if the cache is disabled or the
+ *         script is not a regular file.
+ */
+char *apexCache_path(const char *script) {
+    int saved_errno = errno;
+    const char *enabled = getenv("APEX_CACHE");
+    if (enabled && strcmp(enabled, "0") == 0) {
+        return NULL;
+    }
+
+    // Scripts read from pipes or devices have no stable contents to cache.
+    struct stat st;
+    if (stat(script, &st) != 0 || !S_ISREG(st.st_mode)) {
+        errno = saved_errno;
+        return NULL;
+    }
+
+    const char *dir = getenv("APEX_CACHE_DIR");
+    char *real = NULL;
+    size_t dir_len = 0;
+    if (dir && *dir) {
+        real = realpath(script, NULL);
+        if (!real) {
+            errno = saved_errno;
+            return NULL;
+        }
+        script = real;
+        dir_len = strlen(dir) + 1;
+    }
+
+    size_t len = strlen(script);
+    if (len >= 4 && strcmp(script + len - 4, ".apx") == 0) {
+        len -= 4;
+    }
+    char *path = apexMem_alloc(dir_len + len + sizeof(CACHE_SUFFIX));
+    if (dir_len) {
+        memcpy(path, dir, dir_len - 1);
+        path[dir_len - 1] = '/';
+        for (size_t i = 0; i < len; i++) {
+            path[dir_len + i] = script[i] == '/' ? '%' : script[i];
+        }
+    } else {
+        memcpy(path, script, len);
+    }
+    memcpy(path + dir_len + len, CACHE_SUFFIX, sizeof(CACHE_SUFFIX));
+    free(real);
+    errno = saved_errno;
+    return path;
+}
+
+/**
+ * Checks that every index in a cache image refers to an existing record.
+ *
+ * @param header The header of the image.
+ * @param layout The section offsets of the image.
+ * @param data The image.
+ * @return true if the image is well-formed, false otherwise.
+ */
+static bool check_image(const CacheHeader *header, const CacheLayout *layout, const char *data) {
+    const CacheString *strings = (const CacheString *)(data + layout->strings);
+    const char *bytes = data + layout->bytes;
+    for (uint32_t i = 0; i < header->string_count; i++) {
+        if ((uint64_t)strings[i].offset + strings[i].len >= header->string_bytes ||
+            bytes[strings[i].offset + strings[i].len] != '\0') {
+            return false;
+        }
+    }
+
+    const CacheSource *sources = (const CacheSource *)(data + layout->sources);
+    for (uint32_t i = 0; i < header->source_count; i++) {
+        if (sources[i].path >= header->string_count) {
+            return false;
+        }
+    }
+    if (header->cwd != CACHE_NONE && header->cwd >= header->string_count) {
+        return false;
+    }
+
+    const CacheFn *fns = (const CacheFn *)(data + layout->fns);
+    for (uint32_t i = 0; i < header->fn_count; i++) {
+        if (fns[i].name >= header->string_count || fns[i].argc < 0 ||
+            (uint64_t)fns[i].params + (uint32_t)fns[i].argc > header->param_count ||
+            fns[i].addr < 0 || (uint32_t)fns[i].addr > header->ins_count) {
+            return false;
+        }
+    }
+
+    const uint32_t *params = (const uint32_t *)(data + layout->params);
+    for (uint32_t i = 0; i < header->param_count; i++) {
+        if (params[i] >= header->string_count) {
+            return false;
+        }
+    }
+
+    const CacheGlobal *globals = (const CacheGlobal *)(data + layout->globals);
+    bool have_type = false;
+    for (uint32_t i = 0; i < header->global_count; i++) {
+        if (globals[i].name >= header->string_count) {
+            return false;
+        }
+        switch (globals[i].kind) {
+        case CACHE_GLOBAL_TYPE:
+            have_type = true;
+            break;
+        case CACHE_GLOBAL_METHOD:
+            if (!have_type) {
+                return false;
+            }
+            /* fall through */
+        case CACHE_GLOBAL_FN:
+            if (globals[i].fn >= header->fn_count) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    const CacheIns *ins = (const CacheIns *)(data + layout->ins);
+    for (uint32_t i = 0; i < header->ins_count; i++) {
+        if (ins[i].opcode >= header->opcode_count ||
+            (ins[i].file != CACHE_NONE && ins[i].file >= header->string_count)) {
+            return false;
+        }
+        switch (ins[i].type) {
+        case APEX_VAL_INT:
+        case APEX_VAL_DBL:
+        case APEX_VAL_BOOL:
+        case APEX_VAL_NULL:
+            break;
+        case APEX_VAL_STR:
+            if (ins[i].value.index >= header->string_count) {
+                return false;
+            }
+            break;
+        case APEX_VAL_FN:
+            if (ins[i].value.index >= header->fn_count) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Loads the program in a validated cache image into the virtual machine.
+ *
+ * The string constants are interned first; every other reference to a
+ * string is then resolved through its index. The functions, the globals
+ * defined at compile time and the instructions are rebuilt in that order.
+ *
+ * @param vm The virtual machine to load the program into.
+ * @param header The header of the image.
+ * @param layout The section offsets of the image.
+ * @param data The image.
+ */
+static void load_image(ApexVM *vm, const CacheHeader *header, const CacheLayout *layout, const char *data) {
+    const CacheString *cstrings = (const CacheString *)(data + layout->strings);
+    const char *bytes = data + layout->bytes;
+    ApexString **strings = apexMem_alloc(sizeof(ApexString *) * (header->string_count + 1));
+    for (uint32_t i = 0; i < header->string_count; i++) {
+        strings[i] = apexStr_new(bytes + cstrings[i].offset, cstrings[i].len);
+    }
+
+    const CacheFn *cfns = (const CacheFn *)(data + layout->fns);
+    const uint32_t *cparams = (const uint32_t *)(data + layout->params);
+    ApexFn **fns = apexMem_alloc(sizeof(ApexFn *) * (header->fn_count + 1));
+    for (uint32_t i = 0; i < header->fn_count; i++) {
+        const CacheFn *cfn = &cfns[i];
+        char **params = apexMem_alloc(sizeof(char *) * (cfn->argc + 1));
+        for (int j = 0; j < cfn->argc; j++) {
+            params[j] = strings[cparams[cfn->params + j]]->value;
+        }
+        fns[i] = apexVal_newfn(
+            strings[cfn->name]->value, params, cfn->argc, cfn->have_variadic, cfn->addr);
+    }
+
+    const CacheGlobal *globals = (const CacheGlobal *)(data + layout->globals);
+    ApexObject *type = NULL;
+    for (uint32_t i = 0; i < header->global_count; i++) {
+        const char *name = strings[globals[i].name]->value;
+        switch (globals[i].kind) {
+        case CACHE_GLOBAL_FN:
+            apexSym_setglobal(&vm->global_table, name, apexVal_makefn(fns[globals[i].fn]));
+            break;
+        case CACHE_GLOBAL_TYPE:
+            type = apexVal_newobject(name);
+            apexSym_setglobal(&vm->global_table, name, apexVal_maketype(type));
+            break;
+        case CACHE_GLOBAL_METHOD:
+            apexVal_objectset(type, name, apexVal_makefn(fns[globals[i].fn]));
+            break;
+        }
+    }
+
+    Chunk *chunk = vm->chunk;
+    if (chunk->ins_size < (int)header->ins_count + 1) {
+        chunk->ins_size = header->ins_count + 1;
+        chunk->ins = apexMem_realloc(chunk->ins, sizeof(Ins) * chunk->ins_size);
+    }
+    const CacheIns *cins = (const CacheIns *)(data + layout->ins);
+    for (uint32_t i = 0; i < header->ins_count; i++) {
+        Ins *ins = &chunk->ins[i];
+        ins->opcode = (OpCode)cins[i].opcode;
+        ins->srcloc.lineno = cins[i].lineno;
+        ins->srcloc.filename = cins[i].file == CACHE_NONE ? NULL : strings[cins[i].file]->value;
+        switch (cins[i].type) {
+        case APEX_VAL_INT:
+            ins->value = apexVal_makeint((int)cins[i].value.intval);
+            break;
+        case APEX_VAL_DBL:
+            ins->value = apexVal_makedbl(cins[i].value.dblval);
+            break;
+        case APEX_VAL_BOOL:
+            ins->value = apexVal_makebool(cins[i].value.intval != 0);
+            break;
+        case APEX_VAL_STR:
+            ins->value = apexVal_makestr(strings[cins[i].value.index]);
+            break;
+        case APEX_VAL_FN:
+            // The instruction keeps the function alive once no global
+            // holds it.
+            ins->value = apexVal_makefn(fns[cins[i].value.index]);
+            apexVal_retain(ins->value);
+            break;
+        default:
+            ins->value = apexVal_makenull();
+            break;
+        }
+    }
+    chunk->ins_count = header->ins_count;
+    if (chunk->ins_count) {
+        // Leave the VM where compiling the program would have left it.
+        vm->srcloc = chunk->ins[chunk->ins_count - 1].srcloc;
+    }
+
+    free(fns);
+    free(strings);
+}
+
+/**
+ * Loads a program from its cache file.
+ *
+ * The cache file is mapped read-only and used only if it was written by a
+ * compatible build with the same optimising passes enabled, every source
+ * file it was compiled from is unchanged and, if its includes depend on it,
+ * the working directory is the same. Nothing is loaded into the virtual
+ * machine otherwise.
+ *
+ * @param vm A freshly initialized virtual machine to load the program into.
+ * @param cache_path The path of the cache file.
+ * @return true if the program was loaded, false if it must be compiled.
+ */
+bool apexCache_load(ApexVM *vm, const char *cache_path) {
+    int saved_errno = errno;
+    size_t size;
+    const char *data = map_file(cache_path, &size);
+    if (!data) {
+        errno = saved_errno;
+        return false;
+    }
+
+    bool ok = false;
+    const CacheHeader *header = (const CacheHeader *)data;
+    CacheLayout layout;
+    if (size < sizeof(CacheHeader) ||
+        memcmp(header->magic, CACHE_MAGIC, 4) != 0 ||
+        header->version != CACHE_VERSION ||
+        header->endian != CACHE_ENDIAN ||
+        header->opcode_count != OP_HALT + 1 ||
+        header->codegen != (uint32_t)vm->codegen) {
+        goto done;
+    }
+    cache_layout(header, &layout);
+    if (layout.end != size || !check_image(header, &layout, data)) {
+        goto done;
+    }
+
+    const CacheSource *sources = (const CacheSource *)(data + layout.sources);
+    const CacheString *strings = (const CacheString *)(data + layout.strings);
+    for (uint32_t i = 0; i < header->source_count; i++) {
+        const char *path = data + layout.bytes + strings[sources[i].path].offset;
+        if (!source_fresh(&sources[i], path)) {
+            goto done;
+        }
+    }
+    if (header->cwd != CACHE_NONE) {
+        char *cwd = realpath(".", NULL);
+        bool same = cwd && strcmp(cwd, data + layout.bytes + strings[header->cwd].offset) == 0;
+        free(cwd);
+        if (!same) {
+            goto done;
+        }
+    }
+
+    load_image(vm, header, &layout, data);
+    ok = true;
+
+done:
+    munmap((void *)data, size);
+    errno = saved_errno;
+    return ok;
+}
+
+/**
+ * Returns the index of a string constant, adding it if it is new.
+ */
+static uint32_t writer_string(CacheWriter *writer, ApexString *str) {
+    ApexValue index;
+    if (apexVal_arrayget(&index, writer->string_index, apexVal_makestr(str))) {
+        return (uint32_t)index.intval;
+    }
+    writer_reserve(writer->strings, writer->string_count, writer->string_size);
+    writer->strings[writer->string_count] = str;
+    apexVal_arrayset(
+        writer->string_index,
+        apexVal_makestr(str),
+        apexVal_makeint(writer->string_count));
+    writer->string_bytes += str->len + 1;
+    return (uint32_t)writer->string_count++;
+}
+
+/**
+ * Returns the index of a NUL-terminated string, adding it if it is new.
+ */
+static uint32_t writer_cstring(CacheWriter *writer, const char *str) {
+    return writer_string(writer, apexStr_new(str, strlen(str)));
+}
+
+/**
+ * Returns the index of a function, adding it if it is new.
+ */
+static uint32_t writer_fn(CacheWriter *writer, ApexFn *fn) {
+    for (int i = 0; i < writer->fn_count; i++) {
+        if (writer->fns[i] == fn) {
+            return (uint32_t)i;
+        }
+    }
+    writer_reserve(writer->fns, writer->fn_count, writer->fn_size);
+    writer->fns[writer->fn_count] = fn;
+    return (uint32_t)writer->fn_count++;
+}
+
+/**
+ * Appends a global record.
+ */
+static void writer_global(CacheWriter *writer, CacheGlobalKind kind, const char *name, uint32_t fn) {
+    writer_reserve(writer->globals, writer->global_count, writer->global_size);
+    CacheGlobal *global = &writer->globals[writer->global_count++];
+    global->kind = kind;
+    global->name = writer_cstring(writer, name);
+    global->fn = fn;
+}
+
+/**
+ * Records the functions and object types defined at compile time.
+ *
+ * Compiling a program defines its named functions and object types as
+ * globals, and attaches methods to the types. Only the types' methods exist
+ * at that point, since their data fields are set when the program runs.
+ *
+ * @return false if a global holds a value that cannot be cached.
+ */
+static bool writer_globals(CacheWriter *writer, SymbolTable *table) {
+    for (int i = 0; i < table->size; i++) {
+        for (Symbol *symbol = table->symbols[i]; symbol; symbol = symbol->next) {
+            if (symbol->value.type == APEX_VAL_FN) {
+                writer_global(writer, CACHE_GLOBAL_FN, symbol->name, writer_fn(writer, symbol->value.fnval));
+            } else if (symbol->value.type == APEX_VAL_TYPE) {
+                ApexObject *type = symbol->value.objval;
+                writer_global(writer, CACHE_GLOBAL_TYPE, symbol->name, CACHE_NONE);
+                for (int slot = 0; slot < type->shape->count; slot++) {
+                    if (type->slots[slot].type != APEX_VAL_FN) {
+                        return false;
+                    }
+                    writer_global(
+                        writer, CACHE_GLOBAL_METHOD, type->shape->keys[slot],
+                        writer_fn(writer, type->slots[slot].fnval));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Writes a cache image to a file.
+ *
+ * The image is written to a temporary file that is then renamed over the
+ * cache file, so concurrent runs never see a partially written cache.
+ */
+static bool write_image(const char *cache_path, const char *data, size_t size) {
+    size_t len = strlen(cache_path) + 32;
+    char *tmp_path = apexMem_alloc(len);
+    snprintf(tmp_path, len, "%s.%ld.tmp", cache_path, (long)getpid());
+
+    FILE *file = fopen(tmp_path, "wb");
+    bool ok = file && fwrite(data, 1, size, file) == size;
+    if (file && fclose(file) != 0) {
+        ok = false;
+    }
+    if (ok) {
+        ok = rename(tmp_path, cache_path) == 0;
+    }
+    if (!ok && file) {
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return ok;
+}
+
+/**
+ * Writes the compiled program in the virtual machine to a cache file.
+ *
+ * This must be called right after the program was compiled and before it
+ * runs, while the global table holds only the globals defined by the
+ * compiler. Every module of the program, which includes the script itself,
+ * is stamped so that the cache is ignored once any of them changes, and so
+ * is the working directory if an include was resolved against it. Failing
+ * to write the cache is not an error; the program simply gets compiled
+ * again on the next run.
+ *
+ * @param vm The virtual machine holding the compiled program.
+ * @param cache_path The path of the cache file.
+ * @return true if the cache was written, false otherwise.
+ */
+bool apexCache_save(ApexVM *vm, const char *cache_path) {
+    int saved_errno = errno;
+    CacheWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.string_index = apexVal_newarray();
+
+    bool ok = true;
+    int source_count = vm->module_count;
+    CacheSource *sources = apexMem_calloc(source_count + 1, sizeof(CacheSource));
+    for (int i = 0; ok && i < source_count; i++) {
+        sources[i].path = writer_cstring(&writer, vm->modules[i].path);
+        ok = stamp_source(&sources[i], vm->modules[i].path);
+    }
+
+    uint32_t cwd = CACHE_NONE;
+    if (ok && vm->cwd_includes) {
+        char *real = realpath(".", NULL);
+        ok = real != NULL;
+        if (ok) {
+            cwd = writer_cstring(&writer, real);
+            free(real);
+        }
+    }
+
+    ok = ok && writer_globals(&writer, &vm->global_table);
+
+    Chunk *chunk = vm->chunk;
+    CacheIns *ins = apexMem_calloc(chunk->ins_count + 1, sizeof(CacheIns));
+    for (int i = 0; ok && i < chunk->ins_count; i++) {
+        ApexValue value = chunk->ins[i].value;
+        ins[i].opcode = chunk->ins[i].opcode;
+        ins[i].type = value.type;
+        ins[i].lineno = chunk->ins[i].srcloc.lineno;
+        ins[i].file = chunk->ins[i].srcloc.filename
+            ? writer_cstring(&writer, chunk->ins[i].srcloc.filename)
+            : CACHE_NONE;
+        switch (value.type) {
+        case APEX_VAL_INT:
+            ins[i].value.intval = value.intval;
+            break;
+        case APEX_VAL_DBL:
+            ins[i].value.dblval = value.dblval;
+            break;
+        case APEX_VAL_BOOL:
+            ins[i].value.intval = value.boolval;
+            break;
+        case APEX_VAL_STR:
+            ins[i].value.index = writer_string(&writer, value.strval);
+            break;
+        case APEX_VAL_FN:
+            ins[i].value.index = writer_fn(&writer, value.fnval);
+            break;
+        case APEX_VAL_NULL:
+            break;
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    // Functions are described last, since recording them adds their names
+    // and parameters to the string constants.
+    CacheFn *fns = apexMem_calloc(writer.fn_count + 1, sizeof(CacheFn));
+    for (int i = 0; ok && i < writer.fn_count; i++) {
+        ApexFn *fn = writer.fns[i];
+        fns[i].name = writer_cstring(&writer, fn->name);
+        fns[i].params = writer.param_count;
+        fns[i].argc = fn->argc;
+        fns[i].addr = fn->addr;
+        fns[i].have_variadic = fn->have_variadic;
+        for (int j = 0; j < fn->argc; j++) {
+            uint32_t param = writer_cstring(&writer, fn->params[j]);
+            writer_reserve(writer.params, writer.param_count, writer.param_size);
+            writer.params[writer.param_count++] = param;
+        }
+    }
+
+    if (ok) {
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, 4);
+        header.version = CACHE_VERSION;
+        header.endian = CACHE_ENDIAN;
+        header.opcode_count = OP_HALT + 1;
+        header.codegen = vm->codegen;
+        header.source_count = source_count;
+        header.string_count = writer.string_count;
+        header.string_bytes = writer.string_bytes;
+        header.fn_count = writer.fn_count;
+        header.param_count = writer.param_count;
+        header.global_count = writer.global_count;
+        header.ins_count = chunk->ins_count;
+        header.cwd = cwd;
+
+        CacheLayout layout;
+        cache_layout(&header, &layout);
+        char *data = apexMem_calloc(layout.end, 1);
+        memcpy(data, &header, sizeof(header));
+        memcpy(data + layout.sources, sources, sizeof(CacheSource) * source_count);
+        memcpy(data + layout.fns, fns, sizeof(CacheFn) * writer.fn_count);
+        if (writer.param_count) {
+            memcpy(data + layout.params, writer.params, sizeof(uint32_t) * writer.param_count);
+        }
+        if (writer.global_count) {
+            memcpy(data + layout.globals, writer.globals, sizeof(CacheGlobal) * writer.global_count);
+        }
+        memcpy(data + layout.ins, ins, sizeof(CacheIns) * chunk->ins_count);
+
+        CacheString *strings = (CacheString *)(data + layout.strings);
+        size_t offset = 0;
+        for (int i = 0; i < writer.string_count; i++) {
+            ApexString *str = writer.strings[i];
+            strings[i].offset = offset;
+            strings[i].len = str->len;
+            memcpy(data + layout.bytes + offset, str->value, str->len + 1);
+            offset += str->len + 1;
+        }
+
+        ok = write_image(cache_path, data, layout.end);
+        free(data);
+    }
+
+    free(fns);
+    free(ins);
+    free(sources);
+    free(writer.strings);
+    free(writer.fns);
+    free(writer.params);
+    free(writer.globals);
+    apexVal_freearray(writer.string_index);
+    errno = saved_errno;
+    return ok;
+}
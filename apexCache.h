@@ -0,0 +1,11 @@
+#ifndef APEX_CACHE_H
+#define APEX_CACHE_H
+
+#include <stdbool.h>
+#include "apexVM.h"
+
+extern char *apexCache_path(const char *script);
+extern bool apexCache_load(ApexVM *vm, const char *cache_path);
+extern bool apexCache_save(ApexVM *vm, const char *cache_path);
+
+#endif
@@ -13,6 +13,8 @@
 #include "apexLex.h"
 #include "apexParse.h"
 #include "apexUtil.h"
+#include "apexLoad.h"
+#include "apexType.h"
 
 #define EMIT_OP_INT(vm, opcode, value) emit_instruction(vm, opcode, apexVal_makeint(value))
 #define EMIT_OP_DBL(vm, opcode, value) emit_instruction(vm, opcode, apexVal_makedbl(value))
@@ -20,6 +22,46 @@
 #define EMIT_OP_BOOL(vm, opcode, value) emit_instruction(vm, opcode, apexVal_makebool(value))
 #define EMIT_OP(vm, opcode) emit_instruction(vm, opcode, zero_value())
 #define UPDATE_SRCLOC(vm, node) vm->srcloc = node->srcloc
+#define INLINE_MAX_COST 32
+#define LOOP_ASSIGNED_MAX 16
+#define LOOP_HOISTED_MAX 8
+
+/**
+ * A global function whose calls can be inlined.
+ */
+typedef struct InlineFn {
+    ApexFn *fn; /** The function */
+    AST *body; /** The body of the function's declaration */
+} InlineFn;
+
+/**
+ * A loop-invariant expression of a loop condition, evaluated once before
+ * the loop.
+ */
+typedef struct HoistedExpr {
+    AST *node; /** The expression */
+    ApexString *temp; /** The hidden variable holding its value */
+} HoistedExpr;
+
+/**
+ * Library functions whose calls are compiled to dedicated opcodes.
+ */
+static const struct {
+    const char *lib;
+    const char *fn;
+    int argc; /** The number of arguments, or -1 for one or more */
+    OpCode opcode;
+} intrinsics[] = {
+    { "std", "len", 1, OP_LEN },
+    { "std", "int", 1, OP_TO_INT },
+    { "std", "str", 1, OP_TO_STR },
+    { "std", "dbl", 1, OP_TO_DBL },
+    { "math", "abs", 1, OP_ABS },
+    { "math", "floor", 1, OP_FLOOR },
+    { "math", "min", -1, OP_MIN },
+    { "math", "max", -1, OP_MAX },
+    { "io", "print", 1, OP_PRINT }
+};
 
 static bool compile_expression(ApexVM *vm, AST *node, bool use_result);
 static bool compile_statement(ApexVM *vm, AST *node);
@@ -75,6 +117,26 @@ static void emit_instruction(ApexVM *vm, OpCode opcode, ApexValue value) {
     vm->chunk->ins_count++;
 }
 
+/**
+ * Returns the stack slot of a parameter of a function being inlined.
+ *
+ * The arguments of a call are pushed in order and bound to the parameters
+ * from the last one, so the first parameter holds the last argument.
+ *
+ * @param fn The function being inlined.
+ * @param name The interned name of the variable.
+ * @return The slot of the argument above the call's base, or -1 if the
+ *         variable is not a parameter.
+ */
+static int param_slot(const ApexFn *fn, const char *name) {
+    for (int i = 0; i < fn->argc; i++) {
+        if (fn->params[i] == name) {
+            return fn->argc - 1 - i;
+        }
+    }
+    return -1;
+}
+
 /**
  * Compiles an AST node representing a variable to bytecode.
  *
@@ -100,6 +162,11 @@ static void compile_variable(ApexVM *vm, AST *node, bool is_assignment) {
         return;
     }
 
+    if (vm->inlining && !is_assignment) {
+        EMIT_OP_INT(vm, OP_GET_ARG, param_slot(vm->inlining, var_name->value));
+        return;
+    }
+
     if (is_assignment) {
         if (vm->in_function) {            
             EMIT_OP_STR(vm, OP_SET_LOCAL, var_name);
@@ -115,6 +182,49 @@ static void compile_variable(ApexVM *vm, AST *node, bool is_assignment) {
     }
 }
 
+/**
+ * Returns the specialised form of an arithmetic or comparison opcode if type
+ * inference proved that both operands are ints or both are dbls.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param opcode The generic opcode.
+ * @param left The AST node of the left operand.
+ * @param right The AST node of the right operand.
+ * @return The specialised opcode, or the generic one if there is none.
+ */
+static OpCode typed_opcode(ApexVM *vm, OpCode opcode, AST *left, AST *right) {
+    if (!vm->typed || left->value_type != right->value_type) {
+        return opcode;
+    }
+    if (left->value_type == AST_TYPE_INT) {
+        switch (opcode) {
+        case OP_ADD: return OP_ADD_INT;
+        case OP_SUB: return OP_SUB_INT;
+        case OP_MUL: return OP_MUL_INT;
+        case OP_EQ: return OP_EQ_INT;
+        case OP_NE: return OP_NE_INT;
+        case OP_LT: return OP_LT_INT;
+        case OP_LE: return OP_LE_INT;
+        case OP_GT: return OP_GT_INT;
+        case OP_GE: return OP_GE_INT;
+        default: break;
+        }
+    } else if (left->value_type == AST_TYPE_DBL) {
+        switch (opcode) {
+        case OP_ADD: return OP_ADD_DBL;
+        case OP_SUB: return OP_SUB_DBL;
+        case OP_MUL: return OP_MUL_DBL;
+        case OP_DIV: return OP_DIV_DBL;
+        case OP_LT: return OP_LT_DBL;
+        case OP_LE: return OP_LE_DBL;
+        case OP_GT: return OP_GT_DBL;
+        case OP_GE: return OP_GE_DBL;
+        default: break;
+        }
+    }
+    return opcode;
+}
+
 /**
  * Compiles a parameter list from an AST node to an array of strings.
  *
@@ -255,6 +365,8 @@ static bool compile_array_access(ApexVM *vm, AST *node, bool is_assignment) {
 
     if (is_assignment) {
         EMIT_OP(vm, OP_SET_ELEMENT);
+    } else if (vm->typed && node->right->value_type == AST_TYPE_INT) {
+        EMIT_OP(vm, OP_GET_ELEMENT_INT);
     } else {
         EMIT_OP(vm, OP_GET_ELEMENT);
     }
@@ -293,6 +405,257 @@ static bool compile_argument_list(ApexVM *vm, AST *argument_list, int *argc) {
     return true;
 }
 
+/**
+ * Adds two inlining costs, either of which may be -1 for a node that cannot
+ * be inlined.
+ */
+static int add_cost(int a, int b) {
+    return a < 0 || b < 0 ? -1 : a + b;
+}
+
+/**
+ * Computes the cost of inlining an expression from the body of a function.
+ *
+ * Only expressions without side effects on variables are inlined, and the
+ * only variables they may read are the function's parameters. Calls of Apex
+ * functions are not inlined, since a function body cannot reach globals.
+ *
+ * @param node The AST node of the expression.
+ * @param fn The function whose body holds the expression.
+ * @return The number of nodes of the expression, or -1 if it cannot be
+ *         inlined.
+ */
+static int expression_cost(AST *node, const ApexFn *fn) {
+    int cost = 1;
+
+    if (!node) {
+        return -1;
+    }
+    switch (node->type) {
+    case AST_INT:
+    case AST_DBL:
+    case AST_STR:
+    case AST_NULL:
+    case AST_BOOL:
+    case AST_LIB_MEMBER:
+        return 1;
+
+    case AST_VAR:
+        return param_slot(fn, node->value.strval->value) < 0 ? -1 : 1;
+
+    case AST_UNARY_ADD:
+    case AST_UNARY_SUB:
+    case AST_UNARY_NOT:
+        return add_cost(1, expression_cost(node->right, fn));
+
+    case AST_BIN_ADD:
+    case AST_BIN_SUB:
+    case AST_BIN_MUL:
+    case AST_BIN_DIV:
+    case AST_BIN_MOD:
+    case AST_BIN_EQ:
+    case AST_BIN_NE:
+    case AST_BIN_LT:
+    case AST_BIN_LE:
+    case AST_BIN_GT:
+    case AST_BIN_GE:
+    case AST_LOGICAL_EXPR:
+    case AST_ARRAY_ACCESS:
+        cost = add_cost(cost, expression_cost(node->left, fn));
+        return add_cost(cost, expression_cost(node->right, fn));
+
+    case AST_TERNARY:
+        cost = add_cost(cost, expression_cost(node->left, fn));
+        cost = add_cost(cost, expression_cost(node->right, fn));
+        return add_cost(cost, expression_cost(node->value.ast_node, fn));
+
+    case AST_MEMBER_ACCESS:
+        return add_cost(cost, expression_cost(node->left, fn));
+
+    case AST_LIB_CALL:
+        for (AST *arg = node->value.ast_node; arg && arg->right; arg = arg->left) {
+            cost = add_cost(cost, expression_cost(arg->right, fn));
+        }
+        return cost;
+
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Computes the cost of inlining a statement from the body of a function.
+ *
+ * A body can be inlined if every path through it ends in a return with a
+ * value, through if statements whose branches return. An if statement
+ * without an else branch continues with the statements that follow it.
+ *
+ * @param node The AST node of the statement.
+ * @param next The statements that follow it, or NULL.
+ * @param fn The function whose body holds the statement.
+ * @return The number of nodes on the statement's paths, or -1 if it cannot
+ *         be inlined.
+ */
+static int statement_cost(AST *node, AST *next, const ApexFn *fn) {
+    if (!node) {
+        return -1;
+    }
+    switch (node->type) {
+    case AST_BLOCK:
+        return node->right ? -1 : statement_cost(node->left, NULL, fn);
+
+    case AST_STATEMENT:
+        return statement_cost(node->left, node->right, fn);
+
+    case AST_RETURN:
+        return expression_cost(node->left, fn);
+
+    case AST_IF: {
+        int cost = add_cost(1, expression_cost(node->left, fn));
+        cost = add_cost(cost, statement_cost(node->right, NULL, fn));
+        if (node->value.ast_node) {
+            return add_cost(cost, statement_cost(node->value.ast_node, NULL, fn));
+        }
+        return add_cost(cost, statement_cost(next, NULL, fn));
+    }
+
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Records a global function whose calls can be inlined, if its body is
+ * small enough and only computes a value from its parameters.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param fn The function.
+ * @param body The body of the function's declaration.
+ */
+static void add_inline_fn(ApexVM *vm, ApexFn *fn, AST *body) {
+    int cost;
+
+    if (!(vm->codegen & APEX_CODEGEN_INLINE)) {
+        return;
+    }
+    if (fn->have_variadic) {
+        return;
+    }
+    cost = statement_cost(body, NULL, fn);
+    if (cost < 0 || cost > INLINE_MAX_COST) {
+        return;
+    }
+    if (vm->inline_count == vm->inline_size) {
+        vm->inline_size = vm->inline_size ? vm->inline_size * 2 : 8;
+        vm->inline_fns = apexMem_realloc(vm->inline_fns, sizeof(InlineFn) * vm->inline_size);
+    }
+    vm->inline_fns[vm->inline_count].fn = fn;
+    vm->inline_fns[vm->inline_count].body = body;
+    vm->inline_count++;
+}
+
+/**
+ * Finds the inlinable function that a global name is bound to.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param name The interned name of the function.
+ * @return The inlinable function, or NULL if the global is not bound to
+ *         one.
+ */
+static InlineFn *find_inline_fn(ApexVM *vm, const char *name) {
+    ApexValue value;
+
+    if (!apexSym_getglobal(&value, &vm->global_table, name) ||
+        value.type != APEX_VAL_FN) {
+        return NULL;
+    }
+    for (int i = vm->inline_count - 1; i >= 0; i--) {
+        if (vm->inline_fns[i].fn == value.fnval) {
+            return &vm->inline_fns[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Compiles a statement of an inlined function body to bytecode that leaves
+ * the returned value on the stack.
+ *
+ * The statement must be one that statement_cost() accepted.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param node The AST node of the statement.
+ * @param next The statements that follow it, or NULL.
+ * @return true if the statement was compiled successfully, false otherwise.
+ */
+static bool compile_inline_statement(ApexVM *vm, AST *node, AST *next) {
+    switch (node->type) {
+    case AST_BLOCK:
+        return compile_inline_statement(vm, node->left, NULL);
+
+    case AST_STATEMENT:
+        return compile_inline_statement(vm, node->left, node->right);
+
+    case AST_RETURN:
+        return compile_expression(vm, node->left, true);
+
+    case AST_IF: {
+        UPDATE_SRCLOC(vm, node);
+        if (!compile_expression(vm, node->left, true)) {
+            return false;
+        }
+        EMIT_OP(vm, OP_JUMP_IF_FALSE);
+        int false_jmp_i = vm->chunk->ins_count - 1;
+
+        if (!compile_inline_statement(vm, node->right, NULL)) {
+            return false;
+        }
+        EMIT_OP(vm, OP_JUMP);
+        int end_jmp_i = vm->chunk->ins_count - 1;
+
+        vm->chunk->ins[false_jmp_i].value.intval = vm->chunk->ins_count - false_jmp_i - 1;
+        if (!compile_inline_statement(vm, node->value.ast_node ? node->value.ast_node : next, NULL)) {
+            return false;
+        }
+        vm->chunk->ins[end_jmp_i].value.intval = vm->chunk->ins_count - end_jmp_i - 1;
+        return true;
+    }
+
+    default:
+        apexErr_syntax(node->srcloc, "cannot inline statement");
+        return false;
+    }
+}
+
+/**
+ * Compiles the body of an inlined call to bytecode, once its arguments are
+ * on the stack.
+ *
+ * The body runs between OP_INLINE_ENTER, which checks at run time that the
+ * global still holds the function, and OP_INLINE_LEAVE, which replaces the
+ * arguments with the result. The body keeps the source locations of the
+ * function, and the call is shown in stack traces as a normal call is.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param inline_fn The function to inline.
+ * @return true if the body was compiled successfully, false otherwise.
+ */
+static bool compile_inline_call(ApexVM *vm, InlineFn *inline_fn) {
+    SrcLoc srcloc = vm->srcloc;
+    ApexValue fnval = apexVal_makefn(inline_fn->fn);
+    bool ok;
+
+    // The instruction keeps the function alive once no global holds it.
+    apexVal_retain(fnval);
+    emit_instruction(vm, OP_INLINE_ENTER, fnval);
+    vm->inlining = inline_fn->fn;
+    ok = compile_inline_statement(vm, inline_fn->body, NULL);
+    vm->inlining = NULL;
+    vm->srcloc = srcloc;
+    EMIT_OP(vm, OP_INLINE_LEAVE);
+    return ok;
+}
+
 /**
  * Compiles an AST node representing a function declaration to bytecode.
  *
@@ -362,6 +725,7 @@ static bool compile_function_declaration(ApexVM *vm, AST *node) {
         pop_scope(&vm->local_scopes);
         EMIT_OP(vm, OP_FUNCTION_END);
         vm->in_function = false;
+        add_inline_fn(vm, fn, node->right);
     }
     return true;
 }
@@ -371,7 +735,8 @@ static bool compile_function_declaration(ApexVM *vm, AST *node) {
  *
  * This function compiles the argument list and the function name, and
  * emits an instruction to call the function with the correct number of
- * arguments.
+ * arguments. A call of a small global function from outside any function
+ * is inlined instead, guarded against the global being reassigned.
  *
  * @param vm A pointer to the virtual machine structure containing the
  *           instruction chunk.
@@ -387,6 +752,12 @@ static bool compile_function_call(ApexVM *vm, AST *node) {
     if (!compile_argument_list(vm, node->right, &argc)) {
         return false;
     }
+    if (!vm->in_function) {
+        InlineFn *inline_fn = find_inline_fn(vm, fn_name->value);
+        if (inline_fn && inline_fn->fn->argc == argc) {
+            return compile_inline_call(vm, inline_fn);
+        }
+    }
     if (vm->in_function) {
         EMIT_OP_STR(vm, OP_GET_LOCAL, fn_name);
     } else {
@@ -397,12 +768,50 @@ static bool compile_function_call(ApexVM *vm, AST *node) {
     return true;
 }
 
+/**
+ * Finds the opcode a library function call is compiled to, if the function
+ * is one of the intrinsics and is called with the number of arguments the
+ * opcode expects, and intrinsics are enabled.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param node The AST node representing the library function call.
+ * @param argc The number of arguments in the call.
+ * @param opcode Where the opcode is stored.
+ * @return true if the call is compiled to an intrinsic, false otherwise.
+ */
+static bool find_intrinsic(ApexVM *vm, AST *node, int argc, OpCode *opcode) {
+    const char *lib_name = node->left->value.strval->value;
+    const char *fn_name = node->right->value.strval->value;
+
+    if (!(vm->codegen & APEX_CODEGEN_INTRINSICS)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(intrinsics) / sizeof(intrinsics[0]); i++) {
+        if (strcmp(intrinsics[i].lib, lib_name) != 0 ||
+            strcmp(intrinsics[i].fn, fn_name) != 0) {
+            continue;
+        }
+        if (intrinsics[i].argc < 0 ? argc < 1 : argc != intrinsics[i].argc) {
+            return false;
+        }
+        // Calls to functions the library does not register still fail at
+        // run time, as they would without the intrinsic.
+        ApexLibData data = apexLib_get(lib_name, fn_name);
+        if (!data.name || data.is_var) {
+            return false;
+        }
+        *opcode = intrinsics[i].opcode;
+        return true;
+    }
+    return false;
+}
+
 /**
  * Compiles an AST node representing a library function call to bytecode.
  *
  * This function compiles the argument list, library name, and function name, and
  * emits an instruction to call the library function with the correct number of
- * arguments.
+ * arguments. Calls to intrinsics are compiled to their opcode instead.
  *
  * @param vm A pointer to the virtual machine structure containing the
  *           instruction chunk.
@@ -413,9 +822,14 @@ static bool compile_function_call(ApexVM *vm, AST *node) {
  */
 static bool compile_library_call(ApexVM *vm, AST *node) {
     int argc = 0;
+    OpCode opcode;
     if (!compile_argument_list(vm, node->value.ast_node, &argc)) {
         return false;
     }
+    if (find_intrinsic(vm, node, argc, &opcode)) {
+        EMIT_OP_INT(vm, opcode, argc);
+        return true;
+    }
 
     EMIT_OP_STR(vm, OP_PUSH_STR, node->left->value.strval); // Library name
     EMIT_OP_STR(vm, OP_PUSH_STR, node->right->value.strval); // Function name
@@ -478,25 +892,27 @@ static bool compile_assignment(ApexVM *vm, AST *node) {
         if (!compile_expression(vm, node->right, true)) {
             return false;
         }
+        OpCode opcode = OP_ADD;
         switch (node->type) {
         case AST_ASSIGN_ADD:
-            EMIT_OP(vm, OP_ADD);
+            opcode = OP_ADD;
             break;
         case AST_ASSIGN_SUB:
-            EMIT_OP(vm, OP_SUB);
+            opcode = OP_SUB;
             break;
         case AST_ASSIGN_MUL:
-            EMIT_OP(vm, OP_MUL);
+            opcode = OP_MUL;
             break;
         case AST_ASSIGN_DIV:
-            EMIT_OP(vm, OP_DIV);
+            opcode = OP_DIV;
             break;
         case AST_ASSIGN_MOD:
-            EMIT_OP(vm, OP_MOD);
+            opcode = OP_MOD;
             break;
         default:
             break;
         }
+        EMIT_OP(vm, typed_opcode(vm, opcode, node->left, node->right));
         compile_variable(vm, node->left, true);
         return true;
     }
@@ -622,47 +1038,50 @@ static bool compile_unary_expr(ApexVM *vm, AST *node, bool result_used) {
  *         otherwise.
  */
 static bool compile_binary_expr(ApexVM *vm, AST *node) {
+    OpCode opcode;
+
     if (!compile_expression(vm, node->left, true) || 
         !compile_expression(vm, node->right, true)) {
         return false;
     }        
     switch (node->type) {
     case AST_BIN_ADD:
-        EMIT_OP(vm, OP_ADD);
+        opcode = OP_ADD;
         break;
     case AST_BIN_SUB: 
-        EMIT_OP(vm, OP_SUB);
+        opcode = OP_SUB;
         break;
     case AST_BIN_MUL:
-        EMIT_OP(vm, OP_MUL);
+        opcode = OP_MUL;
         break;
     case AST_BIN_DIV:
-        EMIT_OP(vm, OP_DIV);
+        opcode = OP_DIV;
         break;
     case AST_BIN_MOD:
-        EMIT_OP(vm, OP_MOD);
+        opcode = OP_MOD;
         break;
     case AST_BIN_EQ:
-        EMIT_OP(vm, OP_EQ);
+        opcode = OP_EQ;
         break;
     case AST_BIN_NE:
-        EMIT_OP(vm, OP_NE);
+        opcode = OP_NE;
         break;
     case AST_BIN_LT:
-        EMIT_OP(vm, OP_LT);
+        opcode = OP_LT;
         break;
     case AST_BIN_LE:
-        EMIT_OP(vm, OP_LE);
+        opcode = OP_LE;
         break;
     case AST_BIN_GT:
-        EMIT_OP(vm, OP_GT);
+        opcode = OP_GT;
         break;
     case AST_BIN_GE:
-        EMIT_OP(vm, OP_GE);
+        opcode = OP_GE;
         break;
     default:
-        break;
+        return true;
     }
+    EMIT_OP(vm, typed_opcode(vm, opcode, node->left, node->right));
     return true;
 }
 
@@ -834,7 +1253,9 @@ static bool compile_closure(ApexVM *vm, AST *node) {
     EMIT_OP(vm, OP_FUNCTION_END);
     vm->in_function = false;
 
-    emit_instruction(vm, OP_CREATE_CLOSURE, apexVal_makefn(fn));
+    ApexValue fnval = apexVal_makefn(fn);
+    apexVal_retain(fnval);
+    emit_instruction(vm, OP_CREATE_CLOSURE, fnval);
 
     return true;
 }
@@ -853,6 +1274,12 @@ static bool compile_closure(ApexVM *vm, AST *node) {
  */
 static bool compile_expression(ApexVM *vm, AST *node, bool result_used) {
     UPDATE_SRCLOC(vm, node);
+    for (int i = 0; i < vm->hoist_count; i++) {
+        if (vm->hoisted[i].node == node) {
+            EMIT_OP_STR(vm, vm->in_function ? OP_GET_LOCAL : OP_GET_GLOBAL, vm->hoisted[i].temp);
+            return true;
+        }
+    }
     switch (node->type) {
     case AST_INT:
         EMIT_OP_INT(vm, OP_PUSH_INT, atoi(node->value.strval->value));
@@ -1014,83 +1441,171 @@ static bool compile_expression(ApexVM *vm, AST *node, bool result_used) {
 }
 
 /**
- * Compiles an AST node representing an include statement to bytecode.
+ * Finds a module of the program by its canonical path, registering the
+ * file if it is not a module yet.
+ *
+ * @param vm A pointer to the virtual machine compiling the program.
+ * @param canonical The interned canonical path of the file.
+ * @return The index of the module.
+ */
+static int add_module(ApexVM *vm, const char *canonical) {
+    for (int i = 0; i < vm->module_count; i++) {
+        if (vm->modules[i].path == canonical) {
+            return i;
+        }
+    }
+    if (vm->module_count == vm->module_size) {
+        vm->module_size = vm->module_size ? vm->module_size * 2 : 8;
+        vm->modules = apexMem_realloc(vm->modules, sizeof(ApexModule) * vm->module_size);
+    }
+    ApexModule *module = &vm->modules[vm->module_count];
+    module->path = canonical;
+    module->included = false;
+    module->compiling = false;
+    return vm->module_count++;
+}
+
+/**
+ * Registers a source file as a module of the program.
+ *
+ * The module registry is keyed by canonical path, so a file reached through
+ * different relative paths or symlinks is registered only once. Since the
+ * paths are interned, looking a module up compares pointers. The registry
+ * also lists the files a cached copy of the program depends on.
+ *
+ * @param vm A pointer to the virtual machine compiling the program.
+ * @param path The path of the source file.
+ * @return true if the file was registered, false if it already was.
+ */
+bool apexCode_addmodule(ApexVM *vm, const char *path) {
+    int count = vm->module_count;
+    int module = add_module(vm, apexLoad_canonical(path));
+    vm->modules[module].included = true;
+    return vm->module_count > count;
+}
+
+/**
+ * Compiles the statements of an included file's program.
+ *
+ * @param vm A pointer to the virtual machine structure containing the
+ *           instruction chunk.
+ * @param program The program of the included file, or NULL if it failed to
+ *                parse.
+ * @param arena The arena holding the program.
+ * @return true if the program was compiled successfully, false otherwise.
+ */
+static bool compile_included_program(ApexVM *vm, AST *program, ApexArena *arena) {
+    ApexArena *parent_arena = vm->arena;
+    bool typed = vm->typed;
+    int inline_count = vm->inline_count;
+    bool ok = true;
+
+    if (!program) {
+        return true;
+    }
+    vm->arena = arena;
+    vm->typed = (vm->codegen & APEX_CODEGEN_TYPES) && apexType_infer(program, false);
+    if (program->left) {
+        ok = compile_statement(vm, program->left);
+    }
+    if (ok && program->right) {
+        ok = compile_statement(vm, program->right);
+    }
+    // The included program's functions are not inlined past its end, since
+    // their bodies are released with its arena.
+    vm->arena = parent_arena;
+    vm->typed = typed;
+    vm->inline_count = inline_count;
+    return ok;
+}
+
+/**
+ * Compiles the program of an included file.
  *
- * This function opens the specified file and reads it into memory, then
- * lexes and parses the source code in the file. If the parse is successful,
- * the ASTs are compiled recursively. If the parse fails, a warning is emitted
- * with the specified source location.
+ * If the file was found by the loader, its AST is taken from the loader,
+ * compiled and then released. Otherwise, this function maps the specified
+ * file into memory, then lexes and parses the source code in the file. If
+ * the parse is successful, the ASTs are compiled recursively. If the parse
+ * fails, a warning is emitted with the specified source location. The
+ * included file is parsed into a child of the including file's arena, which
+ * is released as soon as the included code has been compiled.
  *
  * @param vm A pointer to the virtual machine structure containing the
  *           instruction chunk.
- * @param node The AST node representing the include statement to be compiled.
+ * @param node The AST node representing the include statement.
+ * @param path The resolved path of the file, which is freed.
+ * @param canonical The interned canonical path of the file.
+ * @return true if the file was compiled successfully, false otherwise.
  */
-static bool compile_include(ApexVM *vm, AST *node) {
-    const char *incpath = node->value.strval->value;
+static bool compile_included_file(ApexVM *vm, AST *node, char *path, const char *canonical) {
     const char *filepath = node->srcloc.filename;
-    FILE *file;
+    ApexSource source;
     Lexer lexer;
     Parser parser;
-    AST *program;
-    
-    char *lslash = strrchr(filepath, '/');
-#ifdef _WIN32
-    if (!lslash) {
-        lslash = strrchr(filepath, '\\');
+    ApexArena arena;
+    bool ok;
+
+    ApexUnit *unit = vm->loader ? apexLoad_take(vm->loader, canonical) : NULL;
+    if (unit && unit->source.text) {
+        free(path);
+        ok = compile_included_program(vm, unit->program, &unit->arena);
+        apexMem_arenafree(&unit->arena);
+        return ok;
     }
-#endif
-    
-    if (lslash && filepath[0] != '/') {
-        size_t dir_len = lslash - filepath + 1;
-        size_t fullpath_len = dir_len + strlen(incpath) + 1;
-        char *fullpath = apexMem_alloc(fullpath_len);
-        snprintf(fullpath, fullpath_len, "%.*s%s", (int)dir_len, filepath, incpath);
-        
-        file = fopen(fullpath, "r");
-        if (!file) {
-            apexErr_syntax(node->srcloc, "cannot include specified path: %s", fullpath);
-            return false;
-        }
-        free(fullpath);
-    } else {
-        file = fopen(incpath, "r");
-        if (!file) {
-            apexErr_syntax(node->srcloc, "cannot include specified path: %s", incpath);
-            return false;
-        }
+
+    if (!apexLoad_open(&source, path)) {
+        apexErr_syntax(node->srcloc, "cannot include specified path: %s", path);
+        free(path);
+        return false;
     }
+    free(path);
 
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
+    apexMem_arenainit(&arena, vm->arena);
+    init_lexer(&lexer, filepath, source.text, source.length);
+    init_parser(&parser, &lexer, &arena);
+    ok = compile_included_program(vm, parse_program(&parser), &arena);
 
-    char *source = apexMem_alloc(file_size + 1);
-    fread(source, 1, file_size, file);
-    source[file_size] = '\0';
-    fclose(file);
+    apexMem_arenafree(&arena);
+    apexLoad_close(&source);
+    return ok;
+}
 
-    init_lexer(&lexer, filepath, source);
-    init_parser(&parser, &lexer);
+/**
+ * Compiles an AST node representing an include statement to bytecode.
+ *
+ * A file included where it runs exactly once, at the top level of the
+ * program, is compiled there only; its definitions are already in place
+ * for every later include of it. An include in a branch, loop or function
+ * may not run, so the file is compiled in place each time. A file is never
+ * compiled inside itself.
+ *
+ * @param vm A pointer to the virtual machine structure containing the
+ *           instruction chunk.
+ * @param node The AST node representing the include statement to be compiled.
+ * @return true if the include was compiled successfully, false otherwise.
+ */
+static bool compile_include(ApexVM *vm, AST *node) {
+    char *path = apexLoad_resolve(node->srcloc.filename, node->value.strval->value);
+    const char *canonical = apexLoad_canonical(path);
 
-    program = parse_program(&parser);
-    if (program) {
-        if (program->left) {
-            if (!compile_statement(vm, program->left)) {
-                return false;
-            }
-        }
-        
-        if (program->right) {
-            if (!compile_statement(vm, program->right)) {
-                return false;
-            }
-        }  
+    // Which file a relative path names depends on the working directory,
+    // so a cached program is only valid there.
+    if (path[0] != '/') {
+        vm->cwd_includes = true;
     }
 
-    free_ast(program);
-    free_parser(&parser);
-    free(source);
-    return true;
+    int module = add_module(vm, canonical);
+    if (vm->modules[module].included || vm->modules[module].compiling) {
+        free(path);
+        return true;
+    }
+    if (!vm->in_function && vm->conditional == 0) {
+        vm->modules[module].included = true;
+    }
+    vm->modules[module].compiling = true;
+    bool ok = compile_included_file(vm, node, path, canonical);
+    vm->modules[module].compiling = false;
+    return ok;
 }
 
 /**
@@ -1155,15 +1670,376 @@ static bool compile_switch(ApexVM *vm, AST *node) {
 }
 
 /**
- * Compiles an AST node representing a loop to bytecode.
+ * The variables a loop assigns, and whether it may modify anything else.
+ */
+typedef struct {
+    ApexString *assigned[LOOP_ASSIGNED_MAX]; /** Assigned variables */
+    int count; /** Number of assigned variables */
+    bool mutates; /** Whether the loop may modify arrays, objects or unknown variables */
+} LoopEffects;
+
+/**
+ * Returns the APEX_LIB_* flags of the library function a call refers to,
+ * or 0 if it is unknown.
+ */
+static int library_flags(AST *node) {
+    ApexLibData data = apexLib_get(
+        node->left->value.strval->value,
+        node->right->value.strval->value);
+    return data.name && !data.is_var ? data.flags : 0;
+}
+
+/**
+ * Records a variable assigned by a loop.
+ */
+static void add_assigned(LoopEffects *effects, AST *var) {
+    if (!var || var->type != AST_VAR || var->val_is_ast ||
+        effects->count == LOOP_ASSIGNED_MAX) {
+        effects->mutates = true;
+        return;
+    }
+    effects->assigned[effects->count++] = var->value.strval;
+}
+
+/**
+ * Records the effects of a statement or expression in a loop.
  *
- * This function handles the compilation of loop constructs such as while
- * loops and for loops. It sets up the loop environment, compiles the
+ * Assignments to variables are recorded by name. Anything that may modify
+ * an array or an object, or run code that is not in sight, marks the loop
+ * as mutating: stores to elements and members, calls of Apex functions,
+ * closures, includes, and library calls without the APEX_LIB_PURE or
+ * APEX_LIB_NOMUTATE flag. Unfamiliar nodes are treated the same way.
+ *
+ * @param node The AST node to scan.
+ * @param effects The effects found so far.
+ */
+static void scan_effects(AST *node, LoopEffects *effects) {
+    if (!node || effects->mutates) {
+        return;
+    }
+    switch (node->type) {
+    case AST_INT:
+    case AST_DBL:
+    case AST_STR:
+    case AST_BOOL:
+    case AST_NULL:
+    case AST_VAR:
+    case AST_LIB_MEMBER:
+    case AST_BREAK:
+    case AST_CONTINUE:
+        break;
+
+    case AST_BIN_ADD:
+    case AST_BIN_SUB:
+    case AST_BIN_MUL:
+    case AST_BIN_DIV:
+    case AST_BIN_MOD:
+    case AST_BIN_GT:
+    case AST_BIN_LT:
+    case AST_BIN_LE:
+    case AST_BIN_GE:
+    case AST_BIN_BITWISE_AND:
+    case AST_BIN_BITWISE_OR:
+    case AST_BIN_EQ:
+    case AST_BIN_NE:
+    case AST_LOGICAL_EXPR:
+    case AST_ARRAY_ACCESS:
+    case AST_WHILE:
+        scan_effects(node->left, effects);
+        scan_effects(node->right, effects);
+        break;
+
+    case AST_UNARY_ADD:
+    case AST_UNARY_SUB:
+    case AST_UNARY_NOT:
+        scan_effects(node->right, effects);
+        break;
+
+    case AST_UNARY_INC:
+    case AST_UNARY_DEC:
+        add_assigned(effects, node->right ? node->right : node->left);
+        break;
+
+    case AST_MEMBER_ACCESS:
+    case AST_RETURN:
+        scan_effects(node->left, effects);
+        break;
+
+    case AST_TERNARY:
+    case AST_IF:
+        scan_effects(node->left, effects);
+        scan_effects(node->right, effects);
+        scan_effects(node->value.ast_node, effects);
+        break;
+
+    case AST_ASSIGNMENT:
+    case AST_ASSIGN_ADD:
+    case AST_ASSIGN_SUB:
+    case AST_ASSIGN_MUL:
+    case AST_ASSIGN_DIV:
+    case AST_ASSIGN_MOD:
+        add_assigned(effects, node->left);
+        scan_effects(node->right, effects);
+        break;
+
+    case AST_LIB_CALL:
+        if (!(library_flags(node) & (APEX_LIB_PURE | APEX_LIB_NOMUTATE))) {
+            effects->mutates = true;
+            break;
+        }
+        for (AST *arg = node->value.ast_node; arg && arg->right; arg = arg->left) {
+            scan_effects(arg->right, effects);
+        }
+        break;
+
+    case AST_ARRAY:
+        for (AST *current = node->right; current; current = current->next) {
+            if (current->type == AST_KEY_VALUE_PAIR) {
+                scan_effects(current->left, effects);
+                scan_effects(current->right, effects);
+            } else if (current->type == AST_ELEMENT) {
+                scan_effects(current->right, effects);
+            } else {
+                scan_effects(current, effects);
+            }
+        }
+        break;
+
+    case AST_FOR:
+        scan_effects(node->left, effects);
+        scan_effects(node->right, effects);
+        scan_effects(node->value.ast_node->left, effects);
+        scan_effects(node->value.ast_node->right, effects);
+        break;
+
+    case AST_FOREACH:
+        if (node->left) {
+            add_assigned(effects, node->left);
+        }
+        if (node->right) {
+            add_assigned(effects, node->right);
+        }
+        scan_effects(node->value.ast_node->left, effects);
+        scan_effects(node->value.ast_node->right, effects);
+        break;
+
+    case AST_BLOCK:
+        if (node->right && node->right->type == AST_CASE) {
+            effects->mutates = true;
+            break;
+        }
+        scan_effects(node->right, effects);
+        scan_effects(node->left, effects);
+        break;
+
+    case AST_STATEMENT:
+        for (; node && node->type == AST_STATEMENT; node = node->right) {
+            scan_effects(node->left, effects);
+        }
+        scan_effects(node, effects);
+        break;
+
+    default:
+        effects->mutates = true;
+        break;
+    }
+}
+
+/**
+ * Returns whether an expression has the same value on every evaluation of a
+ * loop condition, given the loop's effects.
+ */
+static bool is_invariant(AST *node, const LoopEffects *effects) {
+    switch (node->type) {
+    case AST_INT:
+    case AST_DBL:
+    case AST_STR:
+    case AST_BOOL:
+    case AST_NULL:
+    case AST_LIB_MEMBER:
+        return true;
+
+    case AST_VAR:
+        if (node->val_is_ast) {
+            return false;
+        }
+        for (int i = 0; i < effects->count; i++) {
+            if (effects->assigned[i] == node->value.strval) {
+                return false;
+            }
+        }
+        return true;
+
+    case AST_BIN_ADD:
+    case AST_BIN_SUB:
+    case AST_BIN_MUL:
+    case AST_BIN_DIV:
+    case AST_BIN_MOD:
+    case AST_BIN_GT:
+    case AST_BIN_LT:
+    case AST_BIN_LE:
+    case AST_BIN_GE:
+    case AST_BIN_EQ:
+    case AST_BIN_NE:
+    case AST_ARRAY_ACCESS:
+        return is_invariant(node->left, effects) && is_invariant(node->right, effects);
+
+    case AST_UNARY_ADD:
+    case AST_UNARY_SUB:
+    case AST_UNARY_NOT:
+        return is_invariant(node->right, effects);
+
+    case AST_MEMBER_ACCESS:
+        return is_invariant(node->left, effects);
+
+    case AST_LIB_CALL:
+        if (!(library_flags(node) & APEX_LIB_PURE)) {
+            return false;
+        }
+        for (AST *arg = node->value.ast_node; arg && arg->right; arg = arg->left) {
+            if (!is_invariant(arg->right, effects)) {
+                return false;
+            }
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * Collects the largest loop-invariant expressions of a loop condition that
+ * are worth evaluating once, rather than on every iteration.
+ *
+ * Only the parts of the condition that are evaluated every time are
+ * searched, so that hoisting does not evaluate anything the condition would
+ * have skipped: the right of && and || and the branches of ?: are left
+ * alone.
+ *
+ * @param node The AST node of the condition, or of a part of it.
+ * @param effects The effects of the loop.
+ * @param hoisted The expressions found so far.
+ * @param count The number of expressions found so far.
+ */
+static void collect_hoisted(AST *node, const LoopEffects *effects, HoistedExpr *hoisted, int *count) {
+    if (!node || *count == LOOP_HOISTED_MAX) {
+        return;
+    }
+    switch (node->type) {
+    case AST_INT:
+    case AST_DBL:
+    case AST_STR:
+    case AST_BOOL:
+    case AST_NULL:
+    case AST_LIB_MEMBER:
+    case AST_VAR:
+        return;
+
+    default:
+        break;
+    }
+    if (is_invariant(node, effects)) {
+        hoisted[(*count)++].node = node;
+        return;
+    }
+    switch (node->type) {
+    case AST_BIN_ADD:
+    case AST_BIN_SUB:
+    case AST_BIN_MUL:
+    case AST_BIN_DIV:
+    case AST_BIN_MOD:
+    case AST_BIN_GT:
+    case AST_BIN_LT:
+    case AST_BIN_LE:
+    case AST_BIN_GE:
+    case AST_BIN_EQ:
+    case AST_BIN_NE:
+    case AST_ARRAY_ACCESS:
+        collect_hoisted(node->left, effects, hoisted, count);
+        collect_hoisted(node->right, effects, hoisted, count);
+        break;
+
+    case AST_UNARY_ADD:
+    case AST_UNARY_SUB:
+    case AST_UNARY_NOT:
+        collect_hoisted(node->right, effects, hoisted, count);
+        break;
+
+    case AST_LOGICAL_EXPR:
+    case AST_TERNARY:
+    case AST_MEMBER_ACCESS:
+        collect_hoisted(node->left, effects, hoisted, count);
+        break;
+
+    case AST_LIB_CALL:
+        for (AST *arg = node->value.ast_node; arg && arg->right; arg = arg->left) {
+            collect_hoisted(arg->right, effects, hoisted, count);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Evaluates the loop-invariant expressions of a loop condition into hidden
+ * variables, before the loop starts.
+ *
+ * The condition reads the variables in place of the expressions. Nothing
+ * is hoisted if the loop may modify an array or an object, since the
+ * expressions may read them.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param condition The AST node of the loop condition.
+ * @param body The AST node of the loop body.
+ * @param increment The AST node of the increment expression, or NULL.
+ * @param hoisted Receives the hoisted expressions.
+ * @return The number of hoisted expressions, or -1 if one failed to
+ *         compile.
+ */
+static int hoist_invariants(ApexVM *vm, AST *condition, AST *body, AST *increment, HoistedExpr *hoisted) {
+    LoopEffects effects;
+    int count = 0;
+
+    if (!condition || !(vm->codegen & APEX_CODEGEN_HOIST)) {
+        return 0;
+    }
+    effects.count = 0;
+    effects.mutates = false;
+    scan_effects(condition, &effects);
+    scan_effects(body, &effects);
+    scan_effects(increment, &effects);
+    if (effects.mutates) {
+        return 0;
+    }
+
+    collect_hoisted(condition, &effects, hoisted, &count);
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        int length = snprintf(name, sizeof(name), "@hoisted%d", vm->hoist_serial++);
+        hoisted[i].temp = apexStr_new(name, length);
+        if (!compile_expression(vm, hoisted[i].node, true)) {
+            return -1;
+        }
+        EMIT_OP_STR(vm, vm->in_function ? OP_SET_LOCAL : OP_SET_GLOBAL, hoisted[i].temp);
+    }
+    return count;
+}
+
+/**
+ * Compiles an AST node representing a loop to bytecode.
+ *
+ * This function handles the compilation of loop constructs such as while
+ * loops and for loops. It sets up the loop environment, compiles the
  * loop condition, body, and any increment expression. If the loop condition
  * is present, it emits a conditional jump instruction to exit the loop
  * when the condition evaluates to false. It ensures that the loop body is
  * entered initially and that the increment expression is executed after
  * each iteration. It restores the previous loop state after completion.
+ * Loop-invariant expressions of the condition are evaluated once, before
+ * the loop.
  *
  * @param vm A pointer to the virtual machine structure containing the
  *           instruction chunk and loop state.
@@ -1176,12 +2052,22 @@ static bool compile_switch(ApexVM *vm, AST *node) {
 static bool compile_loop(ApexVM *vm, AST *condition, AST *body, AST *increment) {
     int previous_loop_start = vm->loop_start;
     int previous_loop_end = vm->loop_end;
+    HoistedExpr hoisted[LOOP_HOISTED_MAX];
+    int hoist_count = hoist_invariants(vm, condition, body, increment, hoisted);
 
+    if (hoist_count < 0) {
+        return false;
+    }
     UPDATE_SRCLOC(vm, condition);
     vm->loop_start = vm->chunk->ins_count;
 
     if (condition) {
-        if (!compile_expression(vm, condition, true)) {
+        vm->hoisted = hoisted;
+        vm->hoist_count = hoist_count;
+        bool ok = compile_expression(vm, condition, true);
+        vm->hoisted = NULL;
+        vm->hoist_count = 0;
+        if (!ok) {
             return false;
         }
         EMIT_OP(vm, OP_JUMP_IF_FALSE);
@@ -1306,6 +2192,49 @@ static bool compile_if(ApexVM *vm, AST *node) {
     return true;
 }
 
+/**
+ * Compiles a statement whose body may run any number of times, or never.
+ *
+ * Branches, loops and function declarations are compiled with the VM's
+ * conditional depth raised, so that includes in their bodies are not taken
+ * to run exactly once.
+ *
+ * @param vm A pointer to the virtual machine structure containing the
+ *           instruction chunk.
+ * @param node The AST node representing the statement to be compiled.
+ * @return true if the statement was compiled successfully, false otherwise.
+ */
+static bool compile_conditional(ApexVM *vm, AST *node) {
+    bool ok;
+    vm->conditional++;
+    switch (node->type) {
+    case AST_IF:
+        ok = compile_if(vm, node);
+        break;
+    case AST_SWITCH:
+        ok = compile_switch(vm, node);
+        break;
+    case AST_WHILE:
+        ok = compile_loop(vm, node->left, node->right, NULL);
+        break;
+    case AST_FOR:
+        ok = compile_statement(vm, node->left) &&
+             compile_loop(
+                vm, node->right,
+                node->value.ast_node->right,
+                node->value.ast_node->left);
+        break;
+    case AST_FOREACH:
+        ok = compile_foreach(vm, node);
+        break;
+    default:
+        ok = compile_function_declaration(vm, node);
+        break;
+    }
+    vm->conditional--;
+    return ok;
+}
+
 /**
  * Compiles an AST node representing a statement to bytecode.
  *
@@ -1326,22 +2255,12 @@ static bool compile_statement(ApexVM *vm, AST *node) {
 
     switch (node->type) {
     case AST_IF: 
-        return compile_if(vm, node);
     case AST_SWITCH:
-        return compile_switch(vm, node);
     case AST_WHILE: 
-        return compile_loop(vm, node->left, node->right, NULL);
     case AST_FOR: 
-        if (!compile_statement(vm, node->left)) {
-            return false;
-        }
-        return compile_loop(
-            vm, node->right, 
-            node->value.ast_node->right, 
-            node->value.ast_node->left);
-
     case AST_FOREACH:
-        return compile_foreach(vm, node);
+    case AST_FN_DECL:
+        return compile_conditional(vm, node);
     case AST_INCLUDE:
         return compile_include(vm, node);        
     case AST_CONTINUE:
@@ -1359,9 +2278,6 @@ static bool compile_statement(ApexVM *vm, AST *node) {
         EMIT_OP_INT(vm, OP_JUMP, vm->loop_end - vm->chunk->ins_count - 1);
         break;
 
-    case AST_FN_DECL:
-        return compile_function_declaration(vm, node);
-
     case AST_RETURN:
         if (node->left && !compile_expression(vm, node->left, true)) {
             return false;
@@ -1380,17 +2296,20 @@ static bool compile_statement(ApexVM *vm, AST *node) {
         return true;
 
     case AST_STATEMENT:
-        if (node->left) {
-            if (!compile_statement(vm, node->left)) {
-                return false;
+        // Walk the statement list in a loop, so that long scripts do not
+        // recurse once per statement.
+        while (node->type == AST_STATEMENT) {
+            if (node->left) {
+                if (!compile_statement(vm, node->left)) {
+                    return false;
+                }
             }
-        }
-        if (node->right && node->right->type != AST_CASE) {
-            if (!compile_statement(vm, node->right)) {
-                return false;
+            node = node->right;
+            if (!node || node->type == AST_CASE) {
+                return true;
             }
         }
-        return true;
+        return compile_statement(vm, node);
 
     default:
         return compile_expression(vm, node, false);
@@ -1401,15 +2320,20 @@ static bool compile_statement(ApexVM *vm, AST *node) {
 /**
  * Compile an AST to bytecode.
  *
- * This function predeclares all symbols in the program, and then compiles the
- * program to bytecode. The resulting bytecode is stored in the instruction
- * chunk in the virtual machine.
+ * This function infers the types of the program's expressions, and then
+ * compiles the program to bytecode. The resulting bytecode is stored in the
+ * instruction chunk in the virtual machine.
  *
  * @param vm A pointer to the virtual machine structure containing the
  *           instruction chunk and the local and global symbol tables.
  * @param program The AST node representing the program to be compiled.
  */
 bool apexCode_compile(ApexVM *vm, AST *program) {
+    // A program compiled into an empty chunk can only call functions it
+    // defines or includes itself.
+    vm->typed = (vm->codegen & APEX_CODEGEN_TYPES) &&
+                apexType_infer(program, vm->chunk->ins_count == 0);
+    vm->inline_count = 0;
     if (program->left) {
         if (!compile_statement(vm, program->left)) {
             return false;
@@ -1424,3 +2348,62 @@ bool apexCode_compile(ApexVM *vm, AST *program) {
     EMIT_OP(vm, OP_HALT);
     return true;
 }
+
+/**
+ * Removes the global functions whose code starts at or after the given
+ * address.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param addr The first address of the discarded code.
+ */
+static void drop_functions(ApexVM *vm, int addr) {
+    SymbolTable *table = &vm->global_table;
+    for (int i = 0; i < table->size; i++) {
+        for (Symbol *symbol = table->symbols[i]; symbol; symbol = symbol->next) {
+            if (symbol->value.type == APEX_VAL_FN && symbol->value.fnval->addr >= addr) {
+                symbol->value = apexVal_makenull();
+            }
+        }
+    }
+}
+
+/**
+ * Compiles one entry of an interactive session.
+ *
+ * The entry is appended to the chunk in place of the halt instruction that
+ * ended the previous entry, so the functions defined by earlier entries keep
+ * their addresses and nothing is compiled twice. On success, the instruction
+ * pointer is set to the entry's first instruction. If the entry fails to
+ * compile, the chunk and the compiler's scopes are rolled back, and the
+ * global functions the entry defined are removed.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param program The AST of the entry.
+ * @return true if the entry was compiled, false otherwise.
+ */
+bool apexCode_compileentry(ApexVM *vm, AST *program) {
+    Chunk *chunk = vm->chunk;
+    LocalScope *scope = vm->local_scopes.top;
+    int start = chunk->ins_count;
+
+    if (start > 0 && chunk->ins[start - 1].opcode == OP_HALT) {
+        start--;
+    }
+    chunk->ins_count = start;
+    if (apexCode_compile(vm, program)) {
+        vm->ip = start;
+        return true;
+    }
+
+    chunk->ins_count = start;
+    drop_functions(vm, start);
+    while (vm->local_scopes.top != scope) {
+        pop_scope(&vm->local_scopes);
+    }
+    vm->in_function = false;
+    vm->loop_start = -1;
+    vm->loop_end = -1;
+    EMIT_OP(vm, OP_HALT);
+    vm->ip = chunk->ins_count;
+    return false;
+}
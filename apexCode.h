@@ -5,5 +5,7 @@
 #include "apexVM.h"
 
 extern bool apexCode_compile(ApexVM *vm, AST *program);
+extern bool apexCode_compileentry(ApexVM *vm, AST *program);
+extern bool apexCode_addmodule(ApexVM *vm, const char *path);
 
 #endif
@@ -3,13 +3,46 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include "apexVM.h"
 #include "apexParse.h"
 #include "apexErr.h"
 
+static pthread_key_t stream_key;
+static pthread_once_t stream_once = PTHREAD_ONCE_INIT;
+
+static void create_stream_key(void) {
+    pthread_key_create(&stream_key, NULL);
+}
+
+/**
+ * Sets the stream that errors reported by the calling thread are written
+ * to.
+ *
+ * The front-end's worker threads collect the errors of each file they parse,
+ * so that the errors can be reported when the file is compiled.
+ *
+ * @param stream The stream to write errors to, or NULL for stderr.
+ */
+void apexErr_setstream(FILE *stream) {
+    pthread_once(&stream_once, create_stream_key);
+    pthread_setspecific(stream_key, stream);
+}
+
+/**
+ * Returns the stream that errors reported by the calling thread are written
+ * to.
+ */
+static FILE *error_stream(void) {
+    pthread_once(&stream_once, create_stream_key);
+    FILE *stream = pthread_getspecific(stream_key);
+    return stream ? stream : stderr;
+}
+
 /**
- * Prints an error message to stderr with the given error type and format
- * string.
+ * Prints an error message to the calling thread's error stream, which is
+ * stderr unless set by apexErr_setstream, with the given error type and
+ * format string.
  *
  * The error message will be prefixed with "Fatal Error: ", "Syntax Error: ",
  * "Runtime Error: ", "Type Error: ", or "Memory Error: " depending on the
@@ -26,21 +59,22 @@
  * the current errno.
  */
 void apexErr_error(SrcLoc srcloc, const char *fmt, ...) {
+    FILE *stream = error_stream();
     va_list args;
     va_start(args, fmt);
-    fprintf(stderr, "error");
+    fprintf(stream, "error");
     if (srcloc.lineno && srcloc.filename) {
-        fprintf(stderr," (line %d, file %s): ", 
+        fprintf(stream," (line %d, file %s): ", 
         srcloc.lineno, 
         srcloc.filename);
     } else {
-        fprintf(stderr, ": ");
+        fprintf(stream, ": ");
     }
-    vfprintf(stderr, fmt, args);
+    vfprintf(stream, fmt, args);
     if (errno) {
-        fprintf(stderr, ": %s", strerror(errno));
+        fprintf(stream, ": %s", strerror(errno));
     }
-    fprintf(stderr,"\n");
+    fprintf(stream,"\n");
     va_end(args);
 }
 
@@ -65,5 +65,6 @@
 
 extern void apexErr_error(SrcLoc srcloc, const char *fmt, ...);
 extern void apexErr_trace(ApexVM *vm);
+extern void apexErr_setstream(FILE *stream);
 
 #endif
\ No newline at end of file
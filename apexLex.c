@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdbool.h>
 #include "apexLex.h"
 #include "apexStr.h"
 #include "apexMem.h"
@@ -72,100 +72,78 @@ static TokenStr tk2str[] = {
     {"switch", 6},
     {"case", 4},
     {"default", 7},
+    {"error", 5},
     {"eof", 3}
 };
 
-/* Global strings used by the lexer. */
-static ApexString *IF_STR, *ELIF_STR, *ELSE_STR,
-    *FN_STR, 
-    *FOR_STR, *WHILE_STR, *FOREACH_STR, *IN_STR,
-    *RETURN_STR, 
-    *PLUS_STR, *MINUS_STR, *STAR_STR, *SLASH_STR, *MOD_STR,
-    *PLUS_PLUS_STR, *MINUS_MINUS_STR, 
-    *EQUAL_STR, *PLUS_EQUAL_STR, *MINUS_EQUAL_STR, 
-    *STAR_EQUAL_STR, *SLASH_EQUAL_STR, *MOD_EQUAL_STR,
-    *EQUAL_EQUAL_STR, *NOT_EQUAL_STR, 
-    *LESS_STR, *GREATER_STR, *LESS_EQUAL_STR, *GREATER_EQUAL_STR, 
-    *NOT_STR,
-    *AMP_STR, *AND_STR, *PIPE_STR, *OR_STR,
-    *QUESTION_STR,
-    *LPAREN_STR, *RPAREN_STR, 
-    *LBRACE_STR, *RBRACE_STR, 
-    *LBRACKET_STR, *RBRACKET_STR,
-    *COMMA_STR, *SEMICOLON_STR, 
-    *BREAK_STR, *CONTINUE_STR,
-    *TRUE_STR, *FALSE_STR,
-    *INCLUDE_STR,
-    *ARROW_STR,
-    *DOT_STR, *COLON_STR,
-    *SWITCH_STR, *CASE_STR, *DEFAULT_STR,
-    *NULL_STR;
-
-static int globals_initialized = 0;
+#define CC_SPACE 0x01 /** Whitespace */
+#define CC_DIGIT 0x02 /** Decimal digit */
+#define CC_ALPHA 0x04 /** ASCII letter */
+#define CC_IDENT 0x08 /** May appear after the first character of an identifier */
+
+#define S CC_SPACE
+#define D (CC_DIGIT | CC_IDENT)
+#define A (CC_ALPHA | CC_IDENT)
+#define U CC_IDENT
+
+/* Character classes of the ASCII characters; bytes above 127 have none. */
+static const unsigned char char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, U,
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0,
+};
+
+#undef S
+#undef D
+#undef A
+#undef U
 
 /**
- * Initializes global strings used by the lexer.
- *
- * This function is called once, the first time that init_lexer is called.
+ * A reserved word and the token type it is lexed as.
+ */
+typedef struct {
+    const char *str;  /** The keyword */
+    int len;          /** The length of the keyword */
+    TokenType type;   /** The token type of the keyword */
+} Keyword;
+
+#define KEYWORD_HASH_SIZE 32
+
+/**
+ * Hashes a word by its first and last character and its length.
  *
- * @see init_lexer
+ * The multipliers were chosen so that every keyword lands in its own slot
+ * of the keyword table, making the hash perfect for the keyword set: a word
+ * is a keyword only if it matches the single entry in its slot.
  */
-static void init_lexer_globals() {
-    IF_STR = apexStr_new("if", 2);
-    ELIF_STR = apexStr_new("elif", 4);
-    ELSE_STR = apexStr_new("else", 4);
-    FN_STR = apexStr_new("fn", 2);
-    FOR_STR = apexStr_new("for", 3);
-    WHILE_STR = apexStr_new("while", 5);
-    FOREACH_STR = apexStr_new("foreach", 7);
-    IN_STR = apexStr_new("in", 2);
-    RETURN_STR = apexStr_new("return", 6);
-    PLUS_STR = apexStr_new("+", 1);
-    MINUS_STR = apexStr_new("-", 1);
-    STAR_STR = apexStr_new("*", 1);
-    SLASH_STR = apexStr_new("/", 1);
-    MOD_STR = apexStr_new("%%", 1);
-    PLUS_PLUS_STR = apexStr_new("++", 2);
-    MINUS_MINUS_STR = apexStr_new("--", 2);
-    EQUAL_STR = apexStr_new("=", 1);
-    PLUS_EQUAL_STR = apexStr_new("+=", 2);
-    MINUS_EQUAL_STR = apexStr_new("-=", 2);
-    STAR_EQUAL_STR = apexStr_new("*=", 2);
-    SLASH_EQUAL_STR = apexStr_new("/=", 2);
-    MOD_EQUAL_STR = apexStr_new("%%=", 2);
-    EQUAL_EQUAL_STR = apexStr_new("==", 2);
-    NOT_EQUAL_STR = apexStr_new("!=", 2);
-    LESS_STR = apexStr_new("<", 1);
-    GREATER_STR = apexStr_new(">", 1);
-    LESS_EQUAL_STR = apexStr_new("<=", 2);
-    GREATER_EQUAL_STR = apexStr_new(">=", 2);
-    NOT_STR = apexStr_new("!", 1);
-    AMP_STR = apexStr_new("&", 1);
-    AND_STR = apexStr_new("&&", 2);
-    PIPE_STR = apexStr_new("|", 1);
-    OR_STR = apexStr_new("||", 2);
-    QUESTION_STR = apexStr_new("?", 1);
-    LPAREN_STR = apexStr_new("(", 1);
-    RPAREN_STR = apexStr_new(")", 1);
-    LBRACE_STR = apexStr_new("{", 1);
-    RBRACE_STR = apexStr_new("}", 1);
-    LBRACKET_STR = apexStr_new("[", 1);
-    RBRACKET_STR = apexStr_new("]", 1);
-    COMMA_STR = apexStr_new(",", 1);
-    SEMICOLON_STR = apexStr_new(";", 1);
-    CONTINUE_STR = apexStr_new("continue", 8);
-    BREAK_STR = apexStr_new("break", 5);
-    TRUE_STR = apexStr_new("true", 4);
-    FALSE_STR = apexStr_new("false", 5);
-    ARROW_STR = apexStr_new("=>", 2);
-    INCLUDE_STR = apexStr_new("include", 7);
-    DOT_STR = apexStr_new(".", 1);
-    COLON_STR = apexStr_new(":", 1);
-    SWITCH_STR = apexStr_new("switch", 6);
-    CASE_STR = apexStr_new("case", 4);
-    DEFAULT_STR = apexStr_new("default", 7);
-    NULL_STR = apexStr_new("null", 4);
-    globals_initialized = 1;
+#define keyword_hash(s, len) \
+    (((unsigned char)(s)[0] * 6 + (unsigned char)(s)[(len) - 1] * 15 + (len)) & (KEYWORD_HASH_SIZE - 1))
+
+/* Keywords indexed by keyword_hash. */
+static const Keyword keywords[KEYWORD_HASH_SIZE] = {
+    [1] = {"case", 4, TOKEN_CASE},
+    [3] = {"foreach", 7, TOKEN_FOREACH},
+    [4] = {"return", 6, TOKEN_RETURN},
+    [5] = {"continue", 8, TOKEN_CONTINUE},
+    [7] = {"true", 4, TOKEN_TRUE},
+    [8] = {"include", 7, TOKEN_INCLUDE},
+    [10] = {"in", 2, TOKEN_IN},
+    [11] = {"default", 7, TOKEN_DEFAULT},
+    [12] = {"null", 4, TOKEN_NULL},
+    [13] = {"else", 4, TOKEN_ELSE},
+    [16] = {"switch", 6, TOKEN_SWITCH},
+    [18] = {"if", 2, TOKEN_IF},
+    [20] = {"false", 5, TOKEN_FALSE},
+    [21] = {"for", 3, TOKEN_FOR},
+    [22] = {"break", 5, TOKEN_BREAK},
+    [24] = {"fn", 2, TOKEN_FN},
+    [26] = {"while", 5, TOKEN_WHILE},
+    [28] = {"elif", 4, TOKEN_ELIF}
 };
 
 /**
@@ -187,23 +165,18 @@ ApexString *get_token_str(TokenType type) {
  *
  * This function sets up the Lexer by assigning it the given source code
  * and filename, and initializing its position to 0 and its line number to
- * 1.
+ * 1. The lexer never reads past the given length, so the source code can
+ * be a read-only mapping of a file without a NUL-terminator.
  *
  * @param lexer A pointer to the Lexer structure to initialize.
  * @param filename The name of the file being parsed, or NULL if the source
  *                 code is not from a file.
- * @param source The source code to parse.
+ * @param source The source code to parse, or NULL.
+ * @param length The length of the source code.
  */
-void init_lexer(Lexer *lexer, const char *filename, char *source) {
-    if (!globals_initialized) {
-        init_lexer_globals();
-    }
+void init_lexer(Lexer *lexer, const char *filename, const char *source, size_t length) {
     lexer->source = source;
-    if (!source) {
-        lexer->length = 0;
-    } else {
-        lexer->length = strlen(source);
-    }
+    lexer->length = source ? (int)length : 0;
     lexer->position = 0;
     lexer->srcloc.lineno = 1;
     lexer->srcloc.filename = filename;
@@ -212,13 +185,14 @@ void init_lexer(Lexer *lexer, const char *filename, char *source) {
 void apexLex_feedline(Lexer *lexer, const char *line) {
     if (!lexer->source) {
         size_t len = strlen(line);
-        lexer->source = apexMem_alloc(len + 1);
-        strncpy(lexer->source, line, len);
-        lexer->source[len] = '\0';
+        char *source = apexMem_alloc(len + 1);
+        strncpy(source, line, len);
+        source[len] = '\0';
+        lexer->source = source;
         lexer->length = len;
     } else {
         size_t len = lexer->length + strlen(line);
-        char *source = apexMem_realloc(lexer->source, len + 1);
+        char *source = apexMem_realloc((char *)lexer->source, len + 1);
         strcat(source, line);
         lexer->source = source;
         lexer->length = len;
@@ -226,108 +200,57 @@ void apexLex_feedline(Lexer *lexer, const char *line) {
 }
 
 /**
- * Creates a new Token with the specified type and value.
+ * Creates a Token of the specified type spanning the source from start to
+ * the lexer's current position.
  *
- * This function allocates memory for a new Token structure and
- * initializes its fields with the provided type and value, along
- * with the source location from the given Lexer.
+ * Tokens are returned by value and refer to their text in the source code,
+ * so creating one allocates nothing.
  *
  * @param lexer A pointer to the Lexer structure providing the source location.
  * @param type The type of the token to be created.
- * @param value The value of the token as a string.
- * @return A pointer to the newly created Token structure.
+ * @param start The first character of the token in the source code.
+ * @param str The interned value of the token, or NULL if it has none.
+ * @return The newly created Token.
  */
-Token *create_token(Lexer *lexer, TokenType type, ApexString *str) {
-    Token *token = apexMem_alloc(sizeof(Token));
-    token->type = type;
-    token->str = str;
-    token->srcloc = lexer->srcloc;;
+static Token make_token(Lexer *lexer, TokenType type, const char *start, ApexString *str) {
+    Token token;
+    token.type = type;
+    token.start = start;
+    token.length = (int)(lexer->source + lexer->position - start);
+    token.str = str;
+    token.srcloc = lexer->srcloc;
     return token;
 }
 
 /**
- * Frees the memory allocated for a token.
- *
- * This function releases the memory used by the given Token structure.
- *
- * @param token A pointer to the Token to be freed.
- */
-void free_token(Token *token) {
-    free(token);
-}
-
-/**
- * Peeks at the next character in the source code without advancing the lexer's position.
- *
- * This function is useful for looking ahead at the next character in the source code
- * without consuming it. It returns '\0' if the lexer has reached the end of the source
- * code.
- *
- * @param lexer A pointer to the Lexer structure to peek into.
- * @return The next character in the source code, or '\0' if the end of the source code
- * has been reached.
- */
-static char peek(Lexer *lexer) {
-    if (lexer->position >= lexer->length) {
-        return '\0';
-    }
-    return lexer->source[lexer->position];
-}
-
-/**
- * Advances the lexer's position and returns the current character.
- *
- * This function increments the lexer's position to the next character
- * in the source code and returns the character at the current position.
- * If the end of the source code is reached, it returns '\0'.
- *
- * @param lexer A pointer to the Lexer structure to advance.
- * @return The current character in the source code, or '\0' if the end
- *         of the source code has been reached.
- */
-static char advance(Lexer *lexer) {
-    if (lexer->position >= lexer->length) {
-        return '\0';
-    }
-    return lexer->source[lexer->position++];
-}
-
-/**
- * Skips over whitespace characters in the source code.
+ * Skips over whitespace and comments in the source code.
  *
- * This function advances the lexer's position past any whitespace
- * characters. If a newline character is encountered, the line
- * counter is incremented. The function stops when a non-whitespace
- * character or the end of the source is reached.
+ * Whitespace is recognized through the character class table. A comment
+ * starts with '#' and runs to the end of the line. The line counter is
+ * incremented for every newline skipped.
  *
  * @param lexer A pointer to the Lexer structure to update.
  */
 static void skip_whitespace(Lexer *lexer) {
-    while (isspace(peek(lexer))) {
-        if (peek(lexer) == '\n') {
-            lexer->srcloc.lineno++;
-        }
-        advance(lexer);
-    }
-}
+    const char *p = lexer->source + lexer->position;
+    const char *end = lexer->source + lexer->length;
 
-/**
- * Skips over any comments in the source code.
- *
- * This function advances the lexer's position past any characters
- * starting with '#'. If a '#' character is encountered, the lexer's
- * position is advanced until a newline character or the end of
- * the source code is reached.
- *
- * @param lexer A pointer to the Lexer structure to update.
- */
-static void skip_comments(Lexer *lexer) {
-    if (peek(lexer) == '#') {
-        while (peek(lexer) != '\n' && peek(lexer) != '\0') {
-            advance(lexer);
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (char_class[c] & CC_SPACE) {
+            if (c == '\n') {
+                lexer->srcloc.lineno++;
+            }
+            p++;
+        } else if (c == '#') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            break;
         }
     }
-    skip_whitespace(lexer);
+    lexer->position = (int)(p - lexer->source);
 }
 
 /**
@@ -341,29 +264,28 @@ static void skip_comments(Lexer *lexer) {
  * the decimal point.
  *
  * @param lexer A pointer to the Lexer structure to update.
- * @return A pointer to a newly allocated Token structure with
- *         type TOKEN_INT or TOKEN_DBL, containing the number as a
- *         string, or NULL if the function encounters an error.
+ * @return A Token with type TOKEN_INT or TOKEN_DBL, containing the number
+ *         as an interned string.
  */
-static Token *scan_num(Lexer *lexer) {
-    int start = lexer->position - 1;
+static Token scan_num(Lexer *lexer) {
+    const char *start = lexer->source + lexer->position - 1;
+    const char *p = start + 1;
+    const char *end = lexer->source + lexer->length;
     TokenType token_type = TOKEN_INT;
 
-    while (isdigit(peek(lexer))) {
-        advance(lexer);
+    while (p < end && (char_class[(unsigned char)*p] & CC_DIGIT)) {
+        p++;
     }
-
-    if (peek(lexer) == '.') {
+    if (p < end && *p == '.') {
         token_type = TOKEN_DBL;
-        advance(lexer);
-        while (isdigit(peek(lexer))) {
-            advance(lexer);
+        p++;
+        while (p < end && (char_class[(unsigned char)*p] & CC_DIGIT)) {
+            p++;
         }
     }
 
-    int len = lexer->position - start;
-    ApexString *num = apexStr_new(lexer->source + start, len);
-    return create_token(lexer, token_type, num);
+    lexer->position = (int)(p - lexer->source);
+    return make_token(lexer, token_type, start, apexStr_new(start, p - start));
 }
 
 /**
@@ -371,67 +293,34 @@ static Token *scan_num(Lexer *lexer) {
  *
  * This function scans an identifier from the source code, starting at the
  * current position of the lexer. The identifier is a string of alphanumeric
- * characters and underscores.
+ * characters and underscores. Keywords are recognized with a perfect hash
+ * of the identifier's text before anything is interned, so only genuine
+ * identifiers reach the string table.
  *
  * @param lexer A pointer to the Lexer structure to update.
- * @return A pointer to a newly allocated Token structure with type
- *         TOKEN_IDENT or one of the keyword tokens, containing the
- *         identifier as a string, or NULL if the function encounters an
- *         error.
+ * @return A Token with type TOKEN_IDENT, containing the identifier as an
+ *         interned string, or one of the keyword tokens.
  */
-static Token *scan_ident(Lexer *lexer) {
-    int start = lexer->position - 1;
+static Token scan_ident(Lexer *lexer) {
+    const char *start = lexer->source + lexer->position - 1;
+    const char *p = start + 1;
+    const char *end = lexer->source + lexer->length;
 
-    if (peek(lexer) == '@') {
-        advance(lexer);
+    if (p < end && *p == '@') {
+        p++;
     }
-    while (isalnum(peek(lexer)) || peek(lexer) == '_') {
-        advance(lexer);
+    while (p < end && (char_class[(unsigned char)*p] & CC_IDENT)) {
+        p++;
     }
 
-    int len = lexer->position - start;
-    
-    ApexString *ident = apexStr_new(lexer->source + start, len);
-
-    if (ident == IF_STR) {
-        return create_token(lexer, TOKEN_IF, ident);
-    } else if (ident == ELIF_STR) {
-        return create_token(lexer, TOKEN_ELIF, ident);
-    } else if (ident == ELSE_STR) {
-        return create_token(lexer, TOKEN_ELSE, ident);
-    } else if (ident == FN_STR) {
-        return create_token(lexer, TOKEN_FN, ident);
-    } else if (ident == FOR_STR) {
-        return create_token(lexer, TOKEN_FOR, ident);
-    } else if (ident == WHILE_STR) {
-        return create_token(lexer, TOKEN_WHILE, ident);
-    } else if (ident == FOREACH_STR) {
-        return create_token(lexer, TOKEN_FOREACH, ident);
-    } else if (ident == IN_STR) {
-        return create_token(lexer, TOKEN_IN, ident);
-    } else if (ident == TRUE_STR)  {
-        return create_token(lexer, TOKEN_TRUE, ident);
-    } else if (ident == FALSE_STR) {
-        return create_token(lexer, TOKEN_FALSE, ident);
-    } else if (ident == RETURN_STR) {
-        return create_token(lexer, TOKEN_RETURN, ident);
-    } else if (ident == BREAK_STR) {
-        return create_token(lexer, TOKEN_BREAK, ident);
-    } else if (ident == CONTINUE_STR) {
-        return create_token(lexer, TOKEN_CONTINUE, ident);
-    } else if (ident == INCLUDE_STR) {
-        return create_token(lexer, TOKEN_INCLUDE, ident);
-    } else if (ident == SWITCH_STR) {
-        return create_token(lexer, TOKEN_SWITCH, ident);
-    } else if (ident == CASE_STR) {
-        return create_token(lexer, TOKEN_CASE, ident);
-    } else if (ident == DEFAULT_STR) {
-        return create_token(lexer, TOKEN_DEFAULT, ident);
-    } else if (ident == NULL_STR) {
-        return create_token(lexer, TOKEN_NULL, ident);
+    int len = (int)(p - start);
+    lexer->position = (int)(p - lexer->source);
+
+    const Keyword *keyword = &keywords[keyword_hash(start, len)];
+    if (keyword->len == len && memcmp(keyword->str, start, len) == 0) {
+        return make_token(lexer, keyword->type, start, NULL);
     }
-    
-    return create_token(lexer, TOKEN_IDENT, ident);
+    return make_token(lexer, TOKEN_IDENT, start, apexStr_new(start, len));
 }
 
 /**
@@ -439,22 +328,43 @@ static Token *scan_ident(Lexer *lexer) {
  *
  * This function scans a string from the source code, starting at the
  * current position of the lexer. The string is a sequence of characters
- * enclosed in double quotes, and may contain escaped characters.
+ * enclosed in double quotes, and may contain escaped characters. A string
+ * without escape sequences is interned straight from the source; only one
+ * with escapes is decoded into a temporary buffer first.
  *
  * @param lexer A pointer to the Lexer structure to update.
- * @return A pointer to a newly allocated Token structure with type
- *         TOKEN_STR, containing the string as a string, or NULL if the
- *         function encounters an error.
+ * @return A Token with type TOKEN_STR, containing the string as an
+ *         interned string.
  */
-static Token *scan_str(Lexer *lexer) {
-    int start = lexer->position;
-    char *buffer = apexMem_alloc(lexer->length - start);
-    int i = 0;
-
-    while (peek(lexer) != '"' && peek(lexer) != '\0') { 
-        char c = advance(lexer);
-        if (c == '\\') { // Handle escape sequences.
-            char next = advance(lexer);
+static Token scan_str(Lexer *lexer) {
+    const char *start = lexer->source + lexer->position - 1;
+    const char *body = start + 1;
+    const char *p = body;
+    const char *end = lexer->source + lexer->length;
+    bool has_escapes = false;
+
+    while (p < end && *p != '"' && *p != '\0') {
+        if (*p == '\\') {
+            has_escapes = true;
+            if (p + 1 < end) {
+                p++;
+            }
+        }
+        p++;
+    }
+
+    ApexString *str;
+    if (!has_escapes) {
+        str = apexStr_new(body, p - body);
+    } else {
+        char *buffer = apexMem_alloc(p - body + 1);
+        int i = 0;
+        for (const char *s = body; s < p; s++) {
+            if (*s != '\\') {
+                buffer[i++] = *s;
+                continue;
+            }
+            char next = ++s < p ? *s : '\0';
             switch (next) {
             case 'n':
                 buffer[i++] = '\n';
@@ -471,24 +381,22 @@ static Token *scan_str(Lexer *lexer) {
             case '"':
                 buffer[i++] = '"';
                 break;
-            default:                
+            default:
                 buffer[i++] = '\\';
                 buffer[i++] = next;
             }
-        } else {
-            buffer[i++] = c;
         }
+        buffer[i] = '\0';
+        str = apexStr_save(buffer, i);
     }
 
-    if (peek(lexer) == '"') {
-        advance(lexer); // Consume closing quote.
+    if (p < end && *p == '"') {
+        p++; // Consume closing quote.
     } else {
         apexErr_syntax(lexer->srcloc, "unterminated string literal");
     }
-    buffer[i] = '\0';
-    
-    ApexString *str = apexStr_save(buffer, i);
-    return create_token(lexer, TOKEN_STR, str);
+    lexer->position = (int)(p - lexer->source);
+    return make_token(lexer, TOKEN_STR, start, str);
 }
 
 /**
@@ -500,132 +408,93 @@ static Token *scan_str(Lexer *lexer) {
  * and punctuation. The function skips whitespace and comments before
  * processing the next meaningful token. If the end of the source code is
  * reached, a TOKEN_EOF is returned. If an unexpected character is
- * encountered, a syntax error is reported.
+ * encountered, a syntax error is reported and a TOKEN_ERROR is returned.
+ *
+ * Only identifiers and literals are interned; operators, punctuation and
+ * keywords are identified by their type and source span alone.
  *
  * @param lexer A pointer to the Lexer structure containing the source code
  *              and current position.
- * @return A pointer to a newly allocated Token structure, or NULL if a
- *         syntax error is encountered.
+ * @return The next Token.
  */
-Token *get_next_token(Lexer *lexer) {
+Token get_next_token(Lexer *lexer) {
     skip_whitespace(lexer);
-    skip_comments(lexer);
 
     if (lexer->position >= lexer->length) {
-        return create_token(lexer, TOKEN_EOF, apexStr_new("EOF", 3));
+        Token token = {TOKEN_EOF, "EOF", 3, NULL, lexer->srcloc};
+        return token;
     }
 
-    char c = advance(lexer);
+    const char *start = lexer->source + lexer->position;
+    char c = *start;
+    char next = lexer->position + 1 < lexer->length ? start[1] : '\0';
+    lexer->position++;
 
-    if (isalpha(c) || c == '@') {
+    if ((char_class[(unsigned char)c] & CC_ALPHA) || c == '@') {
         return scan_ident(lexer);
     }
-    if (isdigit(c)) {
+    if (char_class[(unsigned char)c] & CC_DIGIT) {
         return scan_num(lexer);
     }
 
+#define TOKEN(type) return make_token(lexer, type, start, NULL)
+#define TOKEN2(ch, type) if (next == ch) { lexer->position++; TOKEN(type); }
+
     switch (c) {
-    case '"':        
+    case '"':
         return scan_str(lexer);
     case '=':
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_EQUAL_EQUAL,  EQUAL_EQUAL_STR);
-        } else if (peek(lexer) == '>') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_ARROW, ARROW_STR);
-        }
-        return create_token(lexer, TOKEN_EQUAL, EQUAL_STR);      
+        TOKEN2('=', TOKEN_EQUAL_EQUAL);
+        TOKEN2('>', TOKEN_ARROW);
+        TOKEN(TOKEN_EQUAL);
     case '+':
-        if (peek(lexer) == '+') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_PLUS_PLUS, PLUS_PLUS_STR);
-        } else if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_PLUS_EQUAL, PLUS_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_PLUS, PLUS_STR);
+        TOKEN2('+', TOKEN_PLUS_PLUS);
+        TOKEN2('=', TOKEN_PLUS_EQUAL);
+        TOKEN(TOKEN_PLUS);
     case '-':
-        if (peek(lexer) == '-') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_MINUS_MINUS, MINUS_MINUS_STR);
-        } else if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_MINUS_EQUAL, MINUS_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_MINUS, MINUS_STR);
-    case '*': 
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_STAR_EQUAL, STAR_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_STAR, STAR_STR);
-    case '/': 
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_SLASH_EQUAL, SLASH_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_SLASH, SLASH_STR);
+        TOKEN2('-', TOKEN_MINUS_MINUS);
+        TOKEN2('=', TOKEN_MINUS_EQUAL);
+        TOKEN(TOKEN_MINUS);
+    case '*':
+        TOKEN2('=', TOKEN_STAR_EQUAL);
+        TOKEN(TOKEN_STAR);
+    case '/':
+        TOKEN2('=', TOKEN_SLASH_EQUAL);
+        TOKEN(TOKEN_SLASH);
     case '%':
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_MOD_EQUAL, MOD_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_PERCENT, MOD_STR);
-    case '?':
-        return create_token(lexer, TOKEN_QUESTION, QUESTION_STR);
-    case '(': 
-        return create_token(lexer, TOKEN_LPAREN, LPAREN_STR);
-    case ')': 
-        return create_token(lexer, TOKEN_RPAREN, RPAREN_STR);
-    case '{': 
-        return create_token(lexer, TOKEN_LBRACE, LBRACE_STR);
-    case '}': 
-        return create_token(lexer, TOKEN_RBRACE, RBRACE_STR);
-    case '[':
-        return create_token(lexer, TOKEN_LBRACKET, LBRACKET_STR);
-    case ']':
-        return create_token(lexer, TOKEN_RBRACKET, RBRACKET_STR);    
-    case ',': 
-        return create_token(lexer, TOKEN_COMMA, COMMA_STR);
-    case ';': 
-        return create_token(lexer, TOKEN_SEMICOLON, SEMICOLON_STR);
+        TOKEN2('=', TOKEN_MOD_EQUAL);
+        TOKEN(TOKEN_PERCENT);
     case '<':
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_LESS_EQUAL, LESS_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_LESS, LESS_STR);
+        TOKEN2('=', TOKEN_LESS_EQUAL);
+        TOKEN(TOKEN_LESS);
     case '>':
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_GREATER_EQUAL, GREATER_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_GREATER, GREATER_STR);    
-    case '!': 
-        if (peek(lexer) == '=') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_NOT_EQUAL, NOT_EQUAL_STR);
-        }
-        return create_token(lexer, TOKEN_NOT, NOT_STR);
+        TOKEN2('=', TOKEN_GREATER_EQUAL);
+        TOKEN(TOKEN_GREATER);
+    case '!':
+        TOKEN2('=', TOKEN_NOT_EQUAL);
+        TOKEN(TOKEN_NOT);
     case '&':
-        if (peek(lexer) == '&') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_AND, AND_STR);
-        }
-        return create_token(lexer, TOKEN_AMP, AMP_STR);
+        TOKEN2('&', TOKEN_AND);
+        TOKEN(TOKEN_AMP);
     case '|':
-        if (peek(lexer) == '|') {
-            advance(lexer);
-            return create_token(lexer, TOKEN_OR, OR_STR);
-        }
-        return create_token(lexer, TOKEN_PIPE, PIPE_STR);
-    case '.':
-        return create_token(lexer, TOKEN_DOT, DOT_STR);
-    case ':':
-        return create_token(lexer, TOKEN_COLON, COLON_STR);
+        TOKEN2('|', TOKEN_OR);
+        TOKEN(TOKEN_PIPE);
+    case '?': TOKEN(TOKEN_QUESTION);
+    case '(': TOKEN(TOKEN_LPAREN);
+    case ')': TOKEN(TOKEN_RPAREN);
+    case '{': TOKEN(TOKEN_LBRACE);
+    case '}': TOKEN(TOKEN_RBRACE);
+    case '[': TOKEN(TOKEN_LBRACKET);
+    case ']': TOKEN(TOKEN_RBRACKET);
+    case ',': TOKEN(TOKEN_COMMA);
+    case ';': TOKEN(TOKEN_SEMICOLON);
+    case '.': TOKEN(TOKEN_DOT);
+    case ':': TOKEN(TOKEN_COLON);
     }
 
+#undef TOKEN
+#undef TOKEN2
+
     apexErr_syntax(lexer->srcloc, "unexpected character: '%c'", c);
-    return NULL;
+    return make_token(lexer, TOKEN_ERROR, start, NULL);
 }
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "apexStr.h"
+#include "apexMem.h"
 
 /**
  * Represents a source location in the source code.
@@ -74,6 +75,7 @@ typedef enum {
     TOKEN_SWITCH,          /** 'switch' keyword */
     TOKEN_CASE,            /** 'case' keyword */
     TOKEN_DEFAULT,         /** 'default' keyword */
+    TOKEN_ERROR,           /** Unrecognized character */
     TOKEN_EOF              /** End of file token */
 } TokenType;
 
@@ -82,7 +84,9 @@ typedef enum {
  */
 typedef struct {
     TokenType type;       /** The type of the token */
-    ApexString *str;      /** The string representation of the token */
+    const char *start;    /** The text of the token in the source code */
+    int length;           /** The length of the token's text */
+    ApexString *str;      /** The interned value of an identifier or literal, otherwise NULL */
     SrcLoc srcloc;        /** The source location of the token */
 } Token;
 
@@ -90,7 +94,7 @@ typedef struct {
  * Represents the lexer state while processing source code.
  */
 typedef struct {
-    char *source;        /** The source code being lexed */
+    const char *source;  /** The source code being lexed, not NUL-terminated */
     int length;          /** Length of the source code */
     int position;        /** Current position in the source code */
     SrcLoc srcloc;       /** Current source location */
@@ -98,8 +102,7 @@ typedef struct {
 
 extern void apexLex_feedline(Lexer *lexer, const char *line);
 extern ApexString *get_token_str(TokenType type);
-extern void init_lexer(Lexer *lexer, const char *filename, char *source);
-extern Token *get_next_token(Lexer *lexer);
-extern void free_token(Token *token);
+extern void init_lexer(Lexer *lexer, const char *filename, const char *source, size_t length);
+extern Token get_next_token(Lexer *lexer);
 
 #endif
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "apexUtil.h"
 #include "apexMem.h"
 #include "apexStr.h"
+#include "apexErr.h"
 
 #define LIB_TABLE_SIZE 1024
 
@@ -54,11 +55,18 @@ static const char *LIB_PATHS[] = {
 void apexLib_add(const char *libname, const char *fnname, ApexLibData data) {
     char key[1024];
     snprintf(key, sizeof(key), "%s:%s", libname, fnname);
-    unsigned int index = apexUtil_hash(key) % LIB_TABLE_SIZE;
+    ApexString *keystr = apexStr_new(key, strlen(key));
+    unsigned int index = keystr->hash % LIB_TABLE_SIZE;
     LibEntry *entry = apexMem_alloc(sizeof(LibEntry));
 
-    entry->key = apexStr_new(key, strlen(key))->value;
+    entry->key = keystr->value;
     entry->data = data;
+    if (data.is_fast) {
+        entry->data.argc = 0;
+        while (entry->data.argc < APEX_LIB_ARGS_MAX && data.arg_types[entry->data.argc]) {
+            entry->data.argc++;
+        }
+    }
     entry->next = lib_table[index];
     lib_table[index] = entry;
 }
@@ -82,7 +90,7 @@ ApexLibData apexLib_get(const char *libname, const char *fnname) {
     char key[1024];
     snprintf(key, sizeof(key), "%s:%s", libname, fnname);
     ApexString *keystr = apexStr_new(key, strlen(key));
-    unsigned int index = apexUtil_hash(key) % LIB_TABLE_SIZE;
+    unsigned int index = keystr->hash % LIB_TABLE_SIZE;
     LibEntry *entry = lib_table[index];
     while (entry) {
         if (entry->key == keystr->value) {
@@ -90,7 +98,62 @@ ApexLibData apexLib_get(const char *libname, const char *fnname) {
         }
         entry = entry->next;
     }
-    return (ApexLibData){NULL, false, {.fn = NULL}};
+    return (ApexLibData){ .name = NULL };
+}
+
+/**
+ * Checks the arguments of a call to a function using the fast calling
+ * convention against the number and types the function declares.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param libname The name of the library.
+ * @param fnname The name of the function.
+ * @param data The function's library entry.
+ * @param args The arguments of the call.
+ * @param argc The number of arguments of the call.
+ * @return true if the arguments are valid, otherwise false after raising
+ *         an error.
+ */
+bool apexLib_checkargs(ApexVM *vm, const char *libname, const char *fnname,
+                       const ApexLibData *data, const ApexValue *args, int argc) {
+    static const char *ordinals[APEX_LIB_ARGS_MAX] = { "first", "second", "third", "fourth" };
+
+    if (argc != data->argc) {
+        apexErr_runtime(vm, "%s:%s expects exactly %d argument%s",
+                        libname, fnname, data->argc, data->argc == 1 ? "" : "s");
+        return false;
+    }
+    for (int i = 0; i < argc; i++) {
+        int types = data->arg_types[i];
+        if (types & APEX_ARG(args[i].type)) {
+            continue;
+        }
+        // List the accepted types as "int, flt or dbl".
+        char expected[128];
+        int len = 0;
+        int remaining = 0;
+        for (int type = 0; type <= APEX_VAL_NULL; type++) {
+            remaining += (types & APEX_ARG(type)) != 0;
+        }
+        expected[0] = '\0';
+        for (int type = 0; type <= APEX_VAL_NULL; type++) {
+            if (!(types & APEX_ARG(type))) {
+                continue;
+            }
+            remaining--;
+            len += snprintf(expected + len, sizeof(expected) - len, "%s%s",
+                            apexVal_typename(type),
+                            remaining > 1 ? ", " : remaining == 1 ? " or " : "");
+        }
+        if (argc == 1) {
+            apexErr_runtime(vm, "%s:%s expects argument to be %s", libname, fnname, expected);
+        } else {
+            apexErr_runtime(vm, "%s:%s expects %s argument to be %s",
+                            libname, fnname, ordinals[i], expected);
+        }
+        return false;
+    }
+    return true;
 }
 
 static void load_shared_library(const char *libpath, const char *libname) {
@@ -3,16 +3,62 @@
 
 #include "apexVM.h"
 
+/**
+ * The function has no side effects, and its result depends only on its
+ * arguments, so a call whose arguments do not change can be hoisted.
+ */
+#define APEX_LIB_PURE 1
+
+/**
+ * The function may have side effects outside the program, such as output,
+ * but it does not modify Apex values or run Apex code.
+ */
+#define APEX_LIB_NOMUTATE 2
+
+/**
+ * The largest number of arguments a function using the fast calling
+ * convention can declare.
+ */
+#define APEX_LIB_ARGS_MAX 4
+
+/**
+ * The types an argument of a fast function accepts, as a mask of
+ * APEX_ARG(APEX_VAL_*) values.
+ */
+#define APEX_ARG(TYPE) (1 << (TYPE))
+#define APEX_ARG_ANY (~0)
+#define APEX_ARG_NUM (APEX_ARG(APEX_VAL_INT) | APEX_ARG(APEX_VAL_FLT) | APEX_ARG(APEX_VAL_DBL))
+
+/**
+ * A library function using the fast calling convention.
+ *
+ * The VM checks the number and types of the arguments before the call.
+ * The function reads them from args, which points at the first argument on
+ * the stack, and stores its result in result, which starts out null. The
+ * arguments are removed from the stack after the call.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments, in the order they were passed.
+ * @param result Where the result of the call is stored.
+ * @return 0 on success, 1 if an error was raised.
+ */
+typedef int (*ApexFastFn)(ApexVM *vm, ApexValue *args, ApexValue *result);
+
 /**
  * Represents a function in a library, with its name and a pointer to the function.
  */
 typedef struct {
     char *name; /** The name of the data. */
     bool is_var; /** Whether the entry is a variable. */
+    bool is_fast; /** Whether the function uses the fast calling convention. */
     union {
         int (*fn)(ApexVM *, int); /** Pointer to the function implementation. */
+        ApexFastFn fast; /** Pointer to a fast function implementation. */
         ApexValue *var; /** Pointer to the variable member. */
     };
+    int flags; /** APEX_LIB_* flags describing the function's effects. */
+    int argc; /** The number of arguments a fast function takes. */
+    int arg_types[APEX_LIB_ARGS_MAX]; /** The APEX_ARG mask of each argument. */
 } ApexLibData;
 
 /**
@@ -29,7 +75,30 @@ typedef struct ApexLib {
  * @param name The name of the function.
  * @param fn The function implementation.
  */
-#define apex_regfn(NAME, FN) { NAME, false, { .fn = FN } }
+#define apex_regfn(NAME, FN) apex_regfnx(NAME, FN, 0)
+
+/**
+ * Macro to define a library function entry with flags describing its
+ * effects. A function without flags may do anything, including modifying
+ * its arguments and calling back into Apex code.
+ *
+ * @param name The name of the function.
+ * @param fn The function implementation.
+ * @param flags The APEX_LIB_* flags of the function.
+ */
+#define apex_regfnx(NAME, FN, FLAGS) { .name = NAME, .fn = FN, .flags = FLAGS }
+
+/**
+ * Macro to define a library function entry using the fast calling
+ * convention. The function takes one argument for each type mask given.
+ *
+ * @param name The name of the function.
+ * @param fn The ApexFastFn implementation.
+ * @param flags The APEX_LIB_* flags of the function.
+ * @param ... The APEX_ARG mask of each argument.
+ */
+#define apex_regfast(NAME, FN, FLAGS, ...) \
+    { .name = NAME, .is_fast = true, .fast = FN, .flags = FLAGS, .arg_types = { __VA_ARGS__ } }
 
 /**
  * Macro to define a library variable entry.
@@ -37,7 +106,7 @@ typedef struct ApexLib {
  * @param name The name of the variable.
  * @param var The variable value.
  */
-#define apex_regvar(NAME, VAR) { NAME, true, { .var = &VAR } }
+#define apex_regvar(NAME, VAR) { .name = NAME, .is_var = true, .var = &VAR }
 
 /**
  * Registers a library with the Apex runtime.
@@ -55,7 +124,7 @@ typedef struct ApexLib {
     void apex_register_##libname(void) {            \
         static ApexLibData entries[] = {           \
             __VA_ARGS__,                            \
-            {NULL, false, NULL}                     \
+            { .name = NULL }                        \
         };                                          \
         for (int i = 0; entries[i].name != NULL; i++) {             \
             apexLib_add(#libname, entries[i].name, entries[i]);  \
@@ -64,6 +133,8 @@ typedef struct ApexLib {
 
 extern void apexLib_add(const char *libname, const char *fnname, ApexLibData data);
 extern ApexLibData apexLib_get(const char *libname, const char *fnname);
+extern bool apexLib_checkargs(ApexVM *vm, const char *libname, const char *fnname,
+                              const ApexLibData *data, const ApexValue *args, int argc);
 extern void apexLib_init(void);
 extern void apexLib_free(void);
 
@@ -0,0 +1,515 @@
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "apexLoad.h"
+#include "apexLex.h"
+#include "apexParse.h"
+#include "apexMem.h"
+#include "apexStr.h"
+#include "apexErr.h"
+
+/*
+ * The loader parses the files a program includes on worker threads while the
+ * program is being compiled. Parsing a file reveals the files it includes in
+ * turn, so files are queued as they are found, starting with the includes of
+ * the main file, and the workers parse them in that order. Each file is
+ * parsed into an arena of its own, so the workers share nothing but the
+ * queue and the string table.
+ *
+ * The compiler still decides when and whether a file is compiled, so code is
+ * generated in the same order as when files were parsed on demand. When it
+ * reaches an include statement, it takes the file's unit from the loader,
+ * waiting for a worker that is parsing it or parsing it itself if no worker
+ * has started on it yet. Workers stay at most a window of units ahead of the
+ * compiler, which bounds the memory held by parsed but uncompiled files. With
+ * a single thread, files are parsed on demand exactly as before.
+ *
+ * The errors reported while a file is parsed are collected and written out
+ * when the file is taken, so they appear in the same order as well. Files
+ * that cannot be read are left to compile_include, which reports them at
+ * the include statement.
+ */
+
+#define DEFAULT_THREAD_COUNT 4
+#define UNITS_AHEAD_PER_THREAD 4
+#define READ_CHUNK_SIZE 4096
+
+/**
+ * Returns the number of threads, including the main thread, that parse
+ * files.
+ *
+ * The count is taken from the APEX_THREADS environment variable if it is
+ * set, or else from the number of online processors.
+ */
+static int thread_limit(void) {
+    const char *env = getenv("APEX_THREADS");
+    long count = 0;
+
+    if (env && *env) {
+        count = strtol(env, NULL, 10);
+    } else {
+#ifdef _SC_NPROCESSORS_ONLN
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        count = DEFAULT_THREAD_COUNT;
+#endif
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    return count > 64 ? 64 : (int)count;
+}
+
+/**
+ * Initializes an empty loader.
+ *
+ * @param loader The loader to initialize.
+ */
+void apexLoad_init(ApexLoader *loader) {
+    loader->units = NULL;
+    loader->unit_count = 0;
+    loader->unit_size = 0;
+    loader->next = 0;
+    loader->ahead = 0;
+    loader->thread_count = 0;
+    loader->thread_max = thread_limit() - 1;
+    loader->window = loader->thread_max * UNITS_AHEAD_PER_THREAD;
+    loader->threads = loader->thread_max ? apexMem_alloc(sizeof(pthread_t) * loader->thread_max) : NULL;
+    loader->idle = 0;
+    loader->done = false;
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->cond, NULL);
+}
+
+/**
+ * Resolves the path of an included file.
+ *
+ * A relative include path is taken relative to the directory of the
+ * including file, unless that file was given by an absolute path.
+ *
+ * @param filepath The path of the including file.
+ * @param incpath The path given to the include statement.
+ * @return The path to open, which the caller must free.
+ */
+char *apexLoad_resolve(const char *filepath, const char *incpath) {
+    const char *lslash = strrchr(filepath, '/');
+#ifdef _WIN32
+    if (!lslash) {
+        lslash = strrchr(filepath, '\\');
+    }
+#endif
+    size_t dir_len = 0;
+    if (lslash && filepath[0] != '/') {
+        dir_len = lslash - filepath + 1;
+    }
+
+    size_t path_len = dir_len + strlen(incpath) + 1;
+    char *path = apexMem_alloc(path_len);
+    snprintf(path, path_len, "%.*s%s", (int)dir_len, filepath, incpath);
+    return path;
+}
+
+/**
+ * Returns the canonical path of a file.
+ *
+ * Paths that name the same file share a canonical path, which is interned so
+ * that paths can be compared by pointer. A path that cannot be resolved is
+ * its own canonical path.
+ *
+ * @param path The path of the file.
+ * @return The interned canonical path.
+ */
+const char *apexLoad_canonical(const char *path) {
+    int saved_errno = errno;
+#ifdef _WIN32
+    char *real = _fullpath(NULL, path, 0);
+#else
+    char *real = realpath(path, NULL);
+#endif
+    const char *canonical = real ? real : path;
+    canonical = apexStr_new(canonical, strlen(canonical))->value;
+    free(real);
+    errno = saved_errno; // errors reported later would include it
+    return canonical;
+}
+
+/**
+ * Finds the unit of a file. The caller must hold the loader's lock.
+ *
+ * @param loader The loader to search.
+ * @param canonical The interned canonical path of the file.
+ * @return The unit of the file, or NULL if the file has not been found.
+ */
+static ApexUnit *find_unit(ApexLoader *loader, const char *canonical) {
+    for (int i = 0; i < loader->unit_count; i++) {
+        if (loader->units[i]->canonical == canonical) {
+            return loader->units[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Reads a file descriptor to its end into a buffer.
+ *
+ * @param source The source to fill in.
+ * @param fd The file descriptor to read.
+ * @param size The expected size of the contents, or 0 if unknown.
+ * @return true if the contents were read, false otherwise.
+ */
+static bool read_source(ApexSource *source, int fd, size_t size) {
+    size_t len = 0;
+    size = size ? size + 1 : READ_CHUNK_SIZE;
+    char *buffer = apexMem_alloc(size);
+
+    for (;;) {
+        if (len == size) {
+            size *= 2;
+            buffer = apexMem_realloc(buffer, size);
+        }
+        ssize_t n = read(fd, buffer + len, size - len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 || len + n > INT_MAX) {
+            errno = n < 0 ? errno : EFBIG;
+            free(buffer);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    source->text = buffer;
+    source->length = len;
+    return true;
+}
+
+/**
+ * Opens the source code of a file.
+ *
+ * A regular file is mapped read-only, so the lexer works on the page cache
+ * directly and only the strings it interns are copied. Pipes, terminals and
+ * files that cannot be mapped are read into a buffer instead. Sources are
+ * limited to INT_MAX bytes, which is what the lexer can address.
+ *
+ * @param source The source to open.
+ * @param path The path of the file.
+ * @return true if the file was opened, false with errno set otherwise.
+ */
+bool apexLoad_open(ApexSource *source, const char *path) {
+    int saved_errno = errno;
+    struct stat st;
+    bool ok;
+
+    source->text = NULL;
+    source->length = 0;
+    source->mapped = false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        if (st.st_size > INT_MAX) {
+            close(fd);
+            errno = EFBIG;
+            return false;
+        }
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            source->text = map;
+            source->length = st.st_size;
+            source->mapped = true;
+            close(fd);
+            errno = saved_errno;
+            return true;
+        }
+        ok = read_source(source, fd, st.st_size);
+    } else {
+        ok = read_source(source, fd, 0);
+    }
+    int read_errno = errno;
+    close(fd);
+    errno = ok ? saved_errno : read_errno;
+    return ok;
+}
+
+/**
+ * Releases the source code of a file.
+ *
+ * @param source The source to close.
+ */
+void apexLoad_close(ApexSource *source) {
+    if (source->mapped) {
+        munmap((void *)source->text, source->length);
+    } else {
+        free((char *)source->text);
+    }
+    source->text = NULL;
+    source->length = 0;
+    source->mapped = false;
+}
+
+static void *run_worker(void *arg);
+
+/**
+ * Queues an included file for parsing unless it has been found before.
+ *
+ * An idle worker thread is woken for the file if there is one, or else a
+ * new worker thread is started while the pool has room for it. If no thread
+ * can be started, the file waits for the next thread that finishes a unit,
+ * or for the compiler to reach it.
+ *
+ * @param loader The loader.
+ * @param filename The file name of the including file.
+ * @param incpath The path given to the include statement.
+ */
+static void add_unit(ApexLoader *loader, const char *filename, const char *incpath) {
+    char *path = apexLoad_resolve(filename, incpath);
+    const char *canonical = apexLoad_canonical(path);
+
+    pthread_mutex_lock(&loader->lock);
+    if (find_unit(loader, canonical)) {
+        pthread_mutex_unlock(&loader->lock);
+        free(path);
+        return;
+    }
+
+    ApexUnit *unit = apexMem_alloc(sizeof(ApexUnit));
+    unit->canonical = canonical;
+    unit->filename = filename;
+    unit->path = path;
+    unit->source.text = NULL;
+    unit->source.length = 0;
+    unit->source.mapped = false;
+    unit->program = NULL;
+    unit->errors = NULL;
+    unit->state = UNIT_QUEUED;
+    unit->ahead = false;
+    apexMem_arenainit(&unit->arena, NULL);
+
+    if (loader->unit_count == loader->unit_size) {
+        loader->unit_size = loader->unit_size ? loader->unit_size * 2 : 8;
+        loader->units = apexMem_realloc(loader->units, sizeof(ApexUnit *) * loader->unit_size);
+    }
+    loader->units[loader->unit_count++] = unit;
+
+    if (loader->idle) {
+        pthread_cond_broadcast(&loader->cond);
+    } else if (loader->thread_count < loader->thread_max &&
+               pthread_create(&loader->threads[loader->thread_count], NULL, run_worker, loader) == 0) {
+        loader->thread_count++;
+    }
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/**
+ * Queues the files included anywhere in an AST.
+ *
+ * Include statements are found wherever they occur, including inside
+ * function bodies and conditional branches, since the compiler compiles
+ * every include statement it reaches.
+ *
+ * @param loader The loader.
+ * @param node The AST to search.
+ */
+static void find_includes(ApexLoader *loader, AST *node) {
+    while (node) {
+        if (node->type == AST_INCLUDE) {
+            add_unit(loader, node->srcloc.filename, node->value.strval->value);
+        }
+        find_includes(loader, node->left);
+        find_includes(loader, node->next);
+        if (node->val_is_ast) {
+            find_includes(loader, node->value.ast_node);
+        }
+        node = node->right;
+    }
+}
+
+/**
+ * Reads and parses the file of a unit, then queues the files it includes.
+ *
+ * The file is lexed with the file name of the including file, which is the
+ * name compile_include gives the lexer of an included file. Errors are
+ * collected in the unit rather than written to stderr.
+ *
+ * @param loader The loader.
+ * @param unit The unit to parse.
+ */
+static void parse_unit(ApexLoader *loader, ApexUnit *unit) {
+    Lexer lexer;
+    Parser parser;
+    size_t errors_len;
+    int saved_errno = errno;
+
+    if (!apexLoad_open(&unit->source, unit->path)) {
+        errno = saved_errno;
+        return;
+    }
+    FILE *errors = open_memstream(&unit->errors, &errors_len);
+    apexErr_setstream(errors);
+    init_lexer(&lexer, unit->filename, unit->source.text, unit->source.length);
+    init_parser(&parser, &lexer, &unit->arena);
+    unit->program = parse_program(&parser);
+    apexErr_setstream(NULL);
+    if (errors) {
+        fclose(errors);
+    }
+    if (unit->program) {
+        find_includes(loader, unit->program);
+    }
+}
+
+/**
+ * Returns the next queued unit, or NULL if no unit is queued. The caller
+ * must hold the loader's lock.
+ *
+ * Units are handed out in the order they were found, which is close to the
+ * order in which the compiler reaches them.
+ */
+static ApexUnit *next_unit(ApexLoader *loader) {
+    while (loader->next < loader->unit_count) {
+        ApexUnit *unit = loader->units[loader->next];
+        if (unit->state == UNIT_QUEUED) {
+            return unit;
+        }
+        loader->next++;
+    }
+    return NULL;
+}
+
+/**
+ * The entry point of a worker thread.
+ *
+ * A worker parses queued units while fewer than a window of units are
+ * waiting for the compiler, and sleeps otherwise, until the loader is freed.
+ */
+static void *run_worker(void *arg) {
+    ApexLoader *loader = arg;
+    ApexUnit *unit;
+
+    pthread_mutex_lock(&loader->lock);
+    while (!loader->done) {
+        if (loader->ahead < loader->window && (unit = next_unit(loader))) {
+            unit->state = UNIT_PARSING;
+            unit->ahead = true;
+            loader->ahead++;
+            pthread_mutex_unlock(&loader->lock);
+            parse_unit(loader, unit);
+            pthread_mutex_lock(&loader->lock);
+            unit->state = UNIT_PARSED;
+            pthread_cond_broadcast(&loader->cond);
+        } else {
+            loader->idle++;
+            pthread_cond_wait(&loader->cond, &loader->lock);
+            loader->idle--;
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+/**
+ * Starts parsing the files included by a program.
+ *
+ * The string table is shared between threads from now on until the loader
+ * is freed.
+ *
+ * @param loader The loader.
+ * @param program The AST of the program's main file.
+ */
+void apexLoad_start(ApexLoader *loader, AST *program) {
+    apexStr_setshared(true);
+    find_includes(loader, program);
+}
+
+/**
+ * Takes the parsed unit of an included file and reports the errors found
+ * while parsing it.
+ *
+ * If no worker has started on the file, it is parsed by the calling thread;
+ * if a worker is parsing it, the call waits for the worker to finish. Each
+ * unit is taken at most once, and the caller releases its AST once it has
+ * been compiled; a file included again is parsed by the caller.
+ *
+ * @param loader The loader.
+ * @param canonical The interned canonical path of the file.
+ * @return The parsed unit, or NULL if the file was not found by the loader
+ *         or its unit was already taken.
+ */
+ApexUnit *apexLoad_take(ApexLoader *loader, const char *canonical) {
+    pthread_mutex_lock(&loader->lock);
+    ApexUnit *unit = find_unit(loader, canonical);
+    if (unit && unit->state == UNIT_QUEUED) {
+        unit->state = UNIT_PARSING;
+        pthread_mutex_unlock(&loader->lock);
+        parse_unit(loader, unit);
+        pthread_mutex_lock(&loader->lock);
+        unit->state = UNIT_PARSED;
+    }
+    while (unit && unit->state == UNIT_PARSING) {
+        pthread_cond_wait(&loader->cond, &loader->lock);
+    }
+    if (unit && unit->state == UNIT_TAKEN) {
+        unit = NULL;
+    } else if (unit) {
+        unit->state = UNIT_TAKEN;
+        if (unit->ahead) {
+            loader->ahead--;
+            pthread_cond_broadcast(&loader->cond);
+        }
+    }
+    pthread_mutex_unlock(&loader->lock);
+
+    if (unit && unit->errors) {
+        fputs(unit->errors, stderr);
+    }
+    return unit;
+}
+
+/**
+ * Stops the worker threads and releases the units of a loader along with
+ * their sources and ASTs.
+ *
+ * @param loader The loader to free.
+ */
+void apexLoad_free(ApexLoader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->done = true;
+    pthread_cond_broadcast(&loader->cond);
+    pthread_mutex_unlock(&loader->lock);
+    for (int i = 0; i < loader->thread_count; i++) {
+        pthread_join(loader->threads[i], NULL);
+    }
+    apexStr_setshared(false);
+
+    for (int i = 0; i < loader->unit_count; i++) {
+        ApexUnit *unit = loader->units[i];
+        apexMem_arenafree(&unit->arena);
+        apexLoad_close(&unit->source);
+        free(unit->path);
+        free(unit->errors);
+        free(unit);
+    }
+    free(loader->units);
+    free(loader->threads);
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->cond);
+    loader->units = NULL;
+    loader->threads = NULL;
+    loader->unit_count = loader->unit_size = loader->thread_count = 0;
+}
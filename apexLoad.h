@@ -0,0 +1,71 @@
+#ifndef APEX_LOAD_H
+#define APEX_LOAD_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "apexAST.h"
+#include "apexMem.h"
+
+/**
+ * The source code of a file, mapped into memory where possible.
+ */
+typedef struct ApexSource {
+    const char *text; /** The source code, not NUL-terminated, or NULL */
+    size_t length; /** The length of the source code */
+    bool mapped; /** Whether the text is a read-only mapping of the file */
+} ApexSource;
+
+/**
+ * The parse state of an included file.
+ */
+typedef enum {
+    UNIT_QUEUED,  /** Waiting to be parsed */
+    UNIT_PARSING, /** Being parsed */
+    UNIT_PARSED,  /** Parsed, or found to be unreadable */
+    UNIT_TAKEN    /** Handed to the compiler, which released its AST */
+} ApexUnitState;
+
+/**
+ * A file included by the program, parsed ahead of code generation.
+ */
+typedef struct ApexUnit {
+    const char *canonical; /** The interned canonical path of the file */
+    const char *filename; /** The file name recorded in source locations */
+    char *path; /** The path the file is opened with */
+    ApexSource source; /** The source code, without text if the file could not be read */
+    ApexArena arena; /** The arena holding the file's tokens and AST */
+    AST *program; /** The parsed program, or NULL if parsing failed */
+    char *errors; /** The errors reported while parsing, or NULL */
+    ApexUnitState state; /** The parse state of the file */
+    bool ahead; /** Whether a worker thread parsed the file */
+} ApexUnit;
+
+/**
+ * The files included by a program and the threads that parse them.
+ */
+typedef struct ApexLoader {
+    ApexUnit **units; /** The included files, in the order they were found */
+    int unit_count; /** Number of units */
+    int unit_size; /** Capacity of the units */
+    int next; /** Index of the first unit that may still be queued */
+    int ahead; /** Number of units parsed by workers and not yet taken */
+    int window; /** Maximum number of units parsed ahead */
+    pthread_t *threads; /** The worker threads */
+    int thread_count; /** Number of worker threads */
+    int thread_max; /** Maximum number of worker threads */
+    int idle; /** Number of worker threads waiting for a unit */
+    bool done; /** Whether the worker threads should exit */
+    pthread_mutex_t lock; /** Guards the units and the fields above */
+    pthread_cond_t cond; /** Signalled when a unit is added, parsed or taken */
+} ApexLoader;
+
+extern void apexLoad_init(ApexLoader *loader);
+extern void apexLoad_start(ApexLoader *loader, AST *program);
+extern ApexUnit *apexLoad_take(ApexLoader *loader, const char *canonical);
+extern bool apexLoad_open(ApexSource *source, const char *path);
+extern void apexLoad_close(ApexSource *source);
+extern char *apexLoad_resolve(const char *filepath, const char *incpath);
+extern const char *apexLoad_canonical(const char *path);
+extern void apexLoad_free(ApexLoader *loader);
+
+#endif
@@ -1,6 +1,62 @@
 #include <stdlib.h>
+#include "apexMem.h"
 #include "apexErr.h"
 
+#define POOL_GRANULE 16
+#define POOL_SLAB_SIZE 16384
+#define ARENA_ALIGN 16
+#define ARENA_CHUNK_SIZE 65536
+
+/**
+ * A block on a pool's free list. Freed records are threaded through their
+ * own storage, so the free list costs no extra memory.
+ */
+typedef struct PoolBlock {
+    struct PoolBlock *next; /** The next free block */
+} PoolBlock;
+
+/**
+ * A slab of blocks for a single pool. The header is padded to a granule so
+ * that blocks keep the alignment of the slab itself.
+ */
+typedef struct PoolSlab {
+    struct PoolSlab *next; /** The next slab of the pool */
+} PoolSlab;
+
+/**
+ * A pool of fixed-size records of one type.
+ */
+typedef struct {
+    size_t block_size; /** The size class of the pool's records */
+    PoolBlock *free_list; /** Blocks freed and ready to be reused */
+    PoolSlab *slabs; /** The slabs owned by the pool */
+    char *bump; /** The next unused block in the newest slab */
+    char *bump_end; /** The end of the newest slab */
+#ifdef APEX_MEM_STATS
+    size_t allocs; /** The number of allocations made from the pool */
+    size_t frees; /** The number of records returned to the pool */
+    size_t live_bytes; /** The number of bytes currently allocated */
+    size_t peak_bytes; /** The largest value live_bytes has reached */
+#endif
+} Pool;
+
+/**
+ * A chunk of arena memory. The header is padded to ARENA_ALIGN bytes and the
+ * usable memory follows it.
+ */
+struct ApexArenaChunk {
+    struct ApexArenaChunk *next; /** The next chunk of the arena */
+    size_t size; /** The number of usable bytes in the chunk */
+};
+
+static Pool pools[APEX_POOL_COUNT];
+
+#ifdef APEX_MEM_STATS
+static const char *pool_names[APEX_POOL_COUNT] = {
+    "symbol", "scope", "array", "object", "fn", "typed"
+};
+#endif
+
 /**
  * Allocate memory of the given size, or abort if out of memory.
  *
@@ -52,4 +108,241 @@ void *apexMem_realloc(void *p, size_t size) {
         exit(EXIT_FAILURE);
     }
     return q;
-}
\ No newline at end of file
+}
+
+#ifndef APEX_MEM_MALLOC
+/**
+ * Carves a new slab for a pool and makes it the pool's bump region.
+ *
+ * @param pool The pool that needs more blocks.
+ */
+static void pool_grow(Pool *pool) {
+    size_t blocks = POOL_SLAB_SIZE / pool->block_size;
+    if (blocks == 0) {
+        blocks = 1;
+    }
+    PoolSlab *slab = apexMem_alloc(POOL_GRANULE + blocks * pool->block_size);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->bump = (char *)slab + POOL_GRANULE;
+    pool->bump_end = pool->bump + blocks * pool->block_size;
+}
+#endif
+
+/**
+ * Allocate a fixed-size record from the pool for its type, or abort if out
+ * of memory.
+ *
+ * Every pool serves a single size class, set by the first allocation and
+ * rounded up to POOL_GRANULE bytes. A record is taken from the pool's free
+ * list if one is available, otherwise it is carved from the pool's newest
+ * slab. When built with APEX_MEM_MALLOC, records are allocated with
+ * apexMem_alloc instead, so the two can be compared.
+ *
+ * @param type The pool to allocate from.
+ * @param size The size of the record, which must be the same for every
+ *             allocation from a pool.
+ *
+ * @return A pointer to uninitialized storage for the record.
+ */
+void *apexMem_poolalloc(ApexPool type, size_t size) {
+    Pool *pool = &pools[type];
+#ifdef APEX_MEM_STATS
+    pool->allocs++;
+    pool->live_bytes += size;
+    if (pool->live_bytes > pool->peak_bytes) {
+        pool->peak_bytes = pool->live_bytes;
+    }
+#endif
+#ifdef APEX_MEM_MALLOC
+    (void)pool;
+    return apexMem_alloc(size);
+#else
+    if (pool->free_list) {
+        PoolBlock *block = pool->free_list;
+        pool->free_list = block->next;
+        return block;
+    }
+    if (!pool->block_size) {
+        pool->block_size = (size + POOL_GRANULE - 1) & ~(size_t)(POOL_GRANULE - 1);
+    }
+    if (pool->bump == pool->bump_end) {
+        pool_grow(pool);
+    }
+    void *p = pool->bump;
+    pool->bump += pool->block_size;
+    return p;
+#endif
+}
+
+/**
+ * Return a record allocated with apexMem_poolalloc to its pool.
+ *
+ * @param type The pool the record was allocated from.
+ * @param p The record to free. If NULL, this function does nothing.
+ * @param size The size the record was allocated with.
+ */
+void apexMem_poolfree(ApexPool type, void *p, size_t size) {
+    if (!p) {
+        return;
+    }
+    Pool *pool = &pools[type];
+#ifdef APEX_MEM_STATS
+    pool->frees++;
+    pool->live_bytes -= size;
+#else
+    (void)size;
+#endif
+#ifdef APEX_MEM_MALLOC
+    (void)pool;
+    free(p);
+#else
+    PoolBlock *block = p;
+    block->next = pool->free_list;
+    pool->free_list = block;
+#endif
+}
+
+/**
+ * Release the slabs of every pool.
+ *
+ * This is called once, at the end of the program, after which no pooled
+ * record may be used. When built with APEX_MEM_STATS, the allocation
+ * statistics of every pool are reported on stderr first.
+ */
+void apexMem_freepools(void) {
+#ifdef APEX_MEM_STATS
+    fprintf(stderr, "%-8s %12s %12s %12s %12s\n", "pool", "allocs", "live", "live bytes", "peak bytes");
+    for (int i = 0; i < APEX_POOL_COUNT; i++) {
+        Pool *pool = &pools[i];
+        fprintf(stderr, "%-8s %12zu %12zu %12zu %12zu\n", pool_names[i], pool->allocs,
+            pool->allocs - pool->frees, pool->live_bytes, pool->peak_bytes);
+    }
+#endif
+    for (int i = 0; i < APEX_POOL_COUNT; i++) {
+        Pool *pool = &pools[i];
+        PoolSlab *slab = pool->slabs;
+        while (slab) {
+            PoolSlab *next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        pool->slabs = NULL;
+        pool->free_list = NULL;
+        pool->bump = pool->bump_end = NULL;
+    }
+}
+
+/**
+ * Initialize an empty arena.
+ *
+ * @param arena The arena to initialize.
+ * @param parent The enclosing arena, or NULL for a root arena.
+ */
+void apexMem_arenainit(ApexArena *arena, ApexArena *parent) {
+    arena->chunks = NULL;
+    arena->spare = NULL;
+    arena->ptr = arena->end = NULL;
+    arena->parent = parent;
+}
+
+/**
+ * Returns the root of an arena's chain of parents.
+ */
+static ApexArena *arena_root(ApexArena *arena) {
+    while (arena->parent) {
+        arena = arena->parent;
+    }
+    return arena;
+}
+
+/**
+ * Gives an arena a new chunk with room for at least size bytes.
+ *
+ * A spare chunk of the root arena is reused if one is large enough,
+ * otherwise a new chunk is allocated.
+ *
+ * @param arena The arena that needs more memory.
+ * @param size The number of bytes the arena needs.
+ */
+static void arena_grow(ApexArena *arena, size_t size) {
+    ApexArena *root = arena_root(arena);
+    ApexArenaChunk **link = &root->spare;
+    ApexArenaChunk *chunk = NULL;
+
+    while (*link) {
+        if ((*link)->size >= size) {
+            chunk = *link;
+            *link = chunk->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    if (!chunk) {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = apexMem_alloc(ARENA_ALIGN + chunk_size);
+        chunk->size = chunk_size;
+    }
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->ptr = (char *)chunk + ARENA_ALIGN;
+    arena->end = arena->ptr + chunk->size;
+}
+
+/**
+ * Allocate memory from an arena, or abort if out of memory.
+ *
+ * The memory stays valid until the arena is released and cannot be freed
+ * on its own.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ *
+ * @return A pointer to uninitialized memory aligned to ARENA_ALIGN bytes.
+ */
+void *apexMem_arenaalloc(ApexArena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if ((size_t)(arena->end - arena->ptr) < size) {
+        arena_grow(arena, size);
+    }
+    void *p = arena->ptr;
+    arena->ptr += size;
+    return p;
+}
+
+/**
+ * Release every allocation made from an arena.
+ *
+ * The chunks of a child arena are kept by its root arena for reuse, while
+ * a root arena frees its chunks along with the spare ones. The arena is
+ * left empty and can be used again.
+ *
+ * @param arena The arena to release.
+ */
+void apexMem_arenafree(ApexArena *arena) {
+    ApexArenaChunk *chunk = arena->chunks;
+    if (arena->parent) {
+        ApexArena *root = arena_root(arena);
+        while (chunk) {
+            ApexArenaChunk *next = chunk->next;
+            chunk->next = root->spare;
+            root->spare = chunk;
+            chunk = next;
+        }
+    } else {
+        while (chunk) {
+            ApexArenaChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        chunk = arena->spare;
+        while (chunk) {
+            ApexArenaChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        arena->spare = NULL;
+    }
+    arena->chunks = NULL;
+    arena->ptr = arena->end = NULL;
+}
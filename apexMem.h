@@ -3,8 +3,43 @@
 
 #include <stdio.h>
 
+/**
+ * The pools of fixed-size records allocated with apexMem_poolalloc.
+ */
+typedef enum {
+    APEX_POOL_SYMBOL,
+    APEX_POOL_SCOPE,
+    APEX_POOL_ARRAY,
+    APEX_POOL_OBJECT,
+    APEX_POOL_FN,
+    APEX_POOL_TYPED,
+    APEX_POOL_COUNT
+} ApexPool;
+
+typedef struct ApexArenaChunk ApexArenaChunk;
+
+/**
+ * A bump allocator whose allocations are all released together.
+ *
+ * A child arena is released before its parent. Its chunks are handed to the
+ * root arena on release so that later children can reuse them.
+ */
+typedef struct ApexArena {
+    ApexArenaChunk *chunks; /** The chunks in use, newest first */
+    ApexArenaChunk *spare; /** Released chunks kept for reuse */
+    char *ptr; /** The next free byte in the newest chunk */
+    char *end; /** The end of the newest chunk */
+    struct ApexArena *parent; /** The enclosing arena, or NULL */
+} ApexArena;
+
 extern void *apexMem_alloc(size_t size);
 extern void *apexMem_calloc(size_t count, size_t size);
 extern void *apexMem_realloc(void *p, size_t size);
+extern void *apexMem_poolalloc(ApexPool type, size_t size);
+extern void apexMem_poolfree(ApexPool type, void *p, size_t size);
+extern void apexMem_freepools(void);
+extern void apexMem_arenainit(ApexArena *arena, ApexArena *parent);
+extern void *apexMem_arenaalloc(ApexArena *arena, size_t size);
+extern void apexMem_arenafree(ApexArena *arena);
 
 #endif
\ No newline at end of file
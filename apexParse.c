@@ -6,15 +6,10 @@
 #include "apexErr.h"
 #include "apexStr.h"
 
-static AST *parse_logical(Parser *parser);
 static AST *parse_expression(Parser *parser);
 static AST *parse_function_call(Parser *parser);
 static AST *parse_primary(Parser *parser);
 static AST *parse_unary(Parser *parser);
-static AST *parse_factor(Parser *parser) ;
-static AST *parse_bitwise(Parser *parser);
-static AST *parse_term(Parser *parser);
-static AST *parse_comparison(Parser *parser);
 static AST *parse_assignment(Parser *parser);
 static AST *parse_block(Parser *parser);
 static AST *parse_if_statement(Parser *parser);
@@ -25,51 +20,103 @@ static AST *parse_return_statement(Parser *parser);
 static AST *parse_function_declaration(Parser *parser);
 static AST *parse_statement(Parser *parser);
 
+#define LOOKAHEAD_INIT_SIZE 8
+
 #define TOKEN_UNEXPECTED(parser, token) \
-    apexErr_syntax(parser->lexer->srcloc, "unexpected token '%s'", token->str->value)
+    apexErr_syntax(parser->current_token->srcloc, "unexpected token '%.*s'", token->length, token->start)
 
 #define TOKEN_EXPECTED(parser, type)        \
     apexErr_syntax(                         \
-        parser->lexer->srcloc,              \
-        "expected '%s' but found '%s'",     \
+        parser->current_token->srcloc,      \
+        "expected '%s' but found '%.*s'",   \
         get_token_str(type)->value,         \
-        parser->current_token->str->value)  \
+        parser->current_token->length,      \
+        parser->current_token->start)       \
+/**
+ * Reads the next token from the lexer into the lookahead buffer.
+ *
+ * The buffer is a ring whose size is a power of two. When it is full, it
+ * is replaced by one twice the size, with the buffered tokens moved to
+ * the front in order.
+ *
+ * @param parser A pointer to the Parser whose buffer is filled.
+ */
+static void fill_lookahead(Parser *parser) {
+    int mask = parser->lookahead_size - 1;
+    if (parser->lookahead_count == parser->lookahead_size) {
+        int new_size = parser->lookahead_size * 2;
+        Token *lookahead = apexMem_arenaalloc(parser->arena, sizeof(Token) * new_size);
+        for (int i = 0; i < parser->lookahead_count; i++) {
+            lookahead[i] = parser->lookahead[(parser->lookahead_head + i) & mask];
+        }
+        parser->lookahead = lookahead;
+        parser->lookahead_size = new_size;
+        parser->lookahead_head = 0;
+        parser->current_token = &lookahead[0];
+        mask = new_size - 1;
+    }
+
+    parser->lookahead[(parser->lookahead_head + parser->lookahead_count) & mask] = get_next_token(parser->lexer);
+    parser->lookahead_count++;
+}
+
+/**
+ * Makes the next token in the stream the current token.
+ *
+ * The next token is taken from the lookahead buffer, which is refilled from
+ * the lexer only if it holds no further tokens.
+ *
+ * @param parser A pointer to the Parser to advance.
+ */
+static void advance_token(Parser *parser) {
+    parser->lookahead_head = (parser->lookahead_head + 1) & (parser->lookahead_size - 1);
+    parser->lookahead_count--;
+    if (parser->lookahead_count == 0) {
+        fill_lookahead(parser);
+    }
+    parser->current_token = &parser->lookahead[parser->lookahead_head];
+}
+
 /**
  * Initializes a Parser with the provided Lexer.
  *
  * This function sets up the Parser by assigning it the given Lexer and
  * fetching the first token from the Lexer to initialize the current token.
+ * Tokens and AST nodes are allocated from the given arena, so everything
+ * the parser produces is released together with the arena.
  *
  * @param parser A pointer to the Parser structure to initialize.
  * @param lexer A pointer to the Lexer structure to be used by the Parser.
+ * @param arena The arena to allocate tokens and AST nodes from.
  */
-void init_parser(Parser *parser, Lexer *lexer) {
+void init_parser(Parser *parser, Lexer *lexer, ApexArena *arena) {
     parser->lexer = lexer;
-    parser->current_token = get_next_token(lexer);
+    parser->arena = arena;
+    parser->lookahead = apexMem_arenaalloc(arena, sizeof(Token) * LOOKAHEAD_INIT_SIZE);
+    parser->lookahead_size = LOOKAHEAD_INIT_SIZE;
+    parser->lookahead_head = 0;
+    parser->lookahead_count = 0;
+    fill_lookahead(parser);
+    parser->current_token = &parser->lookahead[0];
 }
 
 /**
  * Peeks ahead in the token stream by a specified number of tokens.
  *
- * This function creates a backup of the current lexer state and retrieves
- * the token that is 'count' tokens ahead in the input stream without
- * modifying the parser's current token state. The retrieved token is returned,
- * allowing the parser to look ahead in the token stream for decision making.
+ * This function returns the token that is 'count' tokens ahead of the
+ * current token without modifying the parser's current token state. Tokens
+ * are lexed once into the lookahead buffer and kept there until they are
+ * consumed, so peeking at a buffered token is a constant-time index.
  *
  * @param parser A pointer to the Parser containing the lexer and tokens.
  * @param count The number of tokens to look ahead in the token stream.
  * @return A Token representing the token 'count' positions ahead in the stream.
  */
 static Token peek_token(Parser *parser, int count) {
-    Lexer backup_lexer = *parser->lexer;
-    Token *next_token;
-    Token next;
-    while (count--) {
-        next_token = get_next_token(&backup_lexer);
-        next = *next_token;
-        free_token(next_token);
+    while (parser->lookahead_count <= count) {
+        fill_lookahead(parser);
     }
-    return next;
+    return parser->lookahead[(parser->lookahead_head + count) & (parser->lookahead_size - 1)];
 }
 
 /**
@@ -107,8 +154,7 @@ while(0)
  * Consumes the current token if it matches the given type.
  *
  * This macro checks if the parser's current token matches the specified
- * type. If it does, the current token is freed, and the next token is
- * retrieved from the lexer. If the token does not match and incomplete
+ * type. If it does, the parser advances to the next token. If the token does not match and incomplete
  * code is not allowed, a syntax error is reported. If incomplete code 
  * is allowed and the current token is an EOF, it returns NULL.
  *
@@ -118,21 +164,20 @@ while(0)
  */
 #define CONSUME(PARSER, TYPE, ALLOW_INCOMPLETE) do {                    \
     if (match(PARSER, TYPE)) {                                          \
-        free_token(PARSER->current_token);                              \
-        PARSER->current_token = get_next_token(PARSER->lexer);          \
+        advance_token(PARSER);                                          \
     } else if (!PARSER->allow_incomplete) {                             \
         TOKEN_EXPECTED(PARSER, TYPE);                                   \
         return NULL;                                                    \
     } else if (match(PARSER, TOKEN_EOF)) {                              \
         if (!ALLOW_INCOMPLETE) {                                        \
             TOKEN_EXPECTED(PARSER, TYPE);                               \
-            return create_error_ast();                                  \
+            return create_error_ast(PARSER->arena);                     \
         } else {                                                        \
             return NULL;                                                \
         }                                                               \
     } else {                                                            \
         TOKEN_EXPECTED(PARSER, TYPE);                                   \
-        return create_error_ast();                                      \
+        return create_error_ast(PARSER->arena);                         \
     }                                                                   \
 } while (0)
 
@@ -162,58 +207,83 @@ static AST *append_ast(AST *list, AST *new_node) {
 }
 
 /**
- * Parses an equality expression from the input tokens.
- *
- * This function parses an equality expression as a series of comparisons
- * joined by equality operators. The left operand is the result of the
- * previous comparison, and the right operand is the result of the next
- * comparison. If the current token is not an equality operator, the
- * function returns the result of the comparison.
- *
- * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed equality expression.
+ * Binding strength of the binary operators, from loosest to tightest.
  */
-static AST *parse_equality(Parser *parser) {
-    AST *left = parse_comparison(parser); 
-    RETURN_ON_ERROR(left);
-    TokenType operator = parser->current_token->type;
-    while (operator == TOKEN_EQUAL_EQUAL || operator == TOKEN_NOT_EQUAL) {
-        CONSUME(parser, operator, false);
-        AST *right = parse_comparison(parser);
-        RETURN_ON_ERROR(right);
-        left = CREATE_AST_ZERO(
-            operator == TOKEN_EQUAL_EQUAL ? AST_BIN_EQ : AST_BIN_NE, 
-            left, right, parser->current_token->srcloc);
-        operator = parser->current_token->type;
-    }
-    return left;
-}
+typedef enum {
+    PREC_NONE,          /** Not a binary operator */
+    PREC_LOGICAL,       /** && || */
+    PREC_EQUALITY,      /** == != */
+    PREC_COMPARISON,    /** < > <= >= */
+    PREC_BITWISE,       /** & | */
+    PREC_TERM,          /** + - */
+    PREC_FACTOR         /** * / % */
+} Precedence;
 
 /**
- * Parses a logical expression from the input tokens.
+ * Describes how a token parses when it appears as a binary operator.
+ */
+typedef struct {
+    Precedence precedence; /** The binding strength of the operator */
+    ASTNodeType node_type; /** The type of the node the operator produces */
+} BinaryOperator;
+
+/* Binary operators indexed by token type; other tokens have PREC_NONE. */
+static const BinaryOperator binary_operators[TOKEN_EOF + 1] = {
+    [TOKEN_AND] = {PREC_LOGICAL, AST_LOGICAL_EXPR},
+    [TOKEN_OR] = {PREC_LOGICAL, AST_LOGICAL_EXPR},
+    [TOKEN_EQUAL_EQUAL] = {PREC_EQUALITY, AST_BIN_EQ},
+    [TOKEN_NOT_EQUAL] = {PREC_EQUALITY, AST_BIN_NE},
+    [TOKEN_LESS] = {PREC_COMPARISON, AST_BIN_LT},
+    [TOKEN_GREATER] = {PREC_COMPARISON, AST_BIN_GT},
+    [TOKEN_LESS_EQUAL] = {PREC_COMPARISON, AST_BIN_LE},
+    [TOKEN_GREATER_EQUAL] = {PREC_COMPARISON, AST_BIN_GE},
+    [TOKEN_AMP] = {PREC_BITWISE, AST_BIN_BITWISE_AND},
+    [TOKEN_PIPE] = {PREC_BITWISE, AST_BIN_BITWISE_OR},
+    [TOKEN_PLUS] = {PREC_TERM, AST_BIN_ADD},
+    [TOKEN_MINUS] = {PREC_TERM, AST_BIN_SUB},
+    [TOKEN_STAR] = {PREC_FACTOR, AST_BIN_MUL},
+    [TOKEN_SLASH] = {PREC_FACTOR, AST_BIN_DIV},
+    [TOKEN_PERCENT] = {PREC_FACTOR, AST_BIN_MOD}
+};
+
+/**
+ * Parses a binary expression from the input tokens.
  *
- * This function parses a logical expression as a series of equality
- * comparisons joined by logical operators. The left operand is the result
- * of the previous comparison, and the right operand is the result of the
- * next comparison.
+ * This is a precedence climbing (Pratt) parser driven by the
+ * binary_operators table. It parses a unary expression as the left operand,
+ * then keeps folding in operators that bind at least as tightly as
+ * min_precedence. The right operand of each operator is parsed with a
+ * higher minimum precedence, which makes all binary operators
+ * left-associative. Adding an operator only takes a table entry.
  *
  * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed logical expression.
+ * @param min_precedence The loosest operator precedence to consume.
+ * @return A pointer to an AST node representing the parsed expression.
  */
-static AST *parse_logical(Parser *parser) {
-    AST *left = parse_equality(parser);
+static AST *parse_binary(Parser *parser, Precedence min_precedence) {
+    AST *left = parse_unary(parser);
     RETURN_ON_ERROR(left);
-    while (match(parser, TOKEN_AND) || match(parser, TOKEN_OR)) {
+
+    for (;;) {
         TokenType operator = parser->current_token->type;
+        const BinaryOperator *binop = &binary_operators[operator];
+        if (binop->precedence == PREC_NONE || binop->precedence < min_precedence) {
+            return left;
+        }
         CONSUME(parser, operator, false);
-        AST *right = parse_equality(parser);
+        AST *right = parse_binary(parser, binop->precedence + 1);
         RETURN_ON_ERROR(right);
-        left = CREATE_AST_STR(
-            AST_LOGICAL_EXPR, left, right, 
-            get_token_str(operator),
-            parser->current_token->srcloc);
+        if (binop->node_type == AST_LOGICAL_EXPR) {
+            left = CREATE_AST_STR(parser->arena,
+                AST_LOGICAL_EXPR, left, right,
+                get_token_str(operator),
+                parser->current_token->srcloc);
+        } else {
+            left = CREATE_AST_ZERO(parser->arena,
+                binop->node_type, left, right,
+                parser->current_token->srcloc);
+        }
     }
-    return left;
 }
 
 /**
@@ -230,7 +300,7 @@ static AST *parse_logical(Parser *parser) {
  */
 static AST *parse_ternary_expression(Parser *parser) {
     // Parse the condition expression;
-    AST *condition = parse_logical(parser);
+    AST *condition = parse_binary(parser, PREC_LOGICAL);
     RETURN_ON_ERROR(condition);
 
     if (!match(parser, TOKEN_QUESTION)) {
@@ -244,7 +314,7 @@ static AST *parse_ternary_expression(Parser *parser) {
 
     if (!match(parser, TOKEN_COLON)) {
         if (!parser->allow_incomplete) {
-            apexErr_syntax(parser->lexer->srcloc, "expected ':' after true expression in ternary");
+            apexErr_syntax(parser->current_token->srcloc, "expected ':' after true expression in ternary");
         }
         return NULL;
     }
@@ -256,7 +326,7 @@ static AST *parse_ternary_expression(Parser *parser) {
     RETURN_ON_ERROR(false_expr);
 
     // Create and return the AST node for the ternary expression
-    return CREATE_AST_AST(
+    return CREATE_AST_AST(parser->arena,
         AST_TERNARY, condition, true_expr, false_expr,
         parser->current_token->srcloc);
 }
@@ -281,12 +351,12 @@ static AST *parse_closure(Parser *parser) {
     AST *params = NULL;
     CONSUME(parser, TOKEN_IDENT, true);
     while (!match(parser, TOKEN_RPAREN)) {        
-        AST *param = CREATE_AST_STR(
+        AST *param = CREATE_AST_STR(parser->arena,
             AST_VAR, NULL, NULL, 
             parser->current_token->str, 
             parser->current_token->srcloc);
 
-        params = CREATE_AST_ZERO(
+        params = CREATE_AST_ZERO(parser->arena,
             AST_PARAMETER_LIST, param, params, 
             parser->current_token->srcloc);
 
@@ -297,14 +367,14 @@ static AST *parse_closure(Parser *parser) {
     CONSUME(parser, TOKEN_RPAREN, true);
     AST *body = parse_block(parser);
     RETURN_ON_ERROR(body);
-    return CREATE_AST_ZERO(AST_CLOSURE, params, body, srcloc);
+    return CREATE_AST_ZERO(parser->arena, AST_CLOSURE, params, body, srcloc);
 }
 
 /**
  * Parses an expression from the input tokens.
  *
- * This function is a wrapper around parse_logical, and will parse a logical
- * expression (i.e. a series of equality comparisons joined by logical operators).
+ * This function parses either a closure or a ternary expression, which in
+ * turn parses binary expressions through parse_binary.
  *
  * @param parser A pointer to the Parser containing the tokens to be parsed.
  * @return A pointer to an AST node representing the parsed expression, or an
@@ -337,7 +407,7 @@ static AST *parse_fn_args(Parser *parser) {
         AST *arg = parse_expression(parser);
         RETURN_ON_ERROR(arg);
 
-        args = CREATE_AST_ZERO(
+        args = CREATE_AST_ZERO(parser->arena,
             AST_ARGUMENT_LIST, args, arg,
             parser->current_token->srcloc);
         
@@ -345,14 +415,14 @@ static AST *parse_fn_args(Parser *parser) {
             CONSUME(parser, TOKEN_COMMA, false);
         } else if (match(parser, TOKEN_EOF)) {
             if (!parser->allow_incomplete) {
-                apexErr_syntax(parser->lexer->srcloc, "expected ',' or ')' in argument list.");
+                apexErr_syntax(parser->current_token->srcloc, "expected ',' or ')' in argument list.");
             }
             return NULL;
         }
     }
     CONSUME(parser, TOKEN_RPAREN, true);
     if (!args) {
-        args = CREATE_AST_ZERO(
+        args = CREATE_AST_ZERO(parser->arena,
             AST_ARGUMENT_LIST, NULL, NULL, 
             parser->current_token->srcloc);
     }
@@ -378,13 +448,13 @@ static AST *parse_function_call(Parser *parser) {
     if (!match(parser, TOKEN_IDENT)) {
         if (!parser->allow_incomplete) {
             apexErr_syntax(
-                parser->lexer->srcloc,  
+                parser->current_token->srcloc,  
                 "expected function name before '('.");
         }
         return NULL;
     }
 
-    AST *function_name = CREATE_AST_STR(
+    AST *function_name = CREATE_AST_STR(parser->arena,
         AST_VAR, NULL, NULL, 
         parser->current_token->str,
         parser->current_token->srcloc);
@@ -395,7 +465,7 @@ static AST *parse_function_call(Parser *parser) {
     AST *arguments = parse_fn_args(parser);
     RETURN_ON_ERROR(arguments);
 
-    return CREATE_AST_ZERO(
+    return CREATE_AST_ZERO(parser->arena,
         AST_FN_CALL, function_name, arguments,
         parser->current_token->srcloc);
 }
@@ -417,7 +487,7 @@ static AST *parse_function_call(Parser *parser) {
  *         an error node if a syntax error is encountered.
  */
 static AST *parse_library_member(Parser *parser) {
-    AST *lib_name = CREATE_AST_STR(
+    AST *lib_name = CREATE_AST_STR(parser->arena,
         AST_VAR, NULL, NULL,
         parser->current_token->str,
         parser->current_token->srcloc);
@@ -425,17 +495,17 @@ static AST *parse_library_member(Parser *parser) {
     CONSUME(parser, TOKEN_COLON, false);
 
     if (!match(parser, TOKEN_IDENT)) {
-        apexErr_syntax(parser->lexer->srcloc, "expected identifier after ':'");
-        return parser->allow_incomplete ? create_error_ast() : NULL;
+        apexErr_syntax(parser->current_token->srcloc, "expected identifier after ':'");
+        return parser->allow_incomplete ? create_error_ast(parser->arena) : NULL;
     }
 
-    AST *member_name = CREATE_AST_STR(
+    AST *member_name = CREATE_AST_STR(parser->arena,
         AST_VAR, NULL, NULL,
         parser->current_token->str,
         parser->current_token->srcloc);
     CONSUME(parser, TOKEN_IDENT, false);
     if (!match(parser, TOKEN_LPAREN)) {
-        return CREATE_AST_ZERO(
+        return CREATE_AST_ZERO(parser->arena,
             AST_LIB_MEMBER, lib_name, member_name,
             parser->current_token->srcloc);
     }
@@ -443,7 +513,7 @@ static AST *parse_library_member(Parser *parser) {
     AST *arguments = parse_fn_args(parser);
     RETURN_ON_ERROR(arguments);
 
-    return CREATE_AST_AST(
+    return CREATE_AST_AST(parser->arena,
         AST_LIB_CALL, lib_name, member_name, arguments,
         parser->current_token->srcloc);
 }
@@ -467,8 +537,8 @@ static AST *parse_member(Parser *parser, AST *node) {
     while (match(parser, TOKEN_DOT)) {
         CONSUME(parser, TOKEN_DOT, false);
         if (parser->current_token->type != TOKEN_IDENT) {
-            apexErr_syntax(parser->lexer->srcloc, "expected member name after '.'");
-            return parser->allow_incomplete ? create_error_ast() : NULL;
+            apexErr_syntax(parser->current_token->srcloc, "expected member name after '.'");
+            return parser->allow_incomplete ? create_error_ast(parser->arena) : NULL;
         }
         ApexString *name = parser->current_token->str;
         
@@ -482,30 +552,30 @@ static AST *parse_member(Parser *parser, AST *node) {
 
             if (name == apexStr_new("new", 3)) {
                 if (node->type != AST_VAR && node->type != AST_MEMBER_ACCESS) {
-                    apexErr_syntax(parser->lexer->srcloc, "'new' can only be used in object contexts");
-                    return parser->allow_incomplete ? create_error_ast() : NULL;
+                    apexErr_syntax(parser->current_token->srcloc, "'new' can only be used in object contexts");
+                    return parser->allow_incomplete ? create_error_ast(parser->arena) : NULL;
                 }
                 // Handle obj.new(...) as object creation
-                node = CREATE_AST_ZERO(
+                node = CREATE_AST_ZERO(parser->arena,
                     AST_NEW, node, arguments,
                     parser->current_token->srcloc);
             } else {
                 // General member function call
-                AST *member = CREATE_AST_STR(
+                AST *member = CREATE_AST_STR(parser->arena,
                     AST_VAR, NULL, NULL, name, 
                     parser->current_token->srcloc);
-                node = CREATE_AST_ZERO(
+                node = CREATE_AST_ZERO(parser->arena,
                     AST_MEMBER_ACCESS, node, member, 
                     parser->current_token->srcloc);
-                node = CREATE_AST_ZERO(
+                node = CREATE_AST_ZERO(parser->arena,
                     AST_FN_CALL, node, arguments, 
                     parser->current_token->srcloc);
             }        
         } else {
-            AST *member = CREATE_AST_STR(
+            AST *member = CREATE_AST_STR(parser->arena,
                 AST_VAR, NULL, NULL, name, 
                 parser->current_token->srcloc);
-            node = CREATE_AST_ZERO(
+            node = CREATE_AST_ZERO(parser->arena,
                 AST_MEMBER_ACCESS, node, member, 
                 parser->current_token->srcloc);
         }
@@ -530,7 +600,7 @@ static AST *parse_ident(Parser *parser) {
     if (peek_token(parser, 1).type == TOKEN_COLON) {
         return parse_library_member(parser);
     }
-    AST *node = CREATE_AST_STR(
+    AST *node = CREATE_AST_STR(parser->arena,
         AST_VAR, NULL, NULL, 
         parser->current_token->str, 
         parser->current_token->srcloc);
@@ -544,7 +614,7 @@ static AST *parse_ident(Parser *parser) {
         AST *index = parse_expression(parser);
         CONSUME(parser, TOKEN_RBRACKET, false);
 
-        node = CREATE_AST_ZERO(
+        node = CREATE_AST_ZERO(parser->arena,
             AST_ARRAY_ACCESS, node, index, 
             parser->current_token->srcloc);
     }
@@ -553,7 +623,7 @@ static AST *parse_ident(Parser *parser) {
         match(parser, TOKEN_MINUS_MINUS)) {
         TokenType operator = parser->current_token->type;
         CONSUME(parser, operator, false);
-        node = CREATE_AST_ZERO(
+        node = CREATE_AST_ZERO(parser->arena,
             operator == TOKEN_PLUS_PLUS ? AST_UNARY_INC : AST_UNARY_DEC, 
             node, NULL, parser->current_token->srcloc);
     }
@@ -575,7 +645,7 @@ static AST *parse_ident(Parser *parser) {
  *         an error node if a syntax error is encountered.
  */
 static AST *parse_array(Parser *parser) {
-    AST *node = CREATE_AST_ZERO(
+    AST *node = CREATE_AST_ZERO(parser->arena,
         AST_ARRAY, NULL, NULL,
         parser->current_token->srcloc);      
 
@@ -594,13 +664,13 @@ static AST *parse_array(Parser *parser) {
             AST *key = parse_expression(parser);
             CONSUME(parser, TOKEN_ARROW, false);
             AST *value = parse_expression(parser);
-            new_element = CREATE_AST_ZERO(
+            new_element = CREATE_AST_ZERO(parser->arena,
                 AST_KEY_VALUE_PAIR, key, value,
                 parser->current_token->srcloc);    
         } else { 
             // Parse an expression as an array element
             AST *value = parse_expression(parser);
-            new_element = CREATE_AST_ZERO(
+            new_element = CREATE_AST_ZERO(parser->arena,
                 AST_ELEMENT, NULL, value,
                 parser->current_token->srcloc);
         }
@@ -619,8 +689,8 @@ static AST *parse_array(Parser *parser) {
         if (match(parser, TOKEN_COMMA)) {
             CONSUME(parser, TOKEN_COMMA, false);
         } else if (!match(parser, TOKEN_RBRACKET)) {                     
-            apexErr_syntax(parser->lexer->srcloc, "expected ',' or ']' in array literal");            
-            return parser->allow_incomplete ? create_error_ast() : NULL;
+            apexErr_syntax(parser->current_token->srcloc, "expected ',' or ']' in array literal");            
+            return parser->allow_incomplete ? create_error_ast(parser->arena) : NULL;
         }
     }
     
@@ -649,7 +719,7 @@ static AST *parse_primary(Parser *parser) {
 
     switch (parser->current_token->type) {
     case TOKEN_INT:
-        node = CREATE_AST_STR(
+        node = CREATE_AST_STR(parser->arena,
             AST_INT, NULL, NULL, 
             parser->current_token->str, 
             parser->current_token->srcloc);
@@ -657,7 +727,7 @@ static AST *parse_primary(Parser *parser) {
         return node;
     
     case TOKEN_DBL:
-        node = CREATE_AST_STR(
+        node = CREATE_AST_STR(parser->arena,
             AST_DBL, NULL, NULL, 
             parser->current_token->str, 
             parser->current_token->srcloc);
@@ -665,7 +735,7 @@ static AST *parse_primary(Parser *parser) {
         return node;
 
     case TOKEN_STR:
-        node = CREATE_AST_STR(
+        node = CREATE_AST_STR(parser->arena,
             AST_STR, NULL, NULL, 
             parser->current_token->str, 
             parser->current_token->srcloc);
@@ -673,18 +743,18 @@ static AST *parse_primary(Parser *parser) {
         return node;
 
     case TOKEN_NULL:
-        node = CREATE_AST_STR(
+        node = CREATE_AST_STR(parser->arena,
             AST_NULL, NULL, NULL, 
-            parser->current_token->str, 
+            get_token_str(parser->current_token->type), 
             parser->current_token->srcloc);
         CONSUME(parser, TOKEN_NULL, false);
         return node;
 
     case TOKEN_TRUE: 
     case TOKEN_FALSE:
-        node = CREATE_AST_STR(
+        node = CREATE_AST_STR(parser->arena,
             AST_BOOL, NULL, NULL, 
-            parser->current_token->str, 
+            get_token_str(parser->current_token->type), 
             parser->current_token->srcloc);
         CONSUME(parser, parser->current_token->type, false);
         return node;
@@ -746,7 +816,7 @@ static AST *parse_unary(Parser *parser) {
         }
         node = parse_primary(parser);
         RETURN_ON_ERROR(node);
-        return CREATE_AST_ZERO(
+        return CREATE_AST_ZERO(parser->arena,
             node_type, NULL, node, 
             parser->current_token->srcloc);
     }
@@ -757,7 +827,7 @@ static AST *parse_unary(Parser *parser) {
         CONSUME(parser, operator, false);
         node = parse_primary(parser);
         RETURN_ON_ERROR(node);
-        return CREATE_AST_ZERO(
+        return CREATE_AST_ZERO(parser->arena,
             operator == TOKEN_PLUS_PLUS ? AST_UNARY_INC : AST_UNARY_DEC, 
             NULL, node, parser->current_token->srcloc);
     }
@@ -768,159 +838,13 @@ static AST *parse_unary(Parser *parser) {
         match(parser, TOKEN_MINUS_MINUS)) {
         TokenType operator = parser->current_token->type;   
         CONSUME(parser, operator, false);
-        return CREATE_AST_ZERO(
+        return CREATE_AST_ZERO(parser->arena,
             operator == TOKEN_PLUS_PLUS ? AST_UNARY_INC : AST_UNARY_DEC, 
             node, NULL, parser->current_token->srcloc);
     }
     return node;
 }
 
-/**
- * Parses a factor expression from the input tokens.
- *
- * This function handles parsing of factor expressions, which are composed
- * of unary expressions joined by multiplication (*) or division (/)
- * operators. It supports left-associative chaining of these operators,
- * creating a binary expression tree as a result.
- *
- * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed factor expression.
- */
-static AST *parse_factor(Parser *parser) {
-    AST *left = parse_unary(parser);
-    RETURN_ON_ERROR(left);
-    TokenType operator = parser->current_token->type;
-    while (operator == TOKEN_STAR || 
-           operator == TOKEN_SLASH ||
-           operator == TOKEN_PERCENT) {
-        ASTNodeType node_type;
-        switch (operator) {
-        case TOKEN_STAR:
-            node_type = AST_BIN_MUL;
-            break;
-        case TOKEN_SLASH:
-            node_type = AST_BIN_DIV;
-            break;
-        case TOKEN_PERCENT:
-            node_type = AST_BIN_MOD;
-            break;
-        default:
-            break;
-        }
-        CONSUME(parser, operator, false);
-        AST *right = parse_unary(parser);
-        RETURN_ON_ERROR(right);
-        left = CREATE_AST_ZERO(
-            node_type, left, right,
-            parser->current_token->srcloc);
-        operator = parser->current_token->type;
-    }
-    return left;
-}
-
-/**
- * Parses a bitwise expression from the input tokens.
- *
- * This function handles parsing of bitwise expressions, which are composed
- * of term expressions joined by bitwise AND (&) or bitwise OR (|)
- * operators. It supports left-associative chaining of these operators,
- * creating a binary expression tree as a result.
- *
- * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed bitwise expression.
- */
-static AST *parse_bitwise(Parser *parser) {
-    AST *left = parse_term(parser);
-    RETURN_ON_ERROR(left);
-    TokenType operator = parser->current_token->type;
-    while (operator == TOKEN_AMP ||operator == TOKEN_PIPE) {      
-        CONSUME(parser, operator, false);
-        AST *right = parse_factor(parser);
-        RETURN_ON_ERROR(right);
-        left = CREATE_AST_ZERO(
-            operator == TOKEN_AMP ? AST_BIN_BITWISE_AND : AST_BIN_BITWISE_OR, 
-            left, right, parser->current_token->srcloc);
-        operator = parser->current_token->type;
-    }
-    return left;
-}
-
-/**
- * Parses a term expression from the input tokens.
- *
- * This function handles parsing of term expressions, which are composed
- * of factor expressions joined by addition (+) or subtraction (-)
- * operators. It supports left-associative chaining of these operators,
- * creating a binary expression tree as a result.
- *
- * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed term expression.
- */
-static AST *parse_term(Parser *parser) {
-    AST *left = parse_factor(parser);
-    RETURN_ON_ERROR(left);
-    TokenType operator = parser->current_token->type;
-    while (operator == TOKEN_PLUS || operator == TOKEN_MINUS) {
-        CONSUME(parser, operator, false);
-        AST *right = parse_factor(parser);
-        RETURN_ON_ERROR(right);
-        left = CREATE_AST_ZERO(
-            operator == TOKEN_PLUS ? AST_BIN_ADD : AST_BIN_SUB, 
-            left, right, parser->current_token->srcloc);
-        operator = parser->current_token->type;
-    }
-    return left;
-}
-
-/**
- * Parses a comparison expression from the input tokens.
- *
- * This function handles parsing of comparison expressions, which are
- * composed of bitwise expressions joined by comparison operators.
- * It supports left-associative chaining of these operators, creating
- * a binary expression tree as a result.
- *
- * @param parser A pointer to the Parser containing the tokens to be parsed.
- * @return A pointer to an AST node representing the parsed comparison
- *         expression.
- */
-static AST *parse_comparison(Parser *parser) {
-    AST *left = parse_bitwise(parser);
-    RETURN_ON_ERROR(left);
-    TokenType operator = parser->current_token->type;
-
-    while (operator == TOKEN_LESS || 
-           operator == TOKEN_GREATER || 
-           operator == TOKEN_LESS_EQUAL || 
-           operator == TOKEN_GREATER_EQUAL) {
-        ASTNodeType node_type;
-        switch (operator) {
-        case TOKEN_LESS:
-            node_type = AST_BIN_LT;
-            break;
-        case TOKEN_GREATER:
-            node_type = AST_BIN_GT;
-            break;
-        case TOKEN_LESS_EQUAL:
-            node_type = AST_BIN_LE;
-            break;
-        case TOKEN_GREATER_EQUAL:
-            node_type = AST_BIN_GE;
-            break;
-        default:
-            break;
-        }
-        CONSUME(parser, operator, false);
-        AST *right = parse_bitwise(parser);   
-        RETURN_ON_ERROR(right); 
-        left = CREATE_AST_ZERO(
-            node_type, left, right,
-            parser->current_token->srcloc);
-        operator = parser->current_token->type;
-    }
-    return left;
-}
-
 /**
  * Parses an object literal from the input tokens.
  *
@@ -935,7 +859,7 @@ static AST *parse_comparison(Parser *parser) {
  *         literal, or an error node if a syntax error is encountered.
  */
 static AST *parse_object_literal(Parser *parser, ApexString *name) {
-    AST *node = CREATE_AST_STR(
+    AST *node = CREATE_AST_STR(parser->arena,
         AST_OBJECT, NULL, NULL, name,
         parser->current_token->srcloc);
 
@@ -945,7 +869,7 @@ static AST *parse_object_literal(Parser *parser, ApexString *name) {
         AST *value = NULL;
 
         if (match(parser, TOKEN_IDENT)) {
-            key = CREATE_AST_STR(
+            key = CREATE_AST_STR(parser->arena,
                 AST_STR, NULL, NULL, 
                 parser->current_token->str,
                 parser->current_token->srcloc);
@@ -956,7 +880,7 @@ static AST *parse_object_literal(Parser *parser, ApexString *name) {
                 ? parse_primary(parser)
                 : parse_expression(parser);
             
-            AST *key_value_pair = CREATE_AST_ZERO(
+            AST *key_value_pair = CREATE_AST_ZERO(parser->arena,
                 AST_OBJ_FIELD, key, value, 
                 parser->current_token->srcloc);
             node->right = append_ast(node->right, key_value_pair);
@@ -966,7 +890,7 @@ static AST *parse_object_literal(Parser *parser, ApexString *name) {
             CONSUME(parser, TOKEN_COMMA, false);
         } else if (!match(parser, TOKEN_RBRACE)) {
             if (!parser->allow_incomplete) {
-                apexErr_syntax(parser->lexer->srcloc, "expected ',' or '}' in object literal");
+                apexErr_syntax(parser->current_token->srcloc, "expected ',' or '}' in object literal");
             }
             return NULL;
         }
@@ -1018,7 +942,7 @@ static ASTNodeType get_assignment_node_type(TokenType operator) {
  */
 static AST *parse_assignment(Parser *parser) {
     if (!match(parser, TOKEN_IDENT)) {
-        apexErr_syntax(parser->lexer->srcloc, "invalid assignment target");
+        apexErr_syntax(parser->current_token->srcloc, "invalid assignment target");
         return NULL;
     }
 
@@ -1037,19 +961,19 @@ static AST *parse_assignment(Parser *parser) {
         if (match(parser, TOKEN_LBRACKET)) {
             AST *array_literal = parse_primary(parser);
             RETURN_ON_ERROR(array_literal);
-            return CREATE_AST_ZERO(
+            return CREATE_AST_ZERO(parser->arena,
                 node_type, left, array_literal, 
                 parser->current_token->srcloc);
         } else if (match(parser, TOKEN_LBRACE)) {
             AST *object_literal = parse_object_literal(parser, left->value.strval);
             RETURN_ON_ERROR(object_literal);
-            return CREATE_AST_ZERO(
+            return CREATE_AST_ZERO(parser->arena,
                 node_type, left, object_literal, 
                 parser->current_token->srcloc);
         } else {
             AST *value = parse_expression(parser);
             RETURN_ON_ERROR(value);
-            return CREATE_AST_ZERO(
+            return CREATE_AST_ZERO(parser->arena,
                 node_type, left, value,
                 parser->current_token->srcloc);
         }
@@ -1075,11 +999,11 @@ static AST *parse_assignment(Parser *parser) {
 
         AST *value = parse_expression(parser);
         RETURN_ON_ERROR(value);
-        AST *array_access = CREATE_AST_ZERO(
+        AST *array_access = CREATE_AST_ZERO(parser->arena,
             AST_ARRAY_ACCESS, left, index,
             parser->current_token->srcloc);
 
-        return CREATE_AST_ZERO(
+        return CREATE_AST_ZERO(parser->arena,
             node_type, array_access, value, 
             parser->current_token->srcloc);
     }
@@ -1112,7 +1036,7 @@ static AST *parse_block(Parser *parser) {
 
     if (match(parser, TOKEN_EOF)) {
         if (!parser->allow_incomplete) {
-            apexErr_syntax(parser->lexer->srcloc, "unexpected end of file in block");
+            apexErr_syntax(parser->current_token->srcloc, "unexpected end of file in block");
         } 
         return NULL;
     }
@@ -1129,7 +1053,7 @@ static AST *parse_block(Parser *parser) {
     }
     
     CONSUME(parser, TOKEN_RBRACE, true);    
-    return CREATE_AST_ZERO(AST_BLOCK, first_stmt, NULL, srcloc);
+    return CREATE_AST_ZERO(parser->arena, AST_BLOCK, first_stmt, NULL, srcloc);
 }
 
 /**
@@ -1149,7 +1073,7 @@ static AST *parse_include(Parser *parser) {
 
     if (!match(parser, TOKEN_STR)) {
         apexErr_syntax(
-            parser->lexer->srcloc,
+            parser->current_token->srcloc,
             "expected file path after 'include'");
         return NULL;
     }
@@ -1157,7 +1081,7 @@ static AST *parse_include(Parser *parser) {
     ApexString *filepath = parser->current_token->str;
     CONSUME(parser, TOKEN_STR, false);
 
-    return CREATE_AST_STR(
+    return CREATE_AST_STR(parser->arena,
         AST_INCLUDE, NULL, NULL, filepath,
         parser->current_token->srcloc);
 }
@@ -1215,7 +1139,7 @@ static AST *parse_if_statement(Parser *parser) {
         RETURN_ON_ERROR(elif_then_branch);
 
         // Create the `elif` AST node and link it as the `else` of the current structure
-        elif_node = CREATE_AST_AST(
+        elif_node = CREATE_AST_AST(parser->arena,
             AST_IF, elif_condition, elif_then_branch, NULL, 
             parser->current_token->srcloc);
 
@@ -1248,7 +1172,7 @@ static AST *parse_if_statement(Parser *parser) {
     }
 
     // Return the complete `if` AST node
-    return CREATE_AST_AST(AST_IF, condition, then_branch, else_branch, srcloc);
+    return CREATE_AST_AST(parser->arena, AST_IF, condition, then_branch, else_branch, srcloc);
 }
 
 /**
@@ -1311,8 +1235,8 @@ static AST *parse_switch_statement(Parser *parser) {
                 last_stmt = stmt;
             }
             
-            AST *case_body = CREATE_AST_ZERO(AST_BLOCK, first_stmt, NULL, srcloc);
-            AST *case_node = CREATE_AST_ZERO(AST_CASE, case_value, case_body, srcloc);
+            AST *case_body = CREATE_AST_ZERO(parser->arena, AST_BLOCK, first_stmt, NULL, srcloc);
+            AST *case_node = CREATE_AST_ZERO(parser->arena, AST_CASE, case_value, case_body, srcloc);
             cases = append_ast(cases, case_node);
 
         } else if (match(parser, TOKEN_DEFAULT)) {
@@ -1321,7 +1245,7 @@ static AST *parse_switch_statement(Parser *parser) {
 
             if (default_case) {
                 apexErr_syntax(
-                    parser->lexer->srcloc, 
+                    parser->current_token->srcloc, 
                     "multiple default cases are not allowed");
                 return NULL;
             }
@@ -1343,10 +1267,10 @@ static AST *parse_switch_statement(Parser *parser) {
                 }
                 last_stmt = stmt;
             }
-            default_case = CREATE_AST_ZERO(AST_BLOCK, first_stmt, NULL, srcloc);
+            default_case = CREATE_AST_ZERO(parser->arena, AST_BLOCK, first_stmt, NULL, srcloc);
         } else {
             apexErr_syntax(
-                parser->lexer->srcloc,
+                parser->current_token->srcloc,
                 "unexpected token '%s' in switch", 
                 get_token_str(parser->current_token->type)->value);
             return NULL;
@@ -1354,7 +1278,7 @@ static AST *parse_switch_statement(Parser *parser) {
     }
 
     CONSUME(parser, TOKEN_RBRACE, true);
-    return CREATE_AST_AST(AST_SWITCH, switch_value, cases, default_case, srcloc);
+    return CREATE_AST_AST(parser->arena, AST_SWITCH, switch_value, cases, default_case, srcloc);
 }
 
 /**
@@ -1381,7 +1305,7 @@ static AST *parse_while_statement(Parser *parser) {
         ? parse_block(parser) 
         : parse_statement(parser);
     RETURN_ON_ERROR(body);    
-    return CREATE_AST_ZERO(
+    return CREATE_AST_ZERO(parser->arena,
         AST_WHILE, condition, body,
         parser->current_token->srcloc);
 }
@@ -1432,9 +1356,9 @@ static AST *parse_for_statement(Parser *parser) {
         : parse_statement(parser);
     RETURN_ON_ERROR(body);
 
-    return CREATE_AST_AST(
+    return CREATE_AST_AST(parser->arena,
         AST_FOR, initialization, condition, 
-        CREATE_AST_ZERO(
+        CREATE_AST_ZERO(parser->arena,
             AST_BLOCK, increment, body,
             parser->current_token->srcloc),
         parser->current_token->srcloc);
@@ -1484,8 +1408,8 @@ static AST *parse_foreach_statement(Parser *parser) {
         : parse_statement(parser);
 
     RETURN_ON_ERROR(body);
-    return CREATE_AST_AST(
-        AST_FOREACH, key_var, value_var, CREATE_AST_AST(
+    return CREATE_AST_AST(parser->arena,
+        AST_FOREACH, key_var, value_var, CREATE_AST_AST(parser->arena,
             AST_FOREACH_IT, iterable, body, NULL, srcloc), 
         srcloc);
 }
@@ -1514,7 +1438,7 @@ static AST *parse_return_statement(Parser *parser) {
         expression = parse_expression(parser);
     }
     CONSUME(parser, TOKEN_SEMICOLON, false);
-    return CREATE_AST_ZERO(
+    return CREATE_AST_ZERO(parser->arena,
         AST_RETURN, expression, NULL,
         parser->current_token->srcloc);
 }
@@ -1545,13 +1469,13 @@ static AST *parse_function_declaration(Parser *parser) {
     if (!match(parser, TOKEN_IDENT)) {
         if (!parser->allow_incomplete) {
             apexErr_syntax(
-                parser->lexer->srcloc,
+                parser->current_token->srcloc,
                 "expected function name after 'fn'");
         }
         return NULL;
     }
 
-    AST *name = CREATE_AST_STR(
+    AST *name = CREATE_AST_STR(parser->arena,
         AST_VAR, NULL, NULL,
         parser->current_token->str,
         parser->current_token->srcloc);
@@ -1563,22 +1487,22 @@ static AST *parse_function_declaration(Parser *parser) {
         CONSUME(parser, TOKEN_DOT, false);
         if (!match(parser, TOKEN_IDENT)) {
             apexErr_syntax(
-                parser->lexer->srcloc,
+                parser->current_token->srcloc,
                 "expected member function name after '.'");
             return NULL;
         }
         if (parser->current_token->str == apexStr_new("new", 4)) {
             CONSUME(parser, TOKEN_IDENT, false);
-            name = CREATE_AST_STR(
+            name = CREATE_AST_STR(parser->arena,
                 AST_CTOR, name, NULL,
                 parser->current_token->str,
                 srcloc);
         } else {
-            AST *member_name = CREATE_AST_STR(
+            AST *member_name = CREATE_AST_STR(parser->arena,
                 AST_VAR, NULL, NULL,
                 parser->current_token->str,
                 parser->current_token->srcloc);
-            name = CREATE_AST_ZERO(
+            name = CREATE_AST_ZERO(parser->arena,
                 AST_MEMBER_FN, name, member_name,
                 srcloc);
             CONSUME(parser, TOKEN_IDENT, false);
@@ -1593,32 +1517,32 @@ static AST *parse_function_declaration(Parser *parser) {
         AST *param;
         if (match(parser, TOKEN_STAR)) {
             if (have_variadic) {
-                apexErr_syntax(parser->lexer->srcloc, "only one variadic parameter is allowed");
+                apexErr_syntax(parser->current_token->srcloc, "only one variadic parameter is allowed");
                 return NULL;
             }
             CONSUME(parser, TOKEN_STAR, true);
             if (!match(parser, TOKEN_IDENT)) {
-                apexErr_syntax(parser->lexer->srcloc, "expected parameter name after '*'");
+                apexErr_syntax(parser->current_token->srcloc, "expected parameter name after '*'");
                 return NULL;
             }
-            param = CREATE_AST_STR(
+            param = CREATE_AST_STR(parser->arena,
                 AST_VARIADIC, NULL, NULL,
                 parser->current_token->str,
                 parser->current_token->srcloc);
             have_variadic = true;
         } else if (match(parser, TOKEN_IDENT)) {
-            param = CREATE_AST_STR(
+            param = CREATE_AST_STR(parser->arena,
                 AST_VAR, NULL, NULL,
                 parser->current_token->str,
                 parser->current_token->srcloc);
         } else {
             if (!parser->allow_incomplete) {
-                apexErr_syntax(parser->lexer->srcloc, "expected parameter name");
+                apexErr_syntax(parser->current_token->srcloc, "expected parameter name");
             }
             return NULL;
         }
         
-        parameters = CREATE_AST_ZERO(
+        parameters = CREATE_AST_ZERO(parser->arena,
             AST_PARAMETER_LIST, param, parameters,
             parser->current_token->srcloc);
 
@@ -1631,7 +1555,7 @@ static AST *parse_function_declaration(Parser *parser) {
     CONSUME(parser, TOKEN_RPAREN, true);
     
     AST *body = parse_block(parser);
-    return CREATE_AST_AST(
+    return CREATE_AST_AST(parser->arena,
         AST_FN_DECL, name, body, 
         parameters, srcloc);
 }
@@ -1691,7 +1615,7 @@ static AST *parse_ident_statement(Parser *parser) {
         for (i = 2; next_token.type != TOKEN_RBRACKET; i++) {
             next_token = peek_token(parser, i);
             if (next_token.type == TOKEN_EOF) {
-                apexErr_syntax(parser->lexer->srcloc, "unexpected end of file");
+                apexErr_syntax(parser->current_token->srcloc, "unexpected end of file");
                 return NULL;
             }
         }
@@ -1771,7 +1695,7 @@ static AST *parse_statement(Parser *parser) {
 
     case TOKEN_CONTINUE:
         CONSUME(parser, TOKEN_CONTINUE, false);
-        stmt = CREATE_AST_ZERO(
+        stmt = CREATE_AST_ZERO(parser->arena,
             AST_CONTINUE, NULL, NULL,
             parser->current_token->srcloc);
         CONSUME(parser, TOKEN_SEMICOLON, false);
@@ -1779,7 +1703,7 @@ static AST *parse_statement(Parser *parser) {
 
     case TOKEN_BREAK:
         CONSUME(parser, TOKEN_BREAK, false);
-        stmt = CREATE_AST_ZERO(
+        stmt = CREATE_AST_ZERO(parser->arena,
             AST_BREAK, NULL, NULL, 
             parser->current_token->srcloc);
         CONSUME(parser, TOKEN_SEMICOLON, false);
@@ -1797,7 +1721,7 @@ static AST *parse_statement(Parser *parser) {
     }
 
     if (stmt && stmt->type != AST_STATEMENT && stmt->type != AST_ERROR) { 
-        stmt = CREATE_AST_ZERO(
+        stmt = CREATE_AST_ZERO(parser->arena,
             AST_STATEMENT, stmt, NULL,
             srcloc);
     }
@@ -1832,8 +1756,4 @@ AST *parse_program(Parser *parser) {
         last_stmt = stmt;        
     }
     return program;
-}
-
-void free_parser(Parser *parser) {
-    free_token(parser->current_token);
 }
\ No newline at end of file
@@ -11,11 +11,15 @@
 typedef struct {
     Lexer *lexer;            /** Pointer to the Lexer used for token generation. */
     Token *current_token;    /** Pointer to the current token being processed. */
+    Token *lookahead;        /** Ring buffer of the current and peeked tokens. */
+    int lookahead_size;      /** Capacity of the ring buffer, a power of two. */
+    int lookahead_head;      /** Index of the current token in the ring buffer. */
+    int lookahead_count;     /** Number of tokens held in the ring buffer. */
+    ApexArena *arena;        /** Arena for tokens and AST nodes. */
     bool allow_incomplete;   /** Flag indicating if incomplete code is allowed. */
 } Parser;
 
-extern void init_parser(Parser *parser, Lexer *lexer);
+extern void init_parser(Parser *parser, Lexer *lexer, ApexArena *arena);
 extern AST *parse_program(Parser *parser);
-extern void free_parser(Parser *parser);
 
 #endif
\ No newline at end of file
@@ -1,40 +1,74 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include "apexStr.h"
 #include "apexMem.h"
 #include "apexVal.h"
 #include "apexUtil.h"
 
 #define INIT_STRING_TABLE_SIZE 32
-#define STRING_TABLE_LOAD_FACTOR 0.75
+#define STRING_TABLE_LOAD_FACTOR 0.5
+
+#define STRING_CLASS_GRANULE 16
+#define STRING_CLASS_COUNT 8
+#define STRING_CLASS_MAX (STRING_CLASS_GRANULE * STRING_CLASS_COUNT)
+#define STRING_SLAB_SIZE 16384
+
+/**
+ * A slab of fixed-size string blocks for a single size class.
+ */
+typedef struct StringSlab {
+    struct StringSlab *next; /** The next slab in the size class */
+    size_t used; /** The number of bytes handed out from this slab */
+    char data[]; /** The slab's storage */
+} StringSlab;
 
 static ApexString **string_table;
 static size_t string_table_size = INIT_STRING_TABLE_SIZE;
 static size_t string_table_count = 0;
+static StringSlab *string_slabs[STRING_CLASS_COUNT];
+static pthread_mutex_t string_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool string_table_shared = false;
+
+/**
+ * Returns the number of bytes needed to store a string of the given length,
+ * including its header and NUL-terminator.
+ */
+#define string_block_size(len) (offsetof(ApexString, value) + (len) + 1)
 
 /**
- * Computes a hash value for a given string.
+ * Allocates storage for a string of the given length.
  *
- * This function takes a string and its length as input and calculates a hash value
- * using a combination of bitwise operations and modular arithmetic. The hash value
- * is computed by iteratively processing each character in the string with a specified
- * step size. The resulting hash value is then reduced modulo TABLE_SIZE to fit within
- * the hash table.
+ * Blocks up to STRING_CLASS_MAX bytes are carved out of per-size-class slabs,
+ * which keeps short identifiers and keys packed together without per-string
+ * allocator overhead. Interned strings live until the string table is freed,
+ * so slab blocks are never returned individually. Larger strings get their
+ * own allocation.
  *
- * @param str The input string to be hashed.
- * @param len The length of the input string.
- * @return An unsigned integer representing the hash value of the input string.
+ * @param len The length of the string to allocate.
+ * @return A pointer to uninitialized storage for the string.
  */
-static unsigned int hash_string(const char *str, size_t len) {
-    unsigned int h = (unsigned int)len; 
-    size_t step = (len >> 5) + 1;
-    size_t i;
-    for (i = 0; i < len; i += step) {
-        h = h ^ ((h << 5) + (h >> 2) + (unsigned char)str[i]);
+static ApexString *alloc_string(size_t len) {
+    size_t size = string_block_size(len);
+    if (size > STRING_CLASS_MAX) {
+        return apexMem_alloc(size);
+    }
+
+    int cls = (size - 1) / STRING_CLASS_GRANULE;
+    size_t block = (size_t)(cls + 1) * STRING_CLASS_GRANULE;
+    StringSlab *slab = string_slabs[cls];
+    if (!slab || slab->used + block > STRING_SLAB_SIZE) {
+        slab = apexMem_alloc(sizeof(StringSlab) + STRING_SLAB_SIZE);
+        slab->used = 0;
+        slab->next = string_slabs[cls];
+        string_slabs[cls] = slab;
     }
-    return h;
+    ApexString *str = (ApexString *)(slab->data + slab->used);
+    slab->used += block;
+    return str;
 }
 
 /**
@@ -51,22 +85,23 @@ void apexStr_inittable(void) {
  * Resizes the string table to twice its current size.
  *
  * This function is called when the load factor of the string table exceeds a
- * certain threshold (75%). It allocates a new array of strings with twice the
- * size of the current one, and rehashes all the strings in the table to their new
- * positions in the new array. Finally, it frees the old array and sets the
- * string table's size to the new size.
+ * certain threshold (50%). It allocates a new array of strings with twice the
+ * size of the current one, and reinserts all the strings in the table at their
+ * new positions in the new array using their cached hash. Finally, it frees
+ * the old array and sets the string table's size to the new size.
  */
 static void resize_string_table(void) {
-    int new_size = string_table_size * 2;
+    size_t new_size = string_table_size * 2;
+    size_t mask = new_size - 1;
     ApexString **new_table = apexMem_calloc(new_size, sizeof(ApexString *));
     for (size_t i = 0; i < string_table_size; i++) {
         ApexString *str = string_table[i];
-        while (str) {
-            unsigned int index = hash_string(str->value, str->len) % new_size;
-            ApexString *next = str->next;
-            str->next = new_table[index];
+        if (str) {
+            size_t index = str->hash & mask;
+            while (new_table[index]) {
+                index = (index + 1) & mask;
+            }
             new_table[index] = str;
-            str = next;
         }
     }
     free(string_table);
@@ -75,43 +110,99 @@ static void resize_string_table(void) {
 }
 
 /**
- * Saves a string in the string table.
+ * Looks up a string in the string table, inserting it if it is not there.
  *
- * This function takes a string and its length as input and attempts to find an
- * existing entry in the string table with the same length and contents. If
- * such an entry is found, the input string is freed and the existing entry is
- * returned. If no such entry is found, a new entry is created in the string
- * table with the given string and length, and the new entry is returned.
+ * The table uses open addressing with linear probing, so a lookup walks
+ * consecutive slots until it either finds a string with the same hash, length
+ * and contents, or reaches an empty slot, in which case a new string is
+ * created there with a copy of the given bytes.
  *
- * @param str The input string to be saved in the string table.
- * @param len The length of the input string.
- * @return A pointer to the ApexString structure representing the saved string
- *         in the string table.
+ * @param str The bytes of the string to intern.
+ * @param len The length of the string.
+ * @param hash The hash of the string's bytes.
+ * @return A pointer to the interned string.
  */
-ApexString *apexStr_save(char *str, size_t len) {    
-    unsigned int index = hash_string(str, len) % string_table_size;
-    ApexString *entry = string_table[index];
+static ApexString *insert_string(const char *str, size_t len, unsigned int hash) {
+    size_t mask = string_table_size - 1;
+    size_t index = hash & mask;
+    ApexString *entry;
 
-    while (entry != NULL) {
-        if (entry->len == len && strncmp(entry->value, str, len) == 0) {
-            free(str);
+    while ((entry = string_table[index])) {
+        if (entry->hash == hash && entry->len == len && memcmp(entry->value, str, len) == 0) {
             return entry;
         }
-        entry = entry->next;
+        index = (index + 1) & mask;
     }
 
-    ApexString *new_entry = apexMem_alloc(sizeof(ApexString));
-    new_entry->value = str;
-    new_entry->len = len;
-    new_entry->next = string_table[index];    
-    string_table[index] = new_entry;
+    entry = alloc_string(len);
+    entry->len = len;
+    entry->hash = hash;
+    memcpy(entry->value, str, len);
+    entry->value[len] = '\0';
+    string_table[index] = entry;
     string_table_count++;
 
     if ((float)string_table_count / string_table_size > STRING_TABLE_LOAD_FACTOR) {
         resize_string_table();
     }
 
-    return new_entry;
+    return entry;
+}
+
+/**
+ * Interns a string in the string table.
+ *
+ * While the table is shared between threads, every lookup holds the table's
+ * lock. The hash is computed before the lock is taken, so threads only
+ * serialize on the probe itself.
+ *
+ * @param str The bytes of the string to intern.
+ * @param len The length of the string.
+ * @return A pointer to the interned string.
+ */
+static ApexString *intern_string(const char *str, size_t len) {
+    unsigned int hash = apexUtil_hashbytes(str, len);
+    ApexString *entry;
+
+    if (!string_table_shared) {
+        return insert_string(str, len, hash);
+    }
+    pthread_mutex_lock(&string_table_lock);
+    entry = insert_string(str, len, hash);
+    pthread_mutex_unlock(&string_table_lock);
+    return entry;
+}
+
+/**
+ * Sets whether the string table is shared between threads.
+ *
+ * The front-end shares the table while included files are parsed on worker
+ * threads. Strings can only be interned from several threads at once while
+ * the table is shared; the flag itself must be changed while no other thread
+ * uses the table.
+ *
+ * @param shared true if other threads may intern strings, false otherwise.
+ */
+void apexStr_setshared(bool shared) {
+    string_table_shared = shared;
+}
+
+/**
+ * Saves a string in the string table.
+ *
+ * This function takes ownership of a heap-allocated buffer and its length,
+ * interns its contents and frees the buffer. If an equal string is already in
+ * the table, the existing entry is returned.
+ *
+ * @param str The input string to be saved in the string table.
+ * @param len The length of the input string.
+ * @return A pointer to the ApexString structure representing the saved string
+ *         in the string table.
+ */
+ApexString *apexStr_save(char *str, size_t len) {
+    ApexString *entry = intern_string(str, len);
+    free(str);
+    return entry;
 }
 
 /**
@@ -119,38 +210,15 @@ ApexString *apexStr_save(char *str, size_t len) {
  *
  * This function takes a string and its length as input and creates a new entry
  * in the string table if it does not already exist. If the string is already
- * in the table, the existing pointer is returned. The new string is allocated
- * with a size of n+1 to account for the null-terminator.
+ * in the table, the existing pointer is returned. The header and the bytes of
+ * a new string are stored in a single block with room for the NUL-terminator.
  *
  * @param str The string to add to the table.
  * @param len The length of the string.
  * @return A pointer to the newly allocated string in the string table.
  */
 ApexString *apexStr_new(const char *str, size_t len) {
-    unsigned int index = hash_string(str, len) % string_table_size;
-    ApexString *entry = string_table[index];
-
-    while (entry) {
-        if (entry->len == len && strncmp(entry->value, str, len) == 0) {
-            return entry;
-        }
-        entry = entry->next;
-    }
-
-    ApexString *new_entry = apexMem_alloc(sizeof(ApexString));
-    new_entry->value = apexMem_alloc(len + 1);
-    memcpy(new_entry->value, str, len);
-    new_entry->value[len] = '\0';
-    new_entry->len = len;
-    new_entry->next = string_table[index];
-    string_table[index] = new_entry;
-    string_table_count++;
-
-    if ((float)string_table_count / string_table_size > STRING_TABLE_LOAD_FACTOR) {
-        resize_string_table();
-    }
-
-    return new_entry;
+    return intern_string(str, len);
 }
 
 /**
@@ -183,20 +251,25 @@ ApexString *apexStr_cat(ApexString *str1, ApexString *str2) {
  * Frees the memory allocated for the string table.
  *
  * This function is called once, at the end of the program, to free the memory
- * allocated for the string table. It iterates over each entry in the table,
- * freeing the memory allocated for the string itself and the String structure
- * that holds it. It then sets the entry in the table to NULL.
+ * allocated for the string table. Strings too large for a size class are freed
+ * individually, then every slab is released along with the table itself.
  */
 void apexStr_freetable(void) {
     for (size_t i = 0; i < string_table_size; i++) {
         ApexString *entry = string_table[i];
-        while (entry != NULL) {
-            ApexString *next = entry->next;
-            free(entry->value);
+        if (entry && string_block_size(entry->len) > STRING_CLASS_MAX) {
             free(entry);
-            entry = next;
         }
         string_table[i] = NULL;
     }
+    for (int i = 0; i < STRING_CLASS_COUNT; i++) {
+        StringSlab *slab = string_slabs[i];
+        while (slab) {
+            StringSlab *next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        string_slabs[i] = NULL;
+    }
     free(string_table);
-}
\ No newline at end of file
+}
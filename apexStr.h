@@ -7,22 +7,23 @@
  * @brief A structure representing a string in the Apex language.
  *
  * This structure represents a string in the Apex language. It contains the
- * string's value and length, as well as a pointer to the next string in the
- * linked list.
+ * string's length and cached hash, followed by the string's bytes. A string
+ * is allocated as a single block, so the header and the characters share a
+ * cache line for short strings.
  */
 typedef struct ApexString {
-    /**
-     * @brief The string's value.
-     */
-    char *value;
     /**
      * @brief The string's length.
      */
     size_t len;
     /**
-     * @brief A pointer to the next string in the linked list.
+     * @brief The string's hash, computed once when it is interned.
+     */
+    unsigned int hash;
+    /**
+     * @brief The string's value, NUL-terminated.
      */
-    struct ApexString *next;
+    char value[];
 } ApexString;
 
 #include "apexVal.h"
@@ -33,6 +34,7 @@ extern void apexStr_inittable(void);
 extern ApexString *apexStr_new(const char *str, size_t len);
 extern ApexString *apexStr_save(char *str, size_t len);
 extern ApexString *apexStr_cat(ApexString *str1, ApexString *str2);
+extern void apexStr_setshared(bool shared);
 extern void apexStr_freetable(void);
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -6,27 +6,21 @@
 #include "apexMem.h"
 #include "apexStr.h"
 #include "apexVal.h"
+#include "apexUtil.h"
 
 #define SYMBOL_TABLE_LOAD_FACTOR 0.75
 
 /**
- * Computes a hash value for a given string.
+ * Computes a hash value for a symbol name.
  *
- * This function is a simple string hashing algorithm, which iteratively
- * processes each character in the string with a specified step size and
- * combines them using a bitwise operation. The resulting hash value is
- * then reduced modulo the size of the symbol table to fit within the table.
+ * Symbol names are interned strings and are compared by pointer, so the
+ * name's address is hashed rather than its characters.
  *
- * @param str The input string to be hashed.
- * @return An unsigned integer representing the hash value of the input string.
+ * @param name The interned symbol name.
+ * @return An unsigned integer representing the hash value of the name.
  */
-static unsigned int hash_string(const char *str) {
-    unsigned int hash = 0;
-    while (*str) {
-        hash = (hash << 5) + hash + (unsigned char)(*str);
-        str++;
-    }
-    return hash;
+static unsigned int hash_name(const char *name) {
+    return apexUtil_hashptr(name);
 }
 
 /**
@@ -49,7 +43,7 @@ static void resize_symbol_table(SymbolTable *table) {
         Symbol *current = table->symbols[i];
         while (current) {
             Symbol *next = current->next;
-            unsigned int hash = hash_string(current->name) % new_size;
+            unsigned int hash = hash_name(current->name) % new_size;
             current->next = symbols[hash];
             symbols[hash] = current;
             current = next;
@@ -90,7 +84,7 @@ void init_symbol_table(SymbolTable *table) {
  * @param value The value to assign to the symbol.
  */
 void apexSym_setglobal(SymbolTable *table, const char *name, ApexValue value) {
-    unsigned int hash = hash_string(name) % table->size;
+    unsigned int hash = hash_name(name) % table->size;
     Symbol *current = table->symbols[hash];
     while (current) {
         if (current->name == name) {
@@ -106,9 +100,9 @@ void apexSym_setglobal(SymbolTable *table, const char *name, ApexValue value) {
     apexVal_setassigned(value, true);
     apexVal_retain(value);
    
-    Symbol *symbol = apexMem_alloc(sizeof(Symbol));
+    Symbol *symbol = apexMem_poolalloc(APEX_POOL_SYMBOL, sizeof(Symbol));
     symbol->name = name;
-    symbol->addr = hash_string(name);
+    symbol->addr = hash_name(name);
     symbol->value = value;
     symbol->next = table->symbols[hash];
     table->symbols[hash] = symbol;
@@ -133,7 +127,7 @@ void apexSym_setglobal(SymbolTable *table, const char *name, ApexValue value) {
  *         no such symbol exists.
  */
 bool apexSym_getglobal(ApexValue *value, SymbolTable *table, const char *name) {
-    unsigned int hash = hash_string(name) % table->size;
+    unsigned int hash = hash_name(name) % table->size;
     Symbol *current = table->symbols[hash];
     
     while (current) {
@@ -164,7 +158,7 @@ void free_symbol_table(SymbolTable *table) {
         while (current) {
             Symbol *next = current->next;
             apexVal_release(current->value);
-            free(current);
+            apexMem_poolfree(APEX_POOL_SYMBOL, current, sizeof(Symbol));
             current = next;
         }
     }
@@ -184,10 +178,11 @@ void free_symbol_table(SymbolTable *table) {
  * @param stack The stack to push onto.
  */
 void push_scope(ScopeStack *stack) {
-    LocalScope *scope = apexMem_alloc(sizeof(LocalScope));
+    LocalScope *scope = apexMem_poolalloc(APEX_POOL_SCOPE, sizeof(LocalScope));
     init_symbol_table(&scope->table);
     scope->next = stack->top;
     scope->next_addr = 1;
+    scope->kept = false;
     stack->top = scope;
 }
 
@@ -195,7 +190,8 @@ void push_scope(ScopeStack *stack) {
  * Pops the top local scope off the stack.
  *
  * This function sets the top of the stack to the next scope down, and frees
- * the memory allocated for the current top scope and its symbol table.
+ * the memory allocated for the current top scope and its symbol table,
+ * unless the scope is kept to be pushed again.
  *
  * @param stack The stack to pop from.
  */
@@ -203,11 +199,22 @@ void pop_scope(ScopeStack *stack) {
     if (stack->top) {
         LocalScope *old_top = stack->top;
         stack->top = old_top->next;
-        free_symbol_table(&old_top->table);
-        free(old_top);
+        if (!old_top->kept) {
+            free_scope(old_top);
+        }
     }
 }
 
+/**
+ * Frees the memory allocated for a local scope and its symbol table.
+ *
+ * @param scope The scope to free.
+ */
+void free_scope(LocalScope *scope) {
+    free_symbol_table(&scope->table);
+    apexMem_poolfree(APEX_POOL_SCOPE, scope, sizeof(LocalScope));
+}
+
 /**
  * Sets the value of a local symbol in the current scope.
  *
@@ -221,7 +228,7 @@ void pop_scope(ScopeStack *stack) {
  */
 void apexSym_setlocal(ScopeStack *stack, const char *name, ApexValue value) {
     LocalScope *scope = stack->top;     
-    unsigned int hash = hash_string(name) % scope->table.size;
+    unsigned int hash = hash_name(name) % scope->table.size;
     Symbol *current = scope->table.symbols[hash];
     while (current) {
         if (current->name == name) {
@@ -237,9 +244,9 @@ void apexSym_setlocal(ScopeStack *stack, const char *name, ApexValue value) {
     apexVal_setassigned(value, true);
     apexVal_retain(value);
     
-    Symbol *symbol = apexMem_alloc(sizeof(Symbol));
+    Symbol *symbol = apexMem_poolalloc(APEX_POOL_SYMBOL, sizeof(Symbol));
     symbol->name = name;
-    symbol->addr = hash_string(name);
+    symbol->addr = hash_name(name);
     symbol->value = value;
     symbol->next = scope->table.symbols[hash];
     scope->table.symbols[hash] = symbol;
@@ -264,7 +271,7 @@ void apexSym_setlocal(ScopeStack *stack, const char *name, ApexValue value) {
  */
 bool apexSym_getlocal(ApexValue *value, ScopeStack *stack, const char *name) {
     LocalScope *scope = stack->top; 
-    unsigned int hash = hash_string(name) % scope->table.size;
+    unsigned int hash = hash_name(name) % scope->table.size;
     Symbol *current = scope->table.symbols[hash];
     
     while (current) {
@@ -303,4 +310,4 @@ void free_scope_stack(ScopeStack *stack) {
     while (stack->top) {
         pop_scope(stack);
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
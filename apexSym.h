@@ -35,6 +35,7 @@ typedef struct LocalScope {
     SymbolTable table;     /** Symbol table for the local scope */
     struct LocalScope *next; /** Pointer to the next local scope */
     SymbolAddr next_addr;  /** Next available address for symbols */
+    bool kept;             /** Whether popping the scope leaves it allocated */
 } LocalScope;
 
 /**
@@ -51,6 +52,7 @@ extern bool apexSym_getglobal(ApexValue *value, SymbolTable *table, const char *
 extern void init_scope_stack(ScopeStack *stack);
 extern void push_scope(ScopeStack *stack);
 extern void pop_scope(ScopeStack *stack);
+extern void free_scope(LocalScope *scope);
 extern void apexSym_setlocal(ScopeStack *stack, const char *name, ApexValue value);
 extern bool apexSym_getlocal(ApexValue *value, ScopeStack *stack, const char *name);
 extern void free_scope_stack(ScopeStack *stack);
@@ -0,0 +1,795 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "apexType.h"
+#include "apexStr.h"
+
+/*
+ * Type inference walks a program in the order its code is generated and
+ * tracks which variables are known to hold an int or a dbl, starting from
+ * literals, arithmetic on known operands and the library functions listed
+ * below. Each expression node is marked with the type it was proven to have,
+ * and the compiler emits instructions that skip the tag checks where both
+ * operands of an operator are known.
+ *
+ * Variables are tracked by name, since the compiler also resolves them by
+ * name. A function cannot see the locals of its caller, so calls leave the
+ * known types of locals alone. Top-level variables are globals, which
+ * functions only write when compiled in global context, after a nested
+ * function or closure; if the program has such functions, or includes
+ * files whose functions are not seen here, every call forgets what is known
+ * about the globals. The types known where control flow joins are those
+ * known on every path, and loops are walked until the types at their start
+ * no longer change.
+ */
+
+#define MAX_FACTS 32
+#define MAX_LOOP_PASSES 8
+
+/**
+ * The proven type of a variable.
+ */
+typedef struct {
+    ApexString *name; /** The interned name of the variable */
+    ASTValueType type; /** The type of its value */
+} TypeFact;
+
+/**
+ * The variables whose types are known at a point of the program.
+ */
+typedef struct {
+    TypeFact facts[MAX_FACTS]; /** The known variables */
+    int count; /** Number of facts */
+} TypeState;
+
+/**
+ * The types known where the loop being walked is left or restarted early.
+ */
+typedef struct {
+    TypeState breaks; /** Types known at every break */
+    TypeState continues; /** Types known at every continue */
+    bool have_breaks; /** Whether the loop has a break */
+    bool have_continues; /** Whether the loop has a continue */
+} LoopTypes;
+
+/**
+ * The state of a type inference walk.
+ */
+typedef struct {
+    LoopTypes *loop; /** The loop that break and continue refer to, or NULL */
+    bool in_function; /** Whether variables are compiled as locals */
+    bool calls_write_globals; /** Whether calls may assign global variables */
+    bool writes_globals; /** Whether functions that assign globals were found */
+    bool failed; /** Whether the program's control flow was not understood */
+} TypeContext;
+
+/**
+ * Library functions whose return type does not depend on their arguments.
+ */
+static const struct {
+    const char *lib;
+    const char *fn;
+    ASTValueType type;
+} lib_types[] = {
+    { "std", "int", AST_TYPE_INT },
+    { "std", "len", AST_TYPE_INT },
+    { "std", "dbl", AST_TYPE_DBL },
+    { "math", "abs", AST_TYPE_INT },
+    { "math", "fabs", AST_TYPE_DBL },
+    { "math", "ceil", AST_TYPE_DBL },
+    { "math", "floor", AST_TYPE_DBL },
+    { "math", "exp", AST_TYPE_DBL },
+    { "math", "fmod", AST_TYPE_DBL },
+    { "math", "ldexp", AST_TYPE_DBL },
+    { "math", "cos", AST_TYPE_DBL },
+    { "math", "cosh", AST_TYPE_DBL },
+    { "math", "acos", AST_TYPE_DBL },
+    { "math", "sin", AST_TYPE_DBL },
+    { "math", "asin", AST_TYPE_DBL },
+    { "math", "tan", AST_TYPE_DBL },
+    { "math", "atan", AST_TYPE_DBL },
+    { "math", "atan2", AST_TYPE_DBL }
+};
+
+static ASTValueType infer_expression(TypeContext *ctx, AST *node, TypeState *state);
+static void infer_statement(TypeContext *ctx, AST *node, TypeState *state);
+
+/**
+ * Returns the known type of a variable.
+ */
+static ASTValueType lookup_type(const TypeState *state, const ApexString *name) {
+    for (int i = 0; i < state->count; i++) {
+        if (state->facts[i].name == name) {
+            return state->facts[i].type;
+        }
+    }
+    return AST_TYPE_UNKNOWN;
+}
+
+/**
+ * Records the type of a variable after it is assigned.
+ *
+ * When the state is full, the oldest fact is forgotten to make room, which
+ * only loses precision.
+ */
+static void set_type(TypeState *state, ApexString *name, ASTValueType type) {
+    for (int i = 0; i < state->count; i++) {
+        if (state->facts[i].name == name) {
+            if (type == AST_TYPE_UNKNOWN) {
+                state->facts[i] = state->facts[--state->count];
+            } else {
+                state->facts[i].type = type;
+            }
+            return;
+        }
+    }
+    if (type == AST_TYPE_UNKNOWN) {
+        return;
+    }
+    if (state->count == MAX_FACTS) {
+        memmove(state->facts, state->facts + 1, sizeof(TypeFact) * (MAX_FACTS - 1));
+        state->count--;
+    }
+    state->facts[state->count].name = name;
+    state->facts[state->count].type = type;
+    state->count++;
+}
+
+/**
+ * Forgets the type of the variable assigned by a foreach loop.
+ */
+static void forget_var(TypeState *state, AST *var) {
+    if (!var) {
+        return;
+    }
+    if (var->val_is_ast) {
+        state->count = 0;
+    } else {
+        set_type(state, var->value.strval, AST_TYPE_UNKNOWN);
+    }
+}
+
+/**
+ * Keeps only the facts of a state that also hold in another state, giving
+ * the types known where the two paths meet.
+ */
+static void join_states(TypeState *state, const TypeState *other) {
+    int i = 0;
+    while (i < state->count) {
+        if (lookup_type(other, state->facts[i].name) == state->facts[i].type) {
+            i++;
+        } else {
+            state->facts[i] = state->facts[--state->count];
+        }
+    }
+}
+
+/**
+ * Returns whether two states know the same types.
+ */
+static bool same_states(const TypeState *a, const TypeState *b) {
+    if (a->count != b->count) {
+        return false;
+    }
+    for (int i = 0; i < a->count; i++) {
+        if (lookup_type(b, a->facts[i].name) != a->facts[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Adds the types known on one more path to an accumulated join.
+ */
+static void merge_state(TypeState *acc, bool *have, const TypeState *state) {
+    if (*have) {
+        join_states(acc, state);
+    } else {
+        *acc = *state;
+        *have = true;
+    }
+}
+
+/**
+ * Returns the type of an arithmetic operation on operands of the given
+ * types, following the promotions of the virtual machine.
+ */
+static ASTValueType arithmetic_type(ASTValueType left, ASTValueType right) {
+    if (left == AST_TYPE_UNKNOWN || right == AST_TYPE_UNKNOWN) {
+        return AST_TYPE_UNKNOWN;
+    }
+    if (left == AST_TYPE_INT && right == AST_TYPE_INT) {
+        return AST_TYPE_INT;
+    }
+    return AST_TYPE_DBL;
+}
+
+/**
+ * Returns the type of the value returned by a library function.
+ */
+static ASTValueType library_type(AST *node) {
+    const char *lib = node->left->value.strval->value;
+    const char *fn = node->right->value.strval->value;
+    for (size_t i = 0; i < sizeof(lib_types) / sizeof(lib_types[0]); i++) {
+        if (strcmp(lib_types[i].lib, lib) == 0 && strcmp(lib_types[i].fn, fn) == 0) {
+            return lib_types[i].type;
+        }
+    }
+    return AST_TYPE_UNKNOWN;
+}
+
+/**
+ * Forgets the types of the global variables a call may assign.
+ */
+static void after_call(TypeContext *ctx, TypeState *state) {
+    if (ctx->calls_write_globals && !ctx->in_function) {
+        state->count = 0;
+    }
+}
+
+/**
+ * Walks the body of a function or closure, whose locals start out unknown.
+ *
+ * Like the compiler, the walk leaves function context afterwards. Within an
+ * enclosing function, the names that follow then refer to globals, so what
+ * was known about them is forgotten.
+ */
+static void infer_function(TypeContext *ctx, AST *body, TypeState *state) {
+    LoopTypes *loop = ctx->loop;
+    bool nested = ctx->in_function;
+    TypeState locals;
+
+    locals.count = 0;
+    ctx->loop = NULL;
+    ctx->in_function = true;
+    infer_statement(ctx, body, &locals);
+    ctx->loop = loop;
+    ctx->in_function = false;
+    if (nested) {
+        ctx->writes_globals = true;
+        state->count = 0;
+    }
+}
+
+/**
+ * Walks an argument list in the order it is compiled.
+ */
+static void infer_arguments(TypeContext *ctx, AST *argument_list, TypeState *state) {
+    if (!argument_list || !argument_list->right) {
+        return;
+    }
+    infer_arguments(ctx, argument_list->left, state);
+    infer_expression(ctx, argument_list->right, state);
+}
+
+/**
+ * Walks the elements of an array literal.
+ */
+static void infer_array(TypeContext *ctx, AST *node, TypeState *state) {
+    for (AST *current = node->right; current; current = current->next) {
+        if (current->type == AST_KEY_VALUE_PAIR) {
+            infer_expression(ctx, current->left, state);
+            infer_expression(ctx, current->right, state);
+        } else if (current->type == AST_ELEMENT) {
+            infer_expression(ctx, current->right, state);
+        } else if (current->type == AST_ARRAY) {
+            infer_array(ctx, current, state);
+        }
+    }
+}
+
+/**
+ * Walks an assignment and records the type of the assigned variable.
+ */
+static void infer_assignment(TypeContext *ctx, AST *node, TypeState *state) {
+    AST *target = node->left;
+
+    if (node->type != AST_ASSIGNMENT) {
+        ASTValueType left = AST_TYPE_UNKNOWN;
+        if (target->type == AST_ARRAY_ACCESS || target->type == AST_MEMBER_ACCESS) {
+            infer_expression(ctx, target, state);
+        } else if (target->type == AST_VAR) {
+            left = lookup_type(state, target->value.strval);
+            target->value_type = left;
+        }
+        ASTValueType right = infer_expression(ctx, node->right, state);
+        if (target->type == AST_VAR) {
+            set_type(state, target->value.strval, arithmetic_type(left, right));
+        }
+        return;
+    }
+
+    if (target->type == AST_ARRAY_ACCESS) {
+        infer_expression(ctx, node->right, state);
+        infer_expression(ctx, target, state);
+        return;
+    }
+    ASTValueType type = infer_expression(ctx, node->right, state);
+    if (node->right->type != AST_ARRAY && target->type == AST_MEMBER_ACCESS) {
+        infer_expression(ctx, target, state);
+        return;
+    }
+    if (node->right->type == AST_OBJECT) {
+        return;
+    }
+    if (target->type == AST_VAR) {
+        set_type(state, target->value.strval, type);
+    }
+}
+
+/**
+ * Walks an expression and marks it with the type it was proven to have.
+ *
+ * @param ctx The state of the walk.
+ * @param node The expression.
+ * @param state The known types, updated by the assignments and calls of the
+ *              expression.
+ * @return The type of the expression's value.
+ */
+static ASTValueType infer_expression(TypeContext *ctx, AST *node, TypeState *state) {
+    ASTValueType type = AST_TYPE_UNKNOWN;
+
+    switch (node->type) {
+    case AST_INT:
+        type = AST_TYPE_INT;
+        break;
+
+    case AST_DBL:
+        type = AST_TYPE_DBL;
+        break;
+
+    case AST_BIN_ADD:
+    case AST_BIN_SUB:
+    case AST_BIN_MUL:
+    case AST_BIN_DIV:
+    case AST_BIN_MOD: {
+        ASTValueType left = infer_expression(ctx, node->left, state);
+        ASTValueType right = infer_expression(ctx, node->right, state);
+        type = arithmetic_type(left, right);
+        break;
+    }
+
+    case AST_BIN_EQ:
+    case AST_BIN_NE:
+    case AST_BIN_LT:
+    case AST_BIN_LE:
+    case AST_BIN_GT:
+    case AST_BIN_GE:
+        infer_expression(ctx, node->left, state);
+        infer_expression(ctx, node->right, state);
+        break;
+
+    case AST_UNARY_NOT:
+        infer_expression(ctx, node->right, state);
+        break;
+
+    case AST_UNARY_ADD:
+    case AST_UNARY_SUB:
+        type = infer_expression(ctx, node->right, state);
+        break;
+
+    case AST_UNARY_INC:
+    case AST_UNARY_DEC: {
+        // The variable keeps its type; the value of the expression is left
+        // unknown.
+        AST *operand = node->right ? node->right : node->left;
+        if (operand->type == AST_ARRAY_ACCESS) {
+            infer_expression(ctx, operand->left, state);
+            infer_expression(ctx, operand->right, state);
+        }
+        break;
+    }
+
+    case AST_LOGICAL_EXPR: {
+        infer_expression(ctx, node->left, state);
+        TypeState skipped = *state;
+        infer_expression(ctx, node->right, state);
+        join_states(state, &skipped);
+        break;
+    }
+
+    case AST_TERNARY: {
+        infer_expression(ctx, node->left, state);
+        TypeState other = *state;
+        ASTValueType if_true = infer_expression(ctx, node->right, state);
+        ASTValueType if_false = infer_expression(ctx, node->value.ast_node, &other);
+        join_states(state, &other);
+        if (if_true == if_false) {
+            type = if_true;
+        }
+        break;
+    }
+
+    case AST_VAR:
+        type = lookup_type(state, node->value.strval);
+        break;
+
+    case AST_ARRAY:
+        infer_array(ctx, node, state);
+        break;
+
+    case AST_OBJECT:
+        for (AST *current = node->right; current; current = current->right) {
+            if (current->type == AST_OBJ_FIELD) {
+                infer_expression(ctx, current->left, state);
+                infer_expression(ctx, current->right, state);
+            }
+        }
+        break;
+
+    case AST_ARRAY_ACCESS:
+    case AST_MEMBER_ACCESS:
+        infer_expression(ctx, node->left, state);
+        if (node->type == AST_ARRAY_ACCESS) {
+            infer_expression(ctx, node->right, state);
+        }
+        break;
+
+    case AST_CLOSURE:
+        infer_function(ctx, node->right, state);
+        break;
+
+    case AST_ASSIGNMENT:
+    case AST_ASSIGN_ADD:
+    case AST_ASSIGN_SUB:
+    case AST_ASSIGN_MUL:
+    case AST_ASSIGN_DIV:
+    case AST_ASSIGN_MOD:
+        infer_assignment(ctx, node, state);
+        break;
+
+    case AST_FN_CALL:
+        infer_arguments(ctx, node->right, state);
+        if (node->left->type == AST_MEMBER_ACCESS) {
+            infer_expression(ctx, node->left->left, state);
+        }
+        after_call(ctx, state);
+        break;
+
+    case AST_LIB_CALL:
+        infer_arguments(ctx, node->value.ast_node, state);
+        after_call(ctx, state);
+        type = library_type(node);
+        break;
+
+    case AST_NEW:
+        infer_arguments(ctx, node->right, state);
+        infer_expression(ctx, node->left, state);
+        after_call(ctx, state);
+        break;
+
+    default:
+        break;
+    }
+    node->value_type = type;
+    return type;
+}
+
+/**
+ * Walks a while or for loop until the types known at its start are stable.
+ *
+ * The types known at the start of the loop are those known on entry, after
+ * each iteration and at each continue. Since the virtual machine resumes a
+ * break at the loop condition's jump, the types at a break are taken to
+ * reach both the body and the code after the loop. If the types do not
+ * settle within a few passes, nothing is assumed at the start of the loop.
+ */
+static void infer_loop(TypeContext *ctx, AST *condition, AST *body, AST *increment, TypeState *state) {
+    LoopTypes *outer = ctx->loop;
+    LoopTypes loop;
+    TypeState head = *state;
+    TypeState breaks;
+    TypeState exit;
+    bool have_breaks = false;
+
+    for (int pass = 0; ; pass++) {
+        if (pass == MAX_LOOP_PASSES) {
+            head.count = 0;
+            breaks.count = 0;
+            have_breaks = true;
+        }
+        TypeState current = head;
+        if (condition) {
+            infer_expression(ctx, condition, &current);
+        }
+        exit = current;
+        if (have_breaks) {
+            join_states(&current, &breaks);
+        }
+
+        loop.have_breaks = false;
+        loop.have_continues = false;
+        ctx->loop = &loop;
+        infer_statement(ctx, body, &current);
+        if (increment) {
+            infer_statement(ctx, increment, &current);
+        }
+        ctx->loop = outer;
+
+        TypeState next = head;
+        join_states(&next, &current);
+        if (loop.have_continues) {
+            join_states(&next, &loop.continues);
+        }
+        bool stable = same_states(&next, &head);
+        if (loop.have_breaks) {
+            TypeState joined = loop.breaks;
+            if (have_breaks) {
+                join_states(&joined, &breaks);
+            }
+            if (!have_breaks || !same_states(&joined, &breaks)) {
+                breaks = joined;
+                have_breaks = true;
+                stable = false;
+            }
+        }
+        if (stable) {
+            break;
+        }
+        head = next;
+    }
+
+    *state = exit;
+    if (have_breaks) {
+        join_states(state, &breaks);
+    }
+}
+
+/**
+ * Walks a foreach loop until the types known at its start are stable.
+ *
+ * The loop does not change what break and continue refer to, as in the
+ * compiler.
+ */
+static void infer_foreach(TypeContext *ctx, AST *node, TypeState *state) {
+    AST *iterable = node->value.ast_node->left;
+    AST *body = node->value.ast_node->right;
+
+    infer_expression(ctx, iterable, state);
+    for (int pass = 0; ; pass++) {
+        if (pass == MAX_LOOP_PASSES) {
+            state->count = 0;
+        }
+        TypeState current = *state;
+        forget_var(&current, node->left);
+        forget_var(&current, node->right);
+        infer_statement(ctx, body, &current);
+
+        TypeState next = *state;
+        join_states(&next, &current);
+        if (same_states(&next, state)) {
+            break;
+        }
+        *state = next;
+    }
+}
+
+/**
+ * Walks a switch statement. Each case body is entered after the case values
+ * before it were compared, and the default body after all of them.
+ */
+static void infer_switch(TypeContext *ctx, AST *node, TypeState *state) {
+    TypeState end;
+    bool have_end = false;
+
+    for (AST *case_node = node->right; case_node; case_node = case_node->right->right) {
+        if (case_node->type == AST_CASE) {
+            infer_expression(ctx, node->left, state);
+            infer_expression(ctx, case_node->left, state);
+            TypeState body = *state;
+            infer_statement(ctx, case_node->right, &body);
+            merge_state(&end, &have_end, &body);
+        }
+    }
+    if (node->value.ast_node) {
+        infer_statement(ctx, node->value.ast_node, state);
+    }
+    merge_state(&end, &have_end, state);
+    *state = end;
+}
+
+/**
+ * Walks a statement in the order it is compiled.
+ *
+ * @param ctx The state of the walk.
+ * @param node The statement.
+ * @param state The known types, updated by the statement.
+ */
+static void infer_statement(TypeContext *ctx, AST *node, TypeState *state) {
+    if (!node) {
+        return;
+    }
+
+    switch (node->type) {
+    case AST_IF: {
+        infer_expression(ctx, node->left, state);
+        TypeState other = *state;
+        infer_statement(ctx, node->right, state);
+        infer_statement(ctx, node->value.ast_node, &other);
+        join_states(state, &other);
+        break;
+    }
+    case AST_SWITCH:
+        infer_switch(ctx, node, state);
+        break;
+    case AST_WHILE:
+        infer_loop(ctx, node->left, node->right, NULL, state);
+        break;
+    case AST_FOR:
+        infer_statement(ctx, node->left, state);
+        infer_loop(
+            ctx, node->right,
+            node->value.ast_node->right,
+            node->value.ast_node->left, state);
+        break;
+    case AST_FOREACH:
+        infer_foreach(ctx, node, state);
+        break;
+    case AST_INCLUDE:
+        // The included file may assign any variable, and its functions
+        // are not walked.
+        ctx->writes_globals = true;
+        ctx->in_function = false;
+        state->count = 0;
+        break;
+    case AST_CONTINUE:
+    case AST_BREAK:
+        if (!ctx->loop) {
+            ctx->failed = true;
+        } else if (node->type == AST_BREAK) {
+            merge_state(&ctx->loop->breaks, &ctx->loop->have_breaks, state);
+        } else {
+            merge_state(&ctx->loop->continues, &ctx->loop->have_continues, state);
+        }
+        break;
+    case AST_FN_DECL:
+        infer_function(ctx, node->right, state);
+        break;
+    case AST_RETURN:
+        if (node->left) {
+            infer_expression(ctx, node->left, state);
+        }
+        break;
+    case AST_BLOCK:
+        if (node->right && node->right->type != AST_CASE) {
+            infer_statement(ctx, node->right, state);
+        }
+        infer_statement(ctx, node->left, state);
+        break;
+    case AST_STATEMENT:
+        while (node->type == AST_STATEMENT) {
+            infer_statement(ctx, node->left, state);
+            node = node->right;
+            if (!node || node->type == AST_CASE) {
+                return;
+            }
+        }
+        infer_statement(ctx, node, state);
+        break;
+    default:
+        infer_expression(ctx, node, state);
+        break;
+    }
+}
+
+/**
+ * Walks the statements of a program.
+ */
+static void infer_program(TypeContext *ctx, AST *program) {
+    TypeState state;
+
+    state.count = 0;
+    infer_statement(ctx, program->left, &state);
+    infer_statement(ctx, program->right, &state);
+}
+
+/**
+ * Infers the types of a program's expressions before it is compiled.
+ *
+ * Each expression node is marked with the type proven for its value, which
+ * the compiler uses to emit specialised instructions.
+ *
+ * @param program The program to walk.
+ * @param isolated Whether the program is compiled on its own, so that it
+ *                 calls no functions other than its own and those of the
+ *                 files it includes.
+ * @return true if the marks may be used, or false if the program could not
+ *         be walked safely.
+ */
+bool apexType_infer(AST *program, bool isolated) {
+    TypeContext ctx;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.calls_write_globals = !isolated;
+    infer_program(&ctx, program);
+
+    // Functions that assign globals may be declared after the calls to
+    // them, so the program is walked again with that in mind.
+    if (ctx.writes_globals && !ctx.calls_write_globals) {
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.calls_write_globals = true;
+        infer_program(&ctx, program);
+    }
+    return !ctx.failed;
+}
+
+/**
+ * Prints the ratio of specialised instructions of one kind.
+ */
+static void report_ratio(const char *kind, int specialised, int total) {
+    fprintf(stderr, "%s: %d of %d specialised", kind, specialised, total);
+    if (total > 0) {
+        fprintf(stderr, " (%.1f%%)", 100.0 * specialised / total);
+    }
+    fprintf(stderr, "\n");
+}
+
+/**
+ * Reports how many of a program's arithmetic, comparison and element
+ * access instructions were specialised by type inference, if the
+ * APEX_TYPE_STATS environment variable is set.
+ *
+ * @param chunk The compiled program.
+ */
+void apexType_report(const Chunk *chunk) {
+    int arithmetic[2] = { 0, 0 };
+    int comparison[2] = { 0, 0 };
+    int element[2] = { 0, 0 };
+
+    if (!getenv("APEX_TYPE_STATS")) {
+        return;
+    }
+    for (int i = 0; i < chunk->ins_count; i++) {
+        switch (chunk->ins[i].opcode) {
+        case OP_ADD_INT:
+        case OP_SUB_INT:
+        case OP_MUL_INT:
+        case OP_ADD_DBL:
+        case OP_SUB_DBL:
+        case OP_MUL_DBL:
+        case OP_DIV_DBL:
+            arithmetic[1]++;
+            // fall through
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+            arithmetic[0]++;
+            break;
+        case OP_EQ_INT:
+        case OP_NE_INT:
+        case OP_LT_INT:
+        case OP_LE_INT:
+        case OP_GT_INT:
+        case OP_GE_INT:
+        case OP_LT_DBL:
+        case OP_LE_DBL:
+        case OP_GT_DBL:
+        case OP_GE_DBL:
+            comparison[1]++;
+            // fall through
+        case OP_EQ:
+        case OP_NE:
+        case OP_LT:
+        case OP_LE:
+        case OP_GT:
+        case OP_GE:
+            comparison[0]++;
+            break;
+        case OP_GET_ELEMENT_INT:
+            element[1]++;
+            // fall through
+        case OP_GET_ELEMENT:
+            element[0]++;
+            break;
+        default:
+            break;
+        }
+    }
+    report_ratio("arithmetic", arithmetic[1], arithmetic[0]);
+    report_ratio("comparisons", comparison[1], comparison[0]);
+    report_ratio("element access", element[1], element[0]);
+}
@@ -0,0 +1,11 @@
+#ifndef APEX_TYPE_H
+#define APEX_TYPE_H
+
+#include <stdbool.h>
+#include "apexAST.h"
+#include "apexVM.h"
+
+extern bool apexType_infer(AST *program, bool isolated);
+extern void apexType_report(const Chunk *chunk);
+
+#endif
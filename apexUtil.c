@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include <limits.h>
 #include <ctype.h>
@@ -10,24 +12,160 @@
 #include "apexMem.h"
 #include "apexStr.h"
 
+#define HASH_SEED 0xa0761d6478bd642fULL
+#define HASH_P1 0xe7037ed1a0b428dbULL
+#define HASH_P2 0x8ebc6af09c88c6e3ULL
+#define HASH_P3 0x589965cc75374cc3ULL
+
+/**
+ * Multiplies two 64-bit values into a 128-bit product and stores the low
+ * and high halves back into a and b.
+ */
+static inline void hash_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * Mixes two 64-bit values by folding their 128-bit product.
+ */
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t hash_read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Folds a 64-bit hash into an unsigned int, keeping entropy from both halves
+ * so that the low bits used for bucket selection are well distributed.
+ */
+static inline unsigned int hash_fold(uint64_t h) {
+    return (unsigned int)(h ^ (h >> 32));
+}
+
+/**
+ * Computes a hash value for a sequence of bytes.
+ *
+ * This is a wyhash-style hash: every input byte contributes to the result,
+ * the input is consumed eight bytes at a time and mixed with 64x64->128 bit
+ * multiplies, which keeps it fast for long strings while still avalanching
+ * well on short identifiers. Strings that share a long common prefix or only
+ * differ in a few positions still hash to different values.
+ *
+ * @param data The bytes to be hashed.
+ * @param len The number of bytes to hash.
+ * @return An unsigned integer representing the hash value of the input.
+ */
+unsigned int apexUtil_hashbytes(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint64_t seed = HASH_SEED ^ hash_mix(HASH_SEED ^ HASH_P1, HASH_P2);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (hash_read32(p) << 32) | hash_read32(p + off);
+            b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - off);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hash_mix(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ seed);
+                see1 = hash_mix(hash_read64(p + 16) ^ HASH_P2, hash_read64(p + 24) ^ see1);
+                see2 = hash_mix(hash_read64(p + 32) ^ HASH_P3, hash_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(hash_read64(p) ^ HASH_P1, hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hash_read64(p + i - 16);
+        b = hash_read64(p + i - 8);
+    }
+
+    a ^= HASH_P1;
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_fold(hash_mix(a ^ HASH_SEED ^ len, b ^ HASH_P1));
+}
+
+/**
+ * Computes a hash value for a 64-bit integer.
+ *
+ * The integer is mixed with a full 64x64->128 bit multiply, so every input
+ * bit affects the low bits used for slot selection. This is used for
+ * integer, float and double keys, whose raw bit patterns are poorly
+ * distributed.
+ *
+ * @param value The integer to be hashed.
+ * @return An unsigned integer representing the hash value of the integer.
+ */
+unsigned int apexUtil_hashint(uint64_t value) {
+    return hash_fold(hash_mix(value ^ HASH_P2, HASH_P1));
+}
+
+/**
+ * Computes a hash value for a pointer.
+ *
+ * Interned strings are unique per content, so tables keyed by an interned
+ * string's value pointer can hash the address instead of the characters.
+ * The address is mixed so that its alignment zeros do not end up in the
+ * low bits used for bucket selection.
+ *
+ * @param ptr The pointer to be hashed.
+ * @return An unsigned integer representing the hash value of the pointer.
+ */
+unsigned int apexUtil_hashptr(const void *ptr) {
+    return apexUtil_hashint((uint64_t)(uintptr_t)ptr);
+}
+
 /**
  * Computes a hash value for a given string.
  *
- * This function takes a string and returns a hash value based on its contents.
- * The hash value is computed by iterating over each character in the string
- * and combining them using a combination of bitwise shifting and addition.
- * The resulting hash value is then returned.
+ * This function takes a NUL-terminated string and returns its hash value
+ * as computed by apexUtil_hashbytes. Callers that hold an ApexString should
+ * use its cached hash field instead.
  *
  * @param str The input string to be hashed.
  * @return An unsigned integer representing the hash value of the input string.
  */
 unsigned int apexUtil_hash(const char *str) {
-    unsigned int hash = 0;
-    while (*str) {
-        hash = (hash << 5) + hash + (unsigned char)(*str);
-        str++;
-    }
-    return hash;
+    return apexUtil_hashbytes(str, strlen(str));
 }
 
 /**
@@ -2,7 +2,12 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+extern unsigned int apexUtil_hashbytes(const void *data, size_t len);
+extern unsigned int apexUtil_hashint(uint64_t value);
+extern unsigned int apexUtil_hashptr(const void *ptr);
 extern unsigned int apexUtil_hash(const char *str);
 extern bool apexUtil_stoi(int *out, const char *str);
 extern bool apexUtil_stof(float *out, const char *str);
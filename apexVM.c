@@ -73,6 +73,36 @@ static const char *opcode_to_string(OpCode opcode) {
         case OP_CALL_MEMBER: return "OP_CALL_MEMBER";
         case OP_CREATE_OBJECT: return "OP_CREATE_OBJECT";
         case OP_CREATE_CLOSURE: return "OP_CREATE_CLOSURE";
+        case OP_GET_ELEMENT_INT: return "OP_GET_ELEMENT_INT";
+        case OP_ADD_INT: return "OP_ADD_INT";
+        case OP_SUB_INT: return "OP_SUB_INT";
+        case OP_MUL_INT: return "OP_MUL_INT";
+        case OP_EQ_INT: return "OP_EQ_INT";
+        case OP_NE_INT: return "OP_NE_INT";
+        case OP_LT_INT: return "OP_LT_INT";
+        case OP_LE_INT: return "OP_LE_INT";
+        case OP_GT_INT: return "OP_GT_INT";
+        case OP_GE_INT: return "OP_GE_INT";
+        case OP_ADD_DBL: return "OP_ADD_DBL";
+        case OP_SUB_DBL: return "OP_SUB_DBL";
+        case OP_MUL_DBL: return "OP_MUL_DBL";
+        case OP_DIV_DBL: return "OP_DIV_DBL";
+        case OP_LT_DBL: return "OP_LT_DBL";
+        case OP_LE_DBL: return "OP_LE_DBL";
+        case OP_GT_DBL: return "OP_GT_DBL";
+        case OP_GE_DBL: return "OP_GE_DBL";
+        case OP_INLINE_ENTER: return "OP_INLINE_ENTER";
+        case OP_GET_ARG: return "OP_GET_ARG";
+        case OP_INLINE_LEAVE: return "OP_INLINE_LEAVE";
+        case OP_LEN: return "OP_LEN";
+        case OP_TO_INT: return "OP_TO_INT";
+        case OP_TO_STR: return "OP_TO_STR";
+        case OP_TO_DBL: return "OP_TO_DBL";
+        case OP_ABS: return "OP_ABS";
+        case OP_FLOOR: return "OP_FLOOR";
+        case OP_MIN: return "OP_MIN";
+        case OP_MAX: return "OP_MAX";
+        case OP_PRINT: return "OP_PRINT";
         case OP_NEW: return "OP_NEW";
         case OP_HALT: return "OP_HALT";
     }
@@ -114,6 +144,9 @@ void print_vm_instructions(ApexVM *vm) {
             break;
         
         case OP_CALL:
+        case OP_GET_ARG:
+        case OP_MIN:
+        case OP_MAX:
         case OP_JUMP_IF_FALSE:
         case OP_JUMP:
         case OP_SET_LOCAL:
@@ -136,6 +169,33 @@ void print_vm_instructions(ApexVM *vm) {
 
 static bool vm_execute(ApexVM *vm, Ins *ins);
 
+/**
+ * Reads which optimising passes of the compiler are enabled from the
+ * environment.
+ *
+ * @return The enabled passes, as APEX_CODEGEN_* flags.
+ */
+static int codegen_switches(void) {
+    static const struct {
+        const char *name;
+        int flag;
+    } switches[] = {
+        { "APEX_TYPES", APEX_CODEGEN_TYPES },
+        { "APEX_INLINE", APEX_CODEGEN_INLINE },
+        { "APEX_HOIST", APEX_CODEGEN_HOIST },
+        { "APEX_INTRINSICS", APEX_CODEGEN_INTRINSICS }
+    };
+    int codegen = 0;
+
+    for (size_t i = 0; i < sizeof(switches) / sizeof(switches[0]); i++) {
+        const char *enabled = getenv(switches[i].name);
+        if (!enabled || strcmp(enabled, "0") != 0) {
+            codegen |= switches[i].flag;
+        }
+    }
+    return codegen;
+}
+
 /**
  * Initializes a virtual machine structure.
  *
@@ -143,7 +203,8 @@ static bool vm_execute(ApexVM *vm, Ins *ins);
  * allocates memory for the instruction chunk and the global and function
  * symbol tables, and initializes the local scope stack. It also sets the
  * instruction pointer and stack top to 0, and sets the loop start and end
- * pointers to -1.
+ * pointers to -1. The optimising passes to compile with are read from the
+ * environment once, here.
  *
  * @param vm A pointer to the virtual machine structure to be initialized.
  */
@@ -151,12 +212,28 @@ void init_vm(ApexVM *vm) {
     vm->stack_top = 0;
     vm->ip = 0;
     vm->in_function = false;
+    vm->typed = false;
+    vm->codegen = codegen_switches();
+    vm->inlining = NULL;
     vm->chunk = apexMem_alloc(sizeof(Chunk));
     vm->chunk->ins = apexMem_alloc(sizeof(Ins) * 8);
     vm->chunk->ins_size = 8;
     vm->chunk->ins_count = 0;
     vm->loop_start = -1;
     vm->loop_end = -1;
+    vm->arena = NULL;
+    vm->loader = NULL;
+    vm->modules = NULL;
+    vm->module_count = 0;
+    vm->module_size = 0;
+    vm->cwd_includes = false;
+    vm->conditional = 0;
+    vm->inline_fns = NULL;
+    vm->inline_count = 0;
+    vm->inline_size = 0;
+    vm->hoisted = NULL;
+    vm->hoist_count = 0;
+    vm->hoist_serial = 0;
     vm->srcloc.lineno = 0;
     vm->srcloc.filename = NULL;
     vm->call_stack_top = 0;
@@ -166,20 +243,38 @@ void init_vm(ApexVM *vm) {
 }
 
 /**
- * Resets the virtual machine's instruction chunk.
+ * Resets the virtual machine to its initial state.
  *
- * This function frees the current instruction memory and reallocates it
- * with an initial size of 8 instructions. It also resets the instruction
- * count to zero, effectively clearing any previously loaded instructions.
+ * This function discards the instruction chunk along with every global,
+ * function and module defined so far. The arena of the source being
+ * compiled is kept.
  *
  * @param vm A pointer to the virtual machine structure to reset.
  */
 void apexVM_reset(ApexVM *vm) {
-    free(vm->chunk->ins);
-    vm->chunk->ins = apexMem_alloc(sizeof(Ins) * 8);
-    vm->chunk->ins_size = 8;
-    vm->chunk->ins_count = 0;
-    vm->ip = 0;
+    ApexArena *arena = vm->arena;
+    free_vm(vm);
+    init_vm(vm);
+    vm->arena = arena;
+}
+
+/**
+ * Unwinds the virtual machine after a runtime error.
+ *
+ * The value stack, the call stack and the local scopes of the calls that
+ * were active are dropped, so that the machine can run more code. The
+ * instruction chunk and the globals are kept.
+ *
+ * @param vm A pointer to the virtual machine structure to unwind.
+ */
+void apexVM_unwind(ApexVM *vm) {
+    while (vm->local_scopes.top) {
+        pop_scope(&vm->local_scopes);
+    }
+    vm->stack_top = 0;
+    vm->call_stack_top = 0;
+    vm->obj_context = apexVal_makenull();
+    vm->ip = vm->chunk->ins_count;
 }
 
 /**
@@ -194,6 +289,8 @@ void apexVM_reset(ApexVM *vm) {
 void free_vm(ApexVM *vm) {
     free(vm->chunk->ins);
     free(vm->chunk);
+    free(vm->modules);
+    free(vm->inline_fns);
     free_symbol_table(&vm->global_table);
     free_scope_stack(&vm->local_scopes);
 }
@@ -214,6 +311,7 @@ static CallFrame create_callframe(const char *fn_name, SrcLoc srcloc) {
     CallFrame callframe;
     callframe.fn_name = fn_name;
     callframe.srcloc = srcloc;
+    callframe.base = 0;
     return callframe;
 }
 
@@ -452,60 +550,337 @@ ApexValue apexVM_pop(ApexVM *vm) {
 }
 
 /**
- * Calls an Apex function with the given number of arguments.
+ * Calls a library function with the arguments on top of the stack.
  *
- * This function first verifies that the number of arguments provided is
- * valid for the given function. If the function takes a variable number of
- * arguments, it then verifies that the number of arguments provided is
- * at least equal to the number of fixed parameters in the function. If the
- * number of arguments is invalid, it raises a runtime error and returns
- * false.
+ * Functions using the fast calling convention have their arguments checked
+ * and read in place, and the arguments are then replaced with the result.
  *
- * After verifying the number of arguments, this function allocates a new
- * scope and adds the function's parameters to the scope. If the function
- * takes a variable number of arguments, it collects all arguments after the
- * last fixed parameter into an ApexArray and adds it to the scope. All
- * arguments are then pushed onto the scope's stack.
+ * @param vm A pointer to the virtual machine structure.
+ * @param lib_name The name of the library.
+ * @param fn_name The name of the function.
+ * @param argc The number of arguments on the stack.
+ * @return true if the function ran successfully, false if it is not defined
+ *         or raised an error.
+ */
+static bool call_library(ApexVM *vm, const char *lib_name, const char *fn_name, int argc) {
+    ApexLibData lib_data = apexLib_get(lib_name, fn_name);
+    if (!lib_data.name || lib_data.is_var) {
+        apexErr_runtime(vm, "undefined library function '%s:%s'", lib_name, fn_name);
+        return false;
+    }
+    if (!lib_data.is_fast) {
+        return lib_data.fn(vm, argc) != 1;
+    }
+    ApexValue *args = &vm->stack[vm->stack_top - argc];
+    ApexValue result = apexVal_makenull();
+    if (!apexLib_checkargs(vm, lib_name, fn_name, &lib_data, args, argc) ||
+        lib_data.fast(vm, args, &result) != 0) {
+        return false;
+    }
+    vm->stack_top -= argc;
+    stack_push(vm, result);
+    return true;
+}
+
+/**
+ * Replaces the numbers on top of the stack with the smallest or largest of
+ * them, the way math:min and math:max do. If one of the values is not a
+ * number, the stack is left untouched.
  *
- * Finally, this function sets the virtual machine's instruction pointer to
- * the address of the given function, and pushes the current instruction
- * pointer onto the stack as the return address.
+ * @param vm A pointer to the virtual machine structure.
+ * @param argc The number of values on the stack.
+ * @param max Whether the largest value is pushed rather than the smallest.
+ * @return true if the result was pushed, false if a value is not a number.
+ */
+static bool push_extreme(ApexVM *vm, int argc, bool max) {
+    ApexValueType type = APEX_VAL_NULL;
+    double result = 0;
+
+    for (int i = vm->stack_top - 1; i >= vm->stack_top - argc; i--) {
+        ApexValue value = vm->stack[i];
+        double num;
+        switch (value.type) {
+        case APEX_VAL_INT:
+            num = (double)value.intval;
+            break;
+        case APEX_VAL_FLT:
+            num = (double)value.fltval;
+            break;
+        case APEX_VAL_DBL:
+            num = value.dblval;
+            break;
+        default:
+            return false;
+        }
+        if (type == APEX_VAL_NULL || (max ? num > result : num < result)) {
+            result = num;
+            type = value.type;
+        }
+    }
+    vm->stack_top -= argc;
+    switch (type) {
+    case APEX_VAL_INT:
+        stack_push(vm, apexVal_makeint((int)result));
+        break;
+    case APEX_VAL_FLT:
+        stack_push(vm, apexVal_makeflt((float)result));
+        break;
+    default:
+        stack_push(vm, apexVal_makedbl(result));
+        break;
+    }
+    return true;
+}
+
+/**
+ * Calls a function value with the arguments on top of the stack.
  *
- * @param vm A pointer to the virtual machine to call the function in.
- * @param fn A pointer to the Apex function to call.
- * @return true if the function was called successfully, false if an error
- *         occurred.
+ * Native functions run to completion. For Apex functions, a call frame and a
+ * scope holding the arguments are pushed, the return address is pushed onto
+ * the stack, and the instruction pointer is moved to the function's body.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param fnval The function to call.
+ * @param argc The number of arguments on the stack.
+ * @return true if the call was made, false if an error occurred.
  */
-bool apexVM_call(ApexVM *vm, ApexFn *fn, int argc) {
+static bool call_value(ApexVM *vm, ApexValue fnval, int argc) {
+    if (fnval.type == APEX_VAL_CFN) {
+        ApexCfn cfn = fnval.cfnval;               
+        return cfn.fn(vm, argc) == 0;
+    }
+
     int ret_addr = vm->ip;
-            
-    if (argc != fn->argc) {
-        apexErr_runtime(vm, "expected %d arguments, got %d", fn->argc, argc);
+    ApexFn *fn = fnval.fnval;
+    
+    if (fn->have_variadic) {
+        if (argc < fn->argc - 1) {
+            apexErr_runtime(vm,
+                "expected at least %d arguments, got %d",
+                fn->argc, argc);
+            return false;
+        }                
+    } else if (argc != fn->argc) {
+        apexErr_runtime(vm, 
+            "expected %d arguments, got %d", 
+            fn->argc, argc);
         return false;
     }
 
     push_callframe(vm, fn->name, vm->ins->srcloc);
-    push_scope(&vm->local_scopes);  
+    push_scope(&vm->local_scopes);
 
-    for (int i = 0; i < argc; i++) {      
-        ApexValue value = stack_pop(vm);
-        apexSym_setlocal(
-            &vm->local_scopes,
-            fn->params[i],
-            value);        
+    ApexArray *variadic_args = NULL;
+    int param_index = 0;
+    bool have_variadic = false;
+
+    if (fn->have_variadic) {
+        variadic_args = apexVal_newarray();
+    }
+
+    int variadic_index = argc - fn->argc;
+
+    for (int i = 0; i < argc; i++) {
+        if (fn->have_variadic && argc - i >= fn->argc) {
+            apexVal_arrayset(
+                variadic_args,
+                apexVal_makeint(variadic_index--),
+                stack_pop(vm));
+            have_variadic = true;
+        } else {
+            if (have_variadic) {
+                apexSym_setlocal(
+                    &vm->local_scopes, 
+                    fn->params[param_index++], 
+                    apexVal_makearr(variadic_args));
+                have_variadic = false;
+            }
+            ApexValue value = stack_pop(vm);
+            apexSym_setlocal(
+                &vm->local_scopes,
+                fn->params[param_index++],
+                value);
+        }
     }
+    vm->call_stack[vm->call_stack_top - 1].base = vm->stack_top;
     stack_push(vm, apexVal_makeint(ret_addr));
-    vm->ip = fn->addr;     
-    Ins *ins; 
-    do {
-        ins = next_ins(vm);
-        if (!vm_execute(vm, ins)) {
+    vm->ip = fn->addr;
+    return true;
+}
+
+/**
+ * Runs instructions until the call stack drops back to the given depth.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param depth The depth of the call stack to return to.
+ * @return true if the calls returned, false if an error occurred.
+ */
+static bool run_until_return(ApexVM *vm, int depth) {
+    while (vm->call_stack_top > depth) {
+        if (!vm_execute(vm, next_ins(vm))) {
             return false;
         }
-    } while (ins->opcode != OP_RETURN);
+    }
     return true;
 }
 
+/**
+ * Calls an Apex function with the arguments on top of the stack.
+ *
+ * The arguments are replaced with the function's return value, if it
+ * returns one. The function runs to completion before this returns, so
+ * native functions can call back into Apex code.
+ *
+ * @param vm A pointer to the virtual machine to call the function in.
+ * @param fn A pointer to the Apex function to call.
+ * @param argc The number of arguments on the stack.
+ * @return true if the function was called successfully, false if an error
+ *         occurred.
+ */
+bool apexVM_call(ApexVM *vm, ApexFn *fn, int argc) {
+    int depth = vm->call_stack_top;
+    return call_value(vm, apexVal_makefn(fn), argc) &&
+           run_until_return(vm, depth);
+}
+
+/**
+ * Prepares a call site for calling a function from native code.
+ *
+ * The function value and the number of arguments are checked once here
+ * rather than on every call made through the site.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param site The call site to prepare.
+ * @param fnval The function to call.
+ * @param argc The number of arguments passed on each call.
+ * @return true if the site was prepared, false if the value cannot be
+ *         called with the given number of arguments.
+ */
+bool apexVM_prepare(ApexVM *vm, ApexCallSite *site, ApexValue fnval, int argc) {
+    if (fnval.type != APEX_VAL_FN && fnval.type != APEX_VAL_CFN) {
+        apexErr_runtime(vm, "attempt to call a %s value", apexVal_typestr(fnval));
+        return false;
+    }
+    if (fnval.type == APEX_VAL_FN) {
+        ApexFn *fn = fnval.fnval;
+        if (fn->have_variadic) {
+            if (argc < fn->argc - 1) {
+                apexErr_runtime(vm,
+                    "expected at least %d arguments, got %d",
+                    fn->argc, argc);
+                return false;
+            }
+        } else if (argc != fn->argc) {
+            apexErr_runtime(vm,
+                "expected %d arguments, got %d",
+                fn->argc, argc);
+            return false;
+        }
+    }
+    site->fnval = fnval;
+    site->argc = argc;
+    site->scope = NULL;
+    return true;
+}
+
+/**
+ * Calls the function of a call site and waits for it to return.
+ *
+ * The arguments are bound straight into the parameter scope of the site,
+ * which is pushed again on later calls instead of being rebuilt. Locals
+ * the body defined are dropped after each call. Native and variadic
+ * functions take the arguments from the stack as usual. The value stack
+ * and object context are restored to what they were before the call.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param site The call site, prepared with apexVM_prepare.
+ * @param argv The arguments, in declaration order.
+ * @param result Set to the return value, or null if nothing was returned.
+ * @return true if the function returned, false if an error occurred.
+ */
+bool apexVM_invokesite(ApexVM *vm, ApexCallSite *site, const ApexValue *argv, ApexValue *result) {
+    int base = vm->stack_top;
+    int depth = vm->call_stack_top;
+    ApexValue obj_context = vm->obj_context;
+    ApexFn *fn = site->fnval.fnval;
+
+    if (site->fnval.type == APEX_VAL_CFN || fn->have_variadic) {
+        for (int i = 0; i < site->argc; i++) {
+            stack_push(vm, argv[i]);
+        }
+        if (!call_value(vm, site->fnval, site->argc) ||
+            !run_until_return(vm, depth)) {
+            return false;
+        }
+    } else {
+        push_callframe(vm, fn->name, vm->ins->srcloc);
+        vm->call_stack[depth].base = base;
+        if (site->scope) {
+            site->scope->next = vm->local_scopes.top;
+            vm->local_scopes.top = site->scope;
+        } else {
+            push_scope(&vm->local_scopes);
+            site->scope = vm->local_scopes.top;
+            site->scope->kept = true;
+        }
+        for (int i = 0; i < site->argc; i++) {
+            apexSym_setlocal(
+                &vm->local_scopes,
+                fn->params[i],
+                argv[site->argc - 1 - i]);
+        }
+        stack_push(vm, apexVal_makeint(vm->ip));
+        vm->ip = fn->addr;
+        if (!run_until_return(vm, depth)) {
+            // The scope is still on the scope stack, which frees it when
+            // the machine is unwound.
+            site->scope->kept = false;
+            site->scope = NULL;
+            return false;
+        }
+        if (site->scope->table.count > site->argc) {
+            free_symbol_table(&site->scope->table);
+            init_symbol_table(&site->scope->table);
+        }
+    }
+    *result = vm->stack_top > base ? stack_pop(vm) : apexVal_makenull();
+    vm->stack_top = base;
+    vm->obj_context = obj_context;
+    return true;
+}
+
+/**
+ * Frees the parameter scope kept by a call site.
+ *
+ * @param site The call site to free.
+ */
+void apexVM_freesite(ApexCallSite *site) {
+    if (site->scope) {
+        free_scope(site->scope);
+        site->scope = NULL;
+    }
+}
+
+/**
+ * Calls a function from native code and waits for it to return.
+ *
+ * @param vm A pointer to the virtual machine structure.
+ * @param fnval The function to call.
+ * @param argv The arguments, in declaration order.
+ * @param argc The number of arguments.
+ * @param result Set to the return value, or null if nothing was returned.
+ * @return true if the function returned, false if an error occurred.
+ */
+bool apexVM_invoke(ApexVM *vm, ApexValue fnval, const ApexValue *argv, int argc, ApexValue *result) {
+    ApexCallSite site;
+    if (!apexVM_prepare(vm, &site, fnval, argc)) {
+        return false;
+    }
+    bool ok = apexVM_invokesite(vm, &site, argv, result);
+    apexVM_freesite(&site);
+    return ok;
+}
+
 /**
  * Adds two ApexValue objects and returns the result.
  *
@@ -1081,25 +1456,178 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         stack_push(vm, value);
         break;
     }
+
+    // The operands of these were proven to be ints or dbls by type
+    // inference, so their tags are not checked.
+    #define TYPED_BINARY_OP(field, make, op) do { \
+        ApexValue right = stack_pop(vm); \
+        ApexValue *left = &vm->stack[vm->stack_top - 1]; \
+        *left = make(left->field op right.field); \
+    } while (0)
+
+    case OP_ADD_INT: TYPED_BINARY_OP(intval, apexVal_makeint, +); break;
+    case OP_SUB_INT: TYPED_BINARY_OP(intval, apexVal_makeint, -); break;
+    case OP_MUL_INT: TYPED_BINARY_OP(intval, apexVal_makeint, *); break;
+    case OP_EQ_INT: TYPED_BINARY_OP(intval, apexVal_makebool, ==); break;
+    case OP_NE_INT: TYPED_BINARY_OP(intval, apexVal_makebool, !=); break;
+    case OP_LT_INT: TYPED_BINARY_OP(intval, apexVal_makebool, <); break;
+    case OP_LE_INT: TYPED_BINARY_OP(intval, apexVal_makebool, <=); break;
+    case OP_GT_INT: TYPED_BINARY_OP(intval, apexVal_makebool, >); break;
+    case OP_GE_INT: TYPED_BINARY_OP(intval, apexVal_makebool, >=); break;
+    case OP_ADD_DBL: TYPED_BINARY_OP(dblval, apexVal_makedbl, +); break;
+    case OP_SUB_DBL: TYPED_BINARY_OP(dblval, apexVal_makedbl, -); break;
+    case OP_MUL_DBL: TYPED_BINARY_OP(dblval, apexVal_makedbl, *); break;
+    case OP_LT_DBL: TYPED_BINARY_OP(dblval, apexVal_makebool, <); break;
+    case OP_LE_DBL: TYPED_BINARY_OP(dblval, apexVal_makebool, <=); break;
+    case OP_GT_DBL: TYPED_BINARY_OP(dblval, apexVal_makebool, >); break;
+    case OP_GE_DBL: TYPED_BINARY_OP(dblval, apexVal_makebool, >=); break;
+    case OP_DIV_DBL:
+        if (stack_top(vm).dblval == 0) {
+            apexErr_runtime(vm, "division by zero");
+            return false;
+        }
+        TYPED_BINARY_OP(dblval, apexVal_makedbl, /);
+        break;
+    case OP_INLINE_ENTER: { // f(arg1, arg2, ...) with f inlined
+        ApexFn *fn = ins->value.fnval;
+        ApexValue fnval;
+        if (!apexSym_getglobal(&fnval, &vm->global_table, fn->name)) {
+            apexErr_runtime(vm, "global variable '%s' not found", fn->name);
+            return false;
+        }
+        if (fnval.type != APEX_VAL_FN || fnval.fnval != fn) {
+            // The global no longer holds the inlined function, so the body
+            // is skipped and whatever it holds now is called instead.
+            if (fnval.type != APEX_VAL_FN && fnval.type != APEX_VAL_CFN) {
+                apexErr_runtime(vm, "'%s' is not a function", fn->name);
+                return false;
+            }
+            while (vm->chunk->ins[vm->ip].opcode != OP_INLINE_LEAVE) {
+                vm->ip++;
+            }
+            vm->ip++;
+            if (!call_value(vm, fnval, fn->argc)) {
+                return false;
+            }
+            break;
+        }
+        // The arguments stay on the stack, held as a call's locals would be.
+        push_callframe(vm, fn->name, ins->srcloc);
+        vm->call_stack[vm->call_stack_top - 1].base = vm->stack_top - fn->argc;
+        for (int i = vm->stack_top - fn->argc; i < vm->stack_top; i++) {
+            apexVal_setassigned(vm->stack[i], true);
+            apexVal_retain(vm->stack[i]);
+        }
+        break;
+    }
+    case OP_GET_ARG: {
+        CallFrame *frame = &vm->call_stack[vm->call_stack_top - 1];
+        stack_push(vm, vm->stack[frame->base + ins->value.intval]);
+        break;
+    }
+    case OP_INLINE_LEAVE: {
+        ApexValue result = stack_pop(vm);
+        CallFrame frame = pop_callframe(vm, ins->srcloc);
+        while (vm->stack_top > frame.base) {
+            apexVal_release(stack_pop(vm));
+        }
+        stack_push(vm, result);
+        vm->obj_context = apexVal_makenull();
+        break;
+    }
+    // The intrinsics below handle the common cases in place and leave
+    // anything else, including errors, to the library function.
+    case OP_LEN: { // std:len(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        if (value->type == APEX_VAL_ARR || value->type == APEX_VAL_TYPED) {
+            *value = apexVal_makeint(apexVal_arrlen(*value));
+        } else if (value->type == APEX_VAL_STR) {
+            *value = apexVal_makeint(value->strval->len);
+        } else if (!call_library(vm, "std", "len", 1)) {
+            return false;
+        }
+        break;
+    }
+    case OP_TO_INT: { // std:int(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        if (value->type == APEX_VAL_DBL) {
+            *value = apexVal_makeint((int)value->dblval);
+        } else if (value->type != APEX_VAL_INT && !call_library(vm, "std", "int", 1)) {
+            return false;
+        }
+        break;
+    }
+    case OP_TO_STR: { // std:str(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        *value = apexVal_makestr(apexVal_tostr(*value));
+        break;
+    }
+    case OP_TO_DBL: { // std:dbl(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        if (value->type == APEX_VAL_INT) {
+            *value = apexVal_makedbl((double)value->intval);
+        } else if (value->type != APEX_VAL_DBL && !call_library(vm, "std", "dbl", 1)) {
+            return false;
+        }
+        break;
+    }
+    case OP_ABS: { // math:abs(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        if (value->type == APEX_VAL_INT) {
+            *value = apexVal_makeint(abs(value->intval));
+        } else if (!call_library(vm, "math", "abs", 1)) {
+            return false;
+        }
+        break;
+    }
+    case OP_FLOOR: { // math:floor(a)
+        ApexValue *value = &vm->stack[vm->stack_top - 1];
+        if (value->type == APEX_VAL_DBL) {
+            *value = apexVal_makedbl(floor(value->dblval));
+        } else if (value->type == APEX_VAL_INT) {
+            *value = apexVal_makedbl((double)value->intval);
+        } else if (!call_library(vm, "math", "floor", 1)) {
+            return false;
+        }
+        break;
+    }
+    case OP_MIN: // math:min(a, b, ...)
+        if (!push_extreme(vm, ins->value.intval, false) &&
+            !call_library(vm, "math", "min", ins->value.intval)) {
+            return false;
+        }
+        break;
+    case OP_MAX: // math:max(a, b, ...)
+        if (!push_extreme(vm, ins->value.intval, true) &&
+            !call_library(vm, "math", "max", ins->value.intval)) {
+            return false;
+        }
+        break;
+    case OP_PRINT: // io:print(a)
+        printf("%s\n", apexVal_tostr(stack_pop(vm))->value);
+        break;
     case OP_RETURN: {
         ApexValue ret_val;
         int ret_addr = 0;
         CallFrame frame = pop_callframe(vm, ins->srcloc);
+        // The return address sits at the frame's base, with the return
+        // value, if there is one, above it.
+        int frame_size = vm->stack_top - frame.base;
         if (vm->obj_context.type == APEX_VAL_OBJ && 
             frame.fn_name == apexStr_new("new", 3)->value) {
             ApexValue obj_context = vm->obj_context;                
-            if (vm->stack_top == 1) {
+            if (frame_size == 1) {
                 ret_addr = stack_pop(vm).intval;
-            } else if (vm->stack_top > 1) {
+            } else if (frame_size > 1) {
                 apexErr_error(vm->srcloc, "warning: return value of 'new' is discarded'");
                 stack_pop(vm);
                 ret_addr = stack_pop(vm).intval;
             }                
             stack_push(vm, obj_context);
         } else {
-            if (vm->stack_top == 1) {
+            if (frame_size == 1) {
                 ret_addr = stack_pop(vm).intval;                
-            } else if (vm->stack_top > 1) {
+            } else if (frame_size > 1) {
                 ret_val = stack_pop(vm);
                 ret_addr = stack_pop(vm).intval;
                 stack_push(vm, ret_val);
@@ -1110,74 +1638,11 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         pop_scope(&vm->local_scopes);
         break;
     }
-    case OP_CALL: {
-        ApexValue fnval = stack_pop(vm);
-        int argc = ins->value.intval;
-
-        if (fnval.type == APEX_VAL_CFN) {
-            ApexCfn cfn = fnval.cfnval;               
-            if (cfn.fn(vm, argc) != 0) {
-                return false;
-            }
-            break;
-        }
-
-        int ret_addr = vm->ip;
-        ApexFn *fn = fnval.fnval;
-        
-        if (fn->have_variadic) {
-            if (argc < fn->argc - 1) {
-                apexErr_runtime(vm,
-                    "expected at least %d arguments, got %d",
-                    fn->argc, argc);
-                return false;
-            }                
-        } else if (argc != fn->argc) {
-            apexErr_runtime(vm, 
-                "expected %d arguments, got %d", 
-                fn->argc, argc);
+    case OP_CALL:
+        if (!call_value(vm, stack_pop(vm), ins->value.intval)) {
             return false;
         }
-
-        push_callframe(vm, fn->name, ins->srcloc);
-        push_scope(&vm->local_scopes);
-
-        ApexArray *variadic_args = NULL;
-        int param_index = 0;
-        bool have_variadic = false;
-
-        if (fn->have_variadic) {
-            variadic_args = apexVal_newarray();
-        }
-
-        int variadic_index = argc - fn->argc;
-
-        for (int i = 0; i < argc; i++) {
-            if (fn->have_variadic && argc - i >= fn->argc) {
-                apexVal_arrayset(
-                    variadic_args,
-                    apexVal_makeint(variadic_index--),
-                    stack_pop(vm));
-                have_variadic = true;
-            } else {
-                if (have_variadic) {
-                    apexSym_setlocal(
-                        &vm->local_scopes, 
-                        fn->params[param_index++], 
-                        apexVal_makearr(variadic_args));
-                    have_variadic = false;
-                }
-                ApexValue value = stack_pop(vm);
-                apexSym_setlocal(
-                    &vm->local_scopes,
-                    fn->params[param_index++],
-                    value);
-            }
-        }
-        stack_push(vm, apexVal_makeint(ret_addr));
-        vm->ip = fn->addr;
         break;
-    }
     case OP_JUMP:
         vm->ip += ins->value.intval;
         break;
@@ -1229,17 +1694,17 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         }
 
         // Check if iteration is complete
-        if (index.intval >= iterable.arrval->iter_count) {
+        ApexValue key, value;
+        int iter = index.intval;
+        if (!apexVal_arraynext(iterable.arrval, &iter, &key, &value)) {
             stack_push(vm, iterable); 
             stack_push(vm, apexVal_makebool(false)); // Signal iteration end
         } else {
             // Push current value and advance index
-            ApexArrayEntry *entry = iterable.arrval->iter[index.intval];
-            
-            stack_push(vm, apexVal_makeint(index.intval + 1)); // Next index
+            stack_push(vm, apexVal_makeint(iter)); // Next index
             stack_push(vm, iterable);                
-            stack_push(vm, entry->value);
-            stack_push(vm, entry->key);
+            stack_push(vm, value);
+            stack_push(vm, key);
             stack_push(vm, apexVal_makebool(true)); // Signal iteration continues
         }
         break;
@@ -1257,6 +1722,17 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         stack_push(vm, apexVal_makearr(array));
         break;
     }
+    case OP_GET_ELEMENT_INT: { // array[index], index is an int
+        ApexValue array = vm->stack[vm->stack_top - 2];
+        int index = vm->stack[vm->stack_top - 1].intval;
+        if (array.type == APEX_VAL_ARR && !array.arrval->shared &&
+            (unsigned int)index < (unsigned int)array.arrval->vec_count) {
+            vm->stack_top -= 2;
+            stack_push(vm, array.arrval->vec[index]);
+            break;
+        }
+        // Other arrays and strings take the generic path below.
+    }
     case OP_GET_ELEMENT: { // array[index]
         ApexValue index = stack_pop(vm);
         ApexValue array = stack_pop(vm);          
@@ -1275,6 +1751,11 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         }
         case APEX_VAL_ARR:
             ApexValue value;
+            if (index.type == APEX_VAL_INT && !array.arrval->shared &&
+                (unsigned int)index.intval < (unsigned int)array.arrval->vec_count) {
+                stack_push(vm, array.arrval->vec[index.intval]);
+                break;
+            }
             if (!apexVal_arrayget(&value, array.arrval, index)) {
                 char *indexstr = apexVal_tostr(index)->value;
                 apexErr_runtime(vm, "invalid array index: %s", indexstr);
@@ -1282,6 +1763,15 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
             }
             stack_push(vm, value);
             break;            
+        case APEX_VAL_TYPED:
+            if (index.type != APEX_VAL_INT ||
+                !apexVal_typedget(&value, array.typedval, index.intval)) {
+                char *indexstr = apexVal_tostr(index)->value;
+                apexErr_runtime(vm, "invalid typed array index: %s", indexstr);
+                return false;
+            }
+            stack_push(vm, value);
+            break;
         default:
             if (array.type != APEX_VAL_ARR) {
                 apexErr_runtime(vm, 
@@ -1296,6 +1786,19 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         ApexValue index = stack_pop(vm);            
         ApexValue array = stack_pop(vm);
         ApexValue value = stack_pop(vm);            
+        if (array.type == APEX_VAL_TYPED) {
+            if (index.type != APEX_VAL_INT ||
+                (unsigned int)index.intval >= (unsigned int)array.typedval->length) {
+                char *indexstr = apexVal_tostr(index)->value;
+                apexErr_runtime(vm, "invalid typed array index: %s", indexstr);
+                return false;
+            }
+            if (!apexVal_typedset(array.typedval, index.intval, value)) {
+                apexErr_runtime(vm, "cannot store %s in a typed array", apexVal_typestr(value));
+                return false;
+            }
+            break;
+        }
         apexVal_arrayset(array.arrval, index, value);
         break;
     }
@@ -1340,8 +1843,9 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
                     apexSym_setlocal(&vm->local_scopes, fn->params[param_index++], stack_pop(vm));
                 }
             }
-            ApexObject *newobj = apexVal_objectcpy(obj);                
+            ApexObject *newobj = apexVal_newinstance(obj);                
             vm->obj_context = apexVal_makeobj(newobj);
+            vm->call_stack[vm->call_stack_top - 1].base = vm->stack_top;
             stack_push(vm, apexVal_makeint(ret_addr));
             vm->ip = fn->addr;
         } else {
@@ -1349,7 +1853,7 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
                 apexErr_runtime(vm, "expected 0 arguments, got %d", vm->stack_top);
                 return false;
             }
-            ApexObject *newobj = apexVal_objectcpy(obj);
+            ApexObject *newobj = apexVal_newinstance(obj);
             stack_push(vm, apexVal_makeobj(newobj));
         }        
         break;
@@ -1456,6 +1960,7 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
             }
         }       
         vm->obj_context = objval;
+        vm->call_stack[vm->call_stack_top - 1].base = vm->stack_top;
         stack_push(vm, apexVal_makeint(ret_addr));
         vm->ip = fn->addr;
         break;
@@ -1755,13 +2260,7 @@ static bool vm_execute(ApexVM *vm, Ins *ins) {
         ApexValue lib_name_val = stack_pop(vm);
         const char *lib_name = lib_name_val.strval->value;
         const char *fn_name = fn_name_val.strval->value;
-        ApexLibData lib_data = apexLib_get(lib_name, fn_name);
-        if (!lib_data.name || lib_data.is_var) {
-            apexErr_runtime(vm, "undefined library function '%s:%s'", lib_name, fn_name);
-            return false;
-        }
-        int argc = ins->value.intval;            
-        if (lib_data.fn(vm, argc) == 1) {
+        if (!call_library(vm, lib_name, fn_name, ins->value.intval)) {
             return false;
         }
         break;
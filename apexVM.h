@@ -5,6 +5,15 @@
 #define GLOBALS_MAX 256
 #define CALL_STACK_MAX 128
 
+/**
+ * Optimising passes of the compiler. Each one is enabled unless its
+ * environment variable is set to 0.
+ */
+#define APEX_CODEGEN_TYPES 1 /** Type-specialised opcodes, APEX_TYPES */
+#define APEX_CODEGEN_INLINE 2 /** Inlined calls, APEX_INLINE */
+#define APEX_CODEGEN_HOIST 4 /** Hoisted loop invariants, APEX_HOIST */
+#define APEX_CODEGEN_INTRINSICS 8 /** Intrinsic opcodes, APEX_INTRINSICS */
+
 #include <stdbool.h>
 #include "apexVal.h"
 #include "apexSym.h"
@@ -270,6 +279,161 @@ typedef enum {
      * fn(a, b) {}
      */
     OP_CREATE_CLOSURE,
+    /**
+     * The instructions below are emitted in place of the generic ones when
+     * type inference proved the types of their operands, and do not check
+     * them at run time.
+     *
+     * Gets an array element by an int index.
+     * a[i]
+     */
+    OP_GET_ELEMENT_INT,
+    /**
+     * Adds two ints.
+     * a + b
+     */
+    OP_ADD_INT,
+    /**
+     * Subtracts an int from an int.
+     * a - b
+     */
+    OP_SUB_INT,
+    /**
+     * Multiplies two ints.
+     * a * b
+     */
+    OP_MUL_INT,
+    /**
+     * Compares two ints for equality.
+     * a == b
+     */
+    OP_EQ_INT,
+    /**
+     * Compares two ints for inequality.
+     * a != b
+     */
+    OP_NE_INT,
+    /**
+     * Compares two ints for less than.
+     * a < b
+     */
+    OP_LT_INT,
+    /**
+     * Compares two ints for less than or equal.
+     * a <= b
+     */
+    OP_LE_INT,
+    /**
+     * Compares two ints for greater than.
+     * a > b
+     */
+    OP_GT_INT,
+    /**
+     * Compares two ints for greater than or equal.
+     * a >= b
+     */
+    OP_GE_INT,
+    /**
+     * Adds two dbls.
+     * a + b
+     */
+    OP_ADD_DBL,
+    /**
+     * Subtracts a dbl from a dbl.
+     * a - b
+     */
+    OP_SUB_DBL,
+    /**
+     * Multiplies two dbls.
+     * a * b
+     */
+    OP_MUL_DBL,
+    /**
+     * Divides a dbl by a dbl.
+     * a / b
+     */
+    OP_DIV_DBL,
+    /**
+     * Compares two dbls for less than.
+     * a < b
+     */
+    OP_LT_DBL,
+    /**
+     * Compares two dbls for less than or equal.
+     * a <= b
+     */
+    OP_LE_DBL,
+    /**
+     * Compares two dbls for greater than.
+     * a > b
+     */
+    OP_GT_DBL,
+    /**
+     * Compares two dbls for greater than or equal.
+     * a >= b
+     */
+    OP_GE_DBL,
+    /**
+     * Starts the inlined body of a function whose arguments are on the
+     * stack. If the function's global was reassigned, the body is skipped
+     * and the global is called instead.
+     * f(a, b) where f is a small global function
+     */
+    OP_INLINE_ENTER,
+    /**
+     * Pushes an argument of the innermost inlined call onto the stack.
+     * a in the inlined body of f(a, b)
+     */
+    OP_GET_ARG,
+    /**
+     * Ends an inlined body, replacing the arguments with its result.
+     */
+    OP_INLINE_LEAVE,
+    /**
+     * Pushes the length of an array, typed array or string.
+     * std:len(a)
+     */
+    OP_LEN,
+    /**
+     * Converts a value to an int.
+     * std:int(a)
+     */
+    OP_TO_INT,
+    /**
+     * Converts a value to a string.
+     * std:str(a)
+     */
+    OP_TO_STR,
+    /**
+     * Converts a value to a dbl.
+     * std:dbl(a)
+     */
+    OP_TO_DBL,
+    /**
+     * Computes the absolute value of an int.
+     * math:abs(a)
+     */
+    OP_ABS,
+    /**
+     * Rounds a number down to the nearest integer.
+     * math:floor(a)
+     */
+    OP_FLOOR,
+    /**
+     * Pushes the smallest of a number of values.
+     * math:min(a, b, ...)
+     */
+    OP_MIN,
+    /**
+     * Pushes the largest of a number of values.
+     * math:max(a, b, ...)
+     */
+    OP_MAX,
+    /**
+     * Writes a value to the standard output followed by a newline.
+     * io:print(a)
+     */
+    OP_PRINT,
     /**
      * Signifies the end of the VM execution.
      */
@@ -282,6 +446,7 @@ typedef enum {
 typedef struct {
     const char *fn_name; /** Current function name */
     SrcLoc srcloc; /** Source location of the callframe */
+    int base; /** Stack index where the values of the frame start */
 } CallFrame;
 
 /**
@@ -302,6 +467,27 @@ typedef struct {
     int ins_size; /** Size of allocated instructions */
 } Chunk;
 
+/**
+ * A prepared call of a function from native code.
+ *
+ * The parameter scope of an Apex function is kept between the calls made
+ * through the site, so repeated calls only rebind the arguments.
+ */
+typedef struct {
+    ApexValue fnval; /** Function being called */
+    int argc; /** Number of arguments passed on each call */
+    struct LocalScope *scope; /** Parameter scope kept for the next call, or NULL */
+} ApexCallSite;
+
+/**
+ * A source file of the program.
+ */
+typedef struct {
+    const char *path; /** Canonical path of the file */
+    bool included; /** Whether the file was compiled where it runs exactly once */
+    bool compiling; /** Whether the file is being compiled */
+} ApexModule;
+
 /**
  * Represents the state of the virtual machine.
  */
@@ -309,6 +495,9 @@ typedef struct ApexVM {
     CallFrame call_stack[CALL_STACK_MAX]; /** Call stack */
     int call_stack_top; /** Top of the call stack */
     bool in_function; /** Whether the code is currently in a function */
+    bool typed; /** Whether the AST being compiled carries inferred types */
+    int codegen; /** Enabled optimising passes, as APEX_CODEGEN_* flags */
+    const ApexFn *inlining; /** Function whose body is being inlined, or NULL */
     Chunk *chunk; /** Bytecode Chunk */
     Ins *ins; /** Pointer to the current instruction */
     ApexValue stack[STACK_MAX]; /** The value stack */
@@ -320,6 +509,19 @@ typedef struct ApexVM {
     SrcLoc srcloc; /** Current source location of the vm */
     SymbolTable global_table; /** Global variable table */
     ScopeStack local_scopes; /** Local scopes containing each scoped symbol table */
+    ApexArena *arena; /** Arena of the source being compiled */
+    struct ApexLoader *loader; /** Included files parsed ahead of compilation, or NULL */
+    ApexModule *modules; /** The program's source files */
+    int module_count; /** Number of modules */
+    int module_size; /** Capacity of the modules */
+    bool cwd_includes; /** Whether an include was resolved against the working directory */
+    int conditional; /** Number of enclosing statements that may not run their body exactly once */
+    struct InlineFn *inline_fns; /** Functions that calls may be inlined from */
+    int inline_count; /** Number of inlinable functions */
+    int inline_size; /** Capacity of the inlinable functions */
+    struct HoistedExpr *hoisted; /** Expressions of a loop condition read from temporaries */
+    int hoist_count; /** Number of hoisted expressions */
+    int hoist_serial; /** Number of temporaries created for hoisted expressions */
 } ApexVM;
 
 extern void apexVM_pushval(ApexVM *vm, ApexValue value);
@@ -333,9 +535,14 @@ extern void apexVM_pushnull(ApexVM *vm);
 extern ApexValue apexVM_pop(ApexVM *vm);
 extern ApexValue apexVM_peek(ApexVM *vm, int offset);
 extern bool apexVM_call(ApexVM *vm, ApexFn *fn, int argc);
+extern bool apexVM_prepare(ApexVM *vm, ApexCallSite *site, ApexValue fnval, int argc);
+extern bool apexVM_invokesite(ApexVM *vm, ApexCallSite *site, const ApexValue *argv, ApexValue *result);
+extern void apexVM_freesite(ApexCallSite *site);
+extern bool apexVM_invoke(ApexVM *vm, ApexValue fnval, const ApexValue *argv, int argc, ApexValue *result);
 extern void print_vm_instructions(ApexVM *vm);
 extern void init_vm(ApexVM *vm);
 extern void apexVM_reset(ApexVM *vm);
+extern void apexVM_unwind(ApexVM *vm);
 extern void free_vm(ApexVM *vm);
 extern bool vm_dispatch(ApexVM *vm);
 
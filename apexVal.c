@@ -1,5 +1,10 @@
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 #include "apexVal.h"
 #include "apexVM.h"
 #include "apexMem.h"
@@ -23,6 +28,7 @@
  * - type: APEX_VAL_TYPE
  * - obj: APEX_VAL_OBJ
  * - ptr: APEX_VAL_PTR
+ * - typed: APEX_VAL_TYPED
  * - null: APEX_VAL_NULL
  *
  * @param value The ApexValue to get a string representation of its type.
@@ -30,7 +36,17 @@
  * @return A string representation of the ApexValue type.
  */
 const char *apexVal_typestr(ApexValue value) {
-    switch (value.type) {
+    return apexVal_typename(value.type);
+}
+
+/**
+ * Returns the name of a value type, as reported by apexVal_typestr.
+ *
+ * @param type The value type.
+ * @return The name of the type.
+ */
+const char *apexVal_typename(ApexValueType type) {
+    switch (type) {
     case APEX_VAL_INT:
         return "int";
     case APEX_VAL_FLT:
@@ -53,6 +69,8 @@ const char *apexVal_typestr(ApexValue value) {
         return "obj";
     case APEX_VAL_PTR:
         return "ptr";
+    case APEX_VAL_TYPED:
+        return "typed";
     case APEX_VAL_NULL:
         return "null";
     }
@@ -60,9 +78,33 @@ const char *apexVal_typestr(ApexValue value) {
 }
 
 #define ARR_INIT_SIZE 16
-#define OBJ_INIT_SIZE 16
+#define ARR_ENTRY_INIT_SIZE 4
+#define ARR_VEC_INIT_SIZE 8
+#define OBJ_INIT_SIZE 4
 #define ARR_LOAD_FACTOR 0.75
-#define OBJ_LOAD_FACTOR 0.75
+#define SHAPE_LINEAR_MAX 8
+#define SHAPE_TABLE_INIT_SIZE 32
+#define ARR_USABLE(size) ((int)((size) * ARR_LOAD_FACTOR))
+
+#define CTRL_EMPTY 0x80
+#define GROUP_WIDTH 16
+#define HASH_H1(hash) ((hash) >> 7)
+#define HASH_H2(hash) ((uint8_t)((hash) & 0x7f))
+
+static ApexShape *root_shape = NULL;
+
+#if defined(__GNUC__)
+#  define ctz(x) __builtin_ctz(x)
+#else
+static inline int ctz(unsigned int x) {
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+#endif
 
 /**
  * Converts a ApexFn to its string representation.
@@ -93,8 +135,8 @@ static ApexString *fntostr(ApexFn *fn) {
 static ApexString *cfntostr(ApexCfn fn) {
     size_t size = 32 + strlen(fn.name);
     char *str = apexMem_alloc(size + 1);
-    snprintf(str, size, "[cfunction %s: %p]", fn.name, fn.fn);
-    return apexStr_save(str, size);
+    int len = snprintf(str, size, "[cfunction %s: %p]", fn.name, fn.fn);
+    return apexStr_save(str, len);
 }
 
 /**
@@ -108,8 +150,46 @@ static ApexString *cfntostr(ApexCfn fn) {
  */
 static ApexString *ptrtostr(void *ptr) {
     char *str = apexMem_alloc(32);
-    snprintf(str, 32, "[pointer %p]", ptr);
-    return apexStr_save(str, 20);
+    int len = snprintf(str, 32, "[pointer %p]", ptr);
+    return apexStr_save(str, len);
+}
+
+/**
+ * Converts a typed array to its string representation.
+ *
+ * This function takes a pointer to a typed array and returns a string
+ * representation of its elements, formatted as "<kind>[<e1>, <e2>, ...]".
+ *
+ * @param typed The pointer to the typed array to convert.
+ * @return A char pointer to the string representation of the typed array.
+ */
+static ApexString *typedtostr(ApexTypedArray *typed) {
+    const char *kind = apexVal_typedkindstr(typed->kind);
+    size_t size = 64;
+    size_t len = strlen(kind) + 1;
+    char *str = apexMem_alloc(size);
+    snprintf(str, size, "%s[", kind);
+
+    for (int i = 0; i < typed->length; i++) {
+        ApexValue value;
+        apexVal_typedget(&value, typed, i);
+        ApexString *elem = apexVal_tostr(value);
+        if (len + elem->len + 4 > size) {
+            while (len + elem->len + 4 > size) {
+                size *= 2;
+            }
+            str = apexMem_realloc(str, size);
+        }
+        if (i > 0) {
+            memcpy(str + len, ", ", 2);
+            len += 2;
+        }
+        memcpy(str + len, elem->value, elem->len);
+        len += elem->len;
+    }
+    str[len++] = ']';
+    str[len] = '\0';
+    return apexStr_save(str, len);
 }
 
 /**
@@ -164,7 +244,7 @@ static ApexString *arrtostr(ApexArray *arr) {
     int len = 1; 
     int size = 128;
     
-    if (arr->entry_count == 0) {
+    if (arr->vec_count + arr->entry_count == 0) {
         snprintf(str, size, "[]");
         return apexStr_save(str, 2);
     }
@@ -172,55 +252,52 @@ static ApexString *arrtostr(ApexArray *arr) {
     str[0] = '[';
     str[1] = '\0';
 
-    for (int i = 0; i < arr->entry_size; i++) {
-        ApexArrayEntry *entry = arr->entries[i];
-        while (entry) {
-            char *keystr = apexVal_tostr(entry->key)->value;
-            char *valstr = apexVal_tostr(entry->value)->value;
-
-            int keylen = strlen(keystr);
-            int vallen = strlen(valstr);
-            bool is_key_string = (entry->key.type == APEX_VAL_STR);
-            bool is_val_string = (entry->value.type == APEX_VAL_STR);
-
-            int elen = (is_key_string ? 2 : 0) + keylen + 4 +
-                       (is_val_string ? 2 : 0) + vallen;
-            int nspace = len + elen + (i > 0 ? 2 : 0);
-
-            if (nspace >= size) {
-                while (nspace >= size) {
-                    size *= 2;
-                }
-                str = apexMem_realloc(str, size);
-            }
+    ApexValue key, value;
+    apexArray_each(arr, key, value) {
+        char *keystr = apexVal_tostr(key)->value;
+        char *valstr = apexVal_tostr(value)->value;
 
-            if (len > 1) {
-                strcat(str, ", ");
-                len += 2;
-            }
-            if (is_key_string) {
-                str[len++] = '"';
-                strncpy(&str[len], keystr, keylen);
-                len += keylen;
-                str[len++] = '"';
-            } else {
-                strncpy(&str[len], keystr, keylen);
-                len += keylen;
-            }
-            memcpy(&str[len], " => ", 4);
-            len += 4;
-            if (is_val_string) {
-                str[len++] = '"';
-                strncpy(&str[len], valstr, vallen);
-                len += vallen;
-                str[len++] = '"';
-            } else {
-                strncpy(&str[len], valstr, vallen);
-                len += vallen;
+        int keylen = strlen(keystr);
+        int vallen = strlen(valstr);
+        bool is_key_string = (key.type == APEX_VAL_STR);
+        bool is_val_string = (value.type == APEX_VAL_STR);
+
+        int elen = (is_key_string ? 2 : 0) + keylen + 4 +
+                   (is_val_string ? 2 : 0) + vallen;
+        int nspace = len + elen + 2;
+
+        if (nspace >= size) {
+            while (nspace >= size) {
+                size *= 2;
             }
-            str[len] = '\0';
-            entry = entry->next;
+            str = apexMem_realloc(str, size);
         }
+
+        if (len > 1) {
+            strcat(str, ", ");
+            len += 2;
+        }
+        if (is_key_string) {
+            str[len++] = '"';
+            strncpy(&str[len], keystr, keylen);
+            len += keylen;
+            str[len++] = '"';
+        } else {
+            strncpy(&str[len], keystr, keylen);
+            len += keylen;
+        }
+        memcpy(&str[len], " => ", 4);
+        len += 4;
+        if (is_val_string) {
+            str[len++] = '"';
+            strncpy(&str[len], valstr, vallen);
+            len += vallen;
+            str[len++] = '"';
+        } else {
+            strncpy(&str[len], valstr, vallen);
+            len += vallen;
+        }
+        str[len] = '\0';
     }
 
     if (len + 1 >= size) {
@@ -291,6 +368,9 @@ ApexString *apexVal_tostr(ApexValue value) {
     case APEX_VAL_PTR:
         return ptrtostr(value.ptrval);
 
+    case APEX_VAL_TYPED:
+        return typedtostr(value.typedval);
+
     case APEX_VAL_NULL:
         return apexStr_new("null", 4);
     }
@@ -298,37 +378,130 @@ ApexString *apexVal_tostr(ApexValue value) {
 }
 
 /**
- * Computes a hash value for an ApexValue suitable for use as an index in an array.
+ * Returns a bitmask of the slots in a group whose control byte equals h.
+ *
+ * A group is GROUP_WIDTH consecutive control bytes. With SSE2 the whole
+ * group is compared in one instruction; otherwise the bytes are compared
+ * one at a time. Bit i of the result corresponds to the i-th byte.
+ *
+ * @param group A pointer to the first control byte of the group.
+ * @param h The control byte to look for.
+ * @return The bitmask of matching slots.
+ */
+static inline unsigned int ctrl_match(const uint8_t *group, uint8_t h) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == h) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Returns a bitmask of the empty slots in a group.
+ *
+ * CTRL_EMPTY is the only control byte with its high bit set, so with SSE2
+ * the mask is simply the high bits of the group.
+ *
+ * @param group A pointer to the first control byte of the group.
+ * @return The bitmask of empty slots.
+ */
+static inline unsigned int ctrl_match_empty(const uint8_t *group) {
+#ifdef __SSE2__
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    return ctrl_match(group, CTRL_EMPTY);
+#endif
+}
+
+/**
+ * Allocates the control bytes for a table with the given number of slots.
+ *
+ * The table is followed by a copy of its first GROUP_WIDTH control bytes,
+ * so a group starting near the end can be loaded without wrapping.
+ *
+ * @param size The number of slots, a power of two no less than GROUP_WIDTH.
+ * @return The control bytes, all marked empty.
+ */
+static uint8_t *ctrl_new(int size) {
+    uint8_t *ctrl = apexMem_alloc(size + GROUP_WIDTH);
+    memset(ctrl, CTRL_EMPTY, size + GROUP_WIDTH);
+    return ctrl;
+}
+
+/**
+ * Sets the control byte of a slot, keeping the trailing copy in sync.
+ *
+ * @param ctrl The control bytes of the table.
+ * @param size The number of slots in the table.
+ * @param slot The slot to update.
+ * @param h The new control byte.
+ */
+static inline void ctrl_set(uint8_t *ctrl, int size, int slot, uint8_t h) {
+    ctrl[slot] = h;
+    if (slot < GROUP_WIDTH) {
+        ctrl[size + slot] = h;
+    }
+}
+
+/**
+ * Finds the first empty slot on the probe sequence of a hash.
+ *
+ * Probing is linear, one group at a time, starting at the hash's home slot.
+ * The table always has at least one empty slot, so this terminates.
+ *
+ * @param ctrl The control bytes of the table.
+ * @param size The number of slots in the table.
+ * @param hash The hash to probe for.
+ * @return The index of the empty slot.
+ */
+static int ctrl_find_empty(const uint8_t *ctrl, int size, unsigned int hash) {
+    int mask = size - 1;
+    int pos = HASH_H1(hash) & mask;
+    for (;;) {
+        unsigned int empty = ctrl_match_empty(ctrl + pos);
+        if (empty) {
+            return (pos + ctz(empty)) & mask;
+        }
+        pos = (pos + GROUP_WIDTH) & mask;
+    }
+}
+
+/**
+ * Computes a hash value for an ApexValue used as an array key.
  *
- * This function takes an ApexValue and returns a hash value based on its type and value.
  * The hash values are computed as follows:
- * - Integers are returned as-is.
- * - Strings are hashed using a simple string hashing algorithm.
- * - Booleans are converted to an unsigned integer.
- * - Floats are converted to an unsigned integer using a union.
+ * - Strings use the hash cached in the interned ApexString.
+ * - Integers and booleans are mixed as 64-bit integers.
+ * - Floats and doubles are mixed using their full bit pattern, with
+ *   negative zero folded into zero since the two compare equal.
  * - Null values are given a hash value of 0.
  *
- * The hash value is then used as an index in an array.
- *
  * @param key The ApexValue to compute a hash value for.
  */
 static unsigned int get_array_index(const ApexValue key) {
     switch (key.type) {
     case APEX_VAL_INT:
-        return key.intval;
+        return apexUtil_hashint((uint64_t)(int64_t)key.intval);
     case APEX_VAL_STR:
-        return apexUtil_hash(key.strval->value);
+        return key.strval->hash;
     case APEX_VAL_BOOL:
-        return (unsigned int)key.boolval;
+        return apexUtil_hashint((uint64_t)key.boolval);
     case APEX_VAL_FLT: {
-        union { float f; unsigned int i; } flt_to_int;
-        flt_to_int.f = key.fltval;
-        return flt_to_int.i;
+        union { float f; uint32_t i; } flt_to_int;
+        flt_to_int.f = key.fltval == 0.0f ? 0.0f : key.fltval;
+        return apexUtil_hashint(flt_to_int.i);
     }
     case APEX_VAL_DBL: {
-        union { double d; unsigned int i; } dbl_to_int;
-        dbl_to_int.d = key.dblval;
-        return dbl_to_int.i;
+        union { double d; uint64_t i; } dbl_to_int;
+        dbl_to_int.d = key.dblval == 0.0 ? 0.0 : key.dblval;
+        return apexUtil_hashint(dbl_to_int.i);
     }
     default:
         return 0;
@@ -375,11 +548,22 @@ static bool value_equals(const ApexValue a, const ApexValue b) {
     }
 }
 
+/**
+ * Checks whether a value is an array or an object, whose contents can be
+ * modified through the value.
+ *
+ * @param value The value to check.
+ * @return true if the value is an array or an object, otherwise false.
+ */
+static inline bool is_container(const ApexValue value) {
+    return value.type == APEX_VAL_ARR || value.type == APEX_VAL_OBJ;
+}
+
 /**
  * Increments the reference count of a value if it is an array.
  *
  * This function increments the reference count of the given value
- * if it is of type array. This should be called when the value is
+ * if it is of type array, function, object or type. This should be called when the value is
  * assigned to a variable, passed as an argument to a function, or
  * returned from a function. The reference count ensures that the
  * memory allocated for the array and its contents is not freed until
@@ -398,10 +582,15 @@ void apexVal_retain(ApexValue value) {
         value.fnval->refcount++;
         break;
 
+    case APEX_VAL_TYPE:
     case APEX_VAL_OBJ:
         value.objval->refcount++;
         break;
 
+    case APEX_VAL_TYPED:
+        value.typedval->refcount++;
+        break;
+
     default:
         break;
     }
@@ -429,7 +618,7 @@ void apexVal_release(ApexValue value) {
         int refcount = --value.fnval->refcount;
         if (refcount <= 0) {
             free(value.fnval->params);
-            free(value.fnval);
+            apexMem_poolfree(APEX_POOL_FN, value.fnval, sizeof(ApexFn));
         }
         break;
     }
@@ -441,6 +630,13 @@ void apexVal_release(ApexValue value) {
         }
         break;
     }
+    case APEX_VAL_TYPED: {
+        int refcount = --value.typedval->refcount;
+        if (refcount <= 0) {
+            apexVal_freetyped(value.typedval);
+        }
+        break;
+    }
     default:
         break;
     }
@@ -495,7 +691,7 @@ void apexVal_setassigned(ApexValue value, bool is_assigned) {
  * @return A pointer to the newly allocated ApexFn.
  */
 ApexFn *apexVal_newfn(const char *name, char **params, int argc, bool have_variadic, int addr) {
-    ApexFn *fn = apexMem_alloc(sizeof(ApexFn));
+    ApexFn *fn = apexMem_poolalloc(APEX_POOL_FN, sizeof(ApexFn));
     fn->name = name;
     fn->argc = argc;
     fn->params = params;
@@ -525,45 +721,207 @@ ApexCfn apexVal_newcfn(char *name, int (*fn)(ApexVM *, int)) {
 }
 
 /**
- * Creates a new array with the given size.
+ * Creates a new, empty array.
  *
- * This function allocates memory for the array and its entries, and
- * initializes the array with the given size. The array is not
- * initialized with any values.
+ * This function allocates memory for the array header only. The dense
+ * part and the hash part are allocated on first use, so an array that
+ * only ever holds the keys 0..n-1 never allocates a hash part.
  *
  * @return A pointer to the newly created array.
  */
 ApexArray *apexVal_newarray(void) {
-    ApexArray *array = apexMem_alloc(sizeof(ApexArray));
-    array->entries = apexMem_calloc(sizeof(ApexArrayEntry), ARR_INIT_SIZE);
-    array->iter = apexMem_calloc(sizeof(ApexArrayEntry), ARR_INIT_SIZE);
-    array->entry_size = ARR_INIT_SIZE;
-    array->iter_size = ARR_INIT_SIZE;
+    ApexArray *array = apexMem_poolalloc(APEX_POOL_ARRAY, sizeof(ApexArray));
+    array->vec = NULL;
+    array->vec_size = 0;
+    array->vec_count = 0;
+    array->ctrl = NULL;
+    array->index = NULL;
+    array->entries = NULL;
+    array->index_size = 0;
+    array->entry_size = 0;
+    array->entry_used = 0;
     array->entry_count = 0;
-    array->iter_count = 0;
+    array->shared = NULL;
     array->refcount = 0;
     array->is_assigned = false;
     return array;
 }
 
+/**
+ * Creates a shape with the given fields.
+ *
+ * Shapes with up to SHAPE_LINEAR_MAX fields are searched by scanning their
+ * keys. Larger shapes get a lookup table, kept at most half full, that maps
+ * each key to its slot.
+ *
+ * @param keys The field names, indexed by slot. The shape takes ownership.
+ * @param count The number of fields.
+ * @return A pointer to the newly created shape.
+ */
+static ApexShape *shape_new(const char **keys, int count) {
+    ApexShape *shape = apexMem_alloc(sizeof(ApexShape));
+    shape->keys = keys;
+    shape->count = count;
+    shape->ctrl = NULL;
+    shape->table = NULL;
+    shape->table_size = 0;
+    shape->children = NULL;
+    shape->child_count = 0;
+    shape->child_size = 0;
+
+    if (count > SHAPE_LINEAR_MAX) {
+        int size = SHAPE_TABLE_INIT_SIZE;
+        while (size < count * 2) {
+            size *= 2;
+        }
+        shape->ctrl = ctrl_new(size);
+        shape->table = apexMem_alloc(sizeof(int) * size);
+        shape->table_size = size;
+        for (int i = 0; i < count; i++) {
+            unsigned int hash = apexUtil_hashptr(keys[i]);
+            int slot = ctrl_find_empty(shape->ctrl, size, hash);
+            ctrl_set(shape->ctrl, size, slot, HASH_H2(hash));
+            shape->table[slot] = i;
+        }
+    }
+    return shape;
+}
+
+/**
+ * Returns the empty shape at the root of the transition tree, creating it
+ * on first use.
+ */
+static ApexShape *shape_root(void) {
+    if (!root_shape) {
+        root_shape = shape_new(NULL, 0);
+    }
+    return root_shape;
+}
+
+/**
+ * Finds the slot of a field in a shape.
+ *
+ * Keys are interned strings, so they are hashed and compared by pointer.
+ *
+ * @param shape A pointer to the shape to search.
+ * @param key The field name to look for.
+ * @return The slot of the field, or -1 if the shape has no such field.
+ */
+static int shape_lookup(const ApexShape *shape, const char *key) {
+    if (!shape->ctrl) {
+        for (int i = 0; i < shape->count; i++) {
+            if (shape->keys[i] == key) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    unsigned int hash = apexUtil_hashptr(key);
+    int mask = shape->table_size - 1;
+    int pos = HASH_H1(hash) & mask;
+    uint8_t h2 = HASH_H2(hash);
+    for (;;) {
+        const uint8_t *group = shape->ctrl + pos;
+        unsigned int match = ctrl_match(group, h2);
+        while (match) {
+            int slot = shape->table[(pos + ctz(match)) & mask];
+            if (shape->keys[slot] == key) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        if (ctrl_match_empty(group)) {
+            return -1;
+        }
+        pos = (pos + GROUP_WIDTH) & mask;
+    }
+}
+
+/**
+ * Returns the shape reached by adding a field to a shape.
+ *
+ * The transition is looked up among the shape's children, so that objects
+ * that add the same fields in the same order end up sharing a shape. If
+ * there is no such child yet, it is created with the new field in the
+ * next slot.
+ *
+ * @param shape A pointer to the shape to transition from.
+ * @param key The name of the new field.
+ * @return A pointer to the shape with the added field.
+ */
+static ApexShape *shape_transition(ApexShape *shape, const char *key) {
+    for (int i = 0; i < shape->child_count; i++) {
+        ApexShape *child = shape->children[i];
+        if (child->keys[shape->count] == key) {
+            return child;
+        }
+    }
+
+    const char **keys = apexMem_alloc(sizeof(const char *) * (shape->count + 1));
+    for (int i = 0; i < shape->count; i++) {
+        keys[i] = shape->keys[i];
+    }
+    keys[shape->count] = key;
+    ApexShape *child = shape_new(keys, shape->count + 1);
+
+    if (shape->child_count == shape->child_size) {
+        shape->child_size = shape->child_size ? shape->child_size * 2 : 2;
+        shape->children = apexMem_realloc(shape->children, sizeof(ApexShape *) * shape->child_size);
+    }
+    shape->children[shape->child_count++] = child;
+    return child;
+}
+
+/**
+ * Frees a shape along with all the shapes derived from it.
+ *
+ * @param shape A pointer to the shape to free.
+ */
+static void shape_free(ApexShape *shape) {
+    for (int i = 0; i < shape->child_count; i++) {
+        shape_free(shape->children[i]);
+    }
+    free(shape->keys);
+    free(shape->ctrl);
+    free(shape->table);
+    free(shape->children);
+    free(shape);
+}
+
+/**
+ * Frees the shape tree.
+ *
+ * This function is called once, at the end of the program, after every
+ * object has been freed.
+ */
+void apexVal_freeshapes(void) {
+    if (root_shape) {
+        shape_free(root_shape);
+        root_shape = NULL;
+    }
+}
+
 /**
  * Creates a new object with the given name.
  *
  * This function allocates memory for a new ApexObject and initializes
- * its fields. The object is given an initial size, and its reference
- * count is set to one. The entries in the object are initialized based
- * on the defined initial size.
+ * its fields. The object starts out with the empty shape and no slots,
+ * and its reference count is set to zero.
  *
  * @param name The name to assign to the new object.
  * @return A pointer to the newly created ApexObject.
  */
 ApexObject *apexVal_newobject(const char *name) {
-    ApexObject *object = apexMem_alloc(sizeof(ApexObject));
-    object->entries = apexMem_calloc(sizeof(ApexObjectEntry), OBJ_INIT_SIZE);
-    object->size = OBJ_INIT_SIZE;
-    object->count = 0;
+    ApexObject *object = apexMem_poolalloc(APEX_POOL_OBJECT, sizeof(ApexObject));
+    object->shape = shape_root();
+    object->slots = NULL;
+    object->slot_size = 0;
+    object->shared = NULL;
     object->refcount = 0;
     object->name = name;
+    object->type = NULL;
+    object->tmpl = NULL;
     return object;
 }
 
@@ -572,215 +930,350 @@ ApexObject *apexVal_newobject(const char *name) {
  *
  * This function iterates through all the entries in the array, freeing all
  * the keys and values associated with each entry. After that, it frees the
- * memory allocated for the array itself.
+ * memory allocated for the array itself. Storage that is still shared with
+ * other arrays is left to them.
  *
  * @param array The array to free.
  */
 void apexVal_freearray(ApexArray *array) {
-    for (int i = 0; i < array->entry_size; i++) {
-        ApexArrayEntry *entry = array->entries[i];
-        while (entry) {
-            ApexArrayEntry *next = entry->next;
+    if (array->shared) {
+        if (*array->shared > 1) {
+            (*array->shared)--;
+            apexMem_poolfree(APEX_POOL_ARRAY, array, sizeof(ApexArray));
+            return;
+        }
+        free(array->shared);
+    }
+    for (int i = 0; i < array->vec_count; i++) {
+        apexVal_release(array->vec[i]);
+    }
+    for (int i = 0; i < array->entry_used; i++) {
+        ApexArrayEntry *entry = &array->entries[i];
+        if (!entry->deleted) {
             apexVal_release(entry->key);
             apexVal_release(entry->value);
-            free(entry);
-            entry = next;
         }
     }
+    free(array->vec);
+    free(array->ctrl);
+    free(array->index);
     free(array->entries);
-    free(array->iter);
-    free(array);
+    apexMem_poolfree(APEX_POOL_ARRAY, array, sizeof(ApexArray));
+}
+
+/**
+ * Discards the instance template of a type, if it has one.
+ *
+ * @param object A pointer to the type whose template is discarded.
+ */
+static void object_drop_template(ApexObject *object) {
+    if (object->tmpl) {
+        free(object->tmpl->slots);
+        free(object->tmpl);
+        object->tmpl = NULL;
+    }
 }
 
 /**
  * Frees all memory allocated for the given object.
  *
- * This function iterates through all the entries in the object, freeing all
- * the values associated with each entry. After that, it frees the memory
- * allocated for the object itself.
+ * This function iterates through all the slots in the object, freeing all
+ * the values stored in them. After that, it frees the memory allocated for
+ * the object itself and releases the type of an instance. The object's
+ * shape is shared and stays alive, and so do slots that are still shared
+ * with other objects.
  *
  * @param object The object to free.
  */
 void apexVal_freeobject(ApexObject *object) {
-    for (int i = 0; i < object->size; i++) {
-        ApexObjectEntry *entry = object->entries[i];
-        while (entry) {
-            ApexObjectEntry *next = entry->next;
-            apexVal_release(entry->value);
-            free(entry);
-            entry = next;
+    if (object->shared && *object->shared > 1) {
+        (*object->shared)--;
+    } else {
+        for (int i = 0; i < object->shape->count; i++) {
+            apexVal_release(object->slots[i]);
         }
+        free(object->shared);
+        free(object->slots);
+    }
+    object_drop_template(object);
+    if (object->type) {
+        apexVal_release(apexVal_maketype(object->type));
     }
-    free(object->entries);
-    free(object);
+    apexMem_poolfree(APEX_POOL_OBJECT, object, sizeof(ApexObject));
 }
 
 /**
- * Resizes the array to twice its current size.
+ * Returns the number of bytes used by each slot of an index table.
  *
- * This function is called when the load factor of the array exceeds a
- * certain threshold (75%). It allocates a new array of symbols with
- * twice the size of the current one, and rehashes all the symbols in
- * the array to their new positions in the new array. Finally, it frees
- * the old array and sets the array's size to the new size.
+ * Tables of up to 256 slots store entry positions in one byte, tables of up
+ * to 65536 slots in two bytes, and larger tables in four bytes. A table can
+ * never hold more entries than it has slots, so positions always fit.
  *
- * @param array A pointer to the array to resize.
+ * @param size The number of slots in the index table.
+ * @return The width of a slot in bytes.
  */
-static void array_resize_entries(ApexArray *array) {
-    int new_size = array->entry_size * 2;
-    ApexArrayEntry **new_entries = apexMem_calloc(new_size, sizeof(ApexObjectEntry *));
-    for (int i = 0; i < array->entry_size; i++) {
-        ApexArrayEntry *entry = array->entries[i];
-        while (entry) {
-            unsigned int index = get_array_index(entry->key) % new_size;
-            ApexArrayEntry *next = entry->next;
-            entry->next = new_entries[index];
-            new_entries[index] = entry;
-            entry = next;
-        }
+static size_t index_width(int size) {
+    if (size <= 0x100) {
+        return sizeof(uint8_t);
     }
-    free(array->entries);
-    array->entries = new_entries;
-    array->entry_size = new_size;
+    if (size <= 0x10000) {
+        return sizeof(uint16_t);
+    }
+    return sizeof(uint32_t);
 }
 
 /**
- * Resizes the array's iterator to twice its current size.
+ * Returns the entry position stored in a slot of an array's index table.
  *
- * This function is called when the number of elements in the array exceeds
- * the current size of the iterator. It allocates a new array of symbols with
- * twice the size of the current one, and copies the existing elements to
- * the new array. Finally, it frees the old array and sets the array's
- * iterator size to the new size.
+ * @param array A pointer to the array.
+ * @param slot The slot to read.
+ * @return The position of the slot's entry in the array's entries.
+ */
+static inline int index_get(const ApexArray *array, int slot) {
+    if (array->index_size <= 0x100) {
+        return ((const uint8_t *)array->index)[slot];
+    }
+    if (array->index_size <= 0x10000) {
+        return ((const uint16_t *)array->index)[slot];
+    }
+    return ((const uint32_t *)array->index)[slot];
+}
+
+/**
+ * Stores an entry position in a slot of an array's index table.
  *
- * @param array A pointer to the array whose iterator is to be resized.
+ * @param array A pointer to the array.
+ * @param slot The slot to write.
+ * @param pos The position of the entry in the array's entries.
  */
-static void array_resize_iter(ApexArray *array) {
-    int new_size = array->iter_size * 2;
-    ApexArrayEntry **new_iter = apexMem_calloc(new_size, sizeof(ApexObjectEntry *));
-    for (int i = 0; i < array->iter_count; i++) {
-        new_iter[i] = array->iter[i];
+static inline void index_set(ApexArray *array, int slot, int pos) {
+    if (array->index_size <= 0x100) {
+        ((uint8_t *)array->index)[slot] = (uint8_t)pos;
+    } else if (array->index_size <= 0x10000) {
+        ((uint16_t *)array->index)[slot] = (uint16_t)pos;
+    } else {
+        ((uint32_t *)array->index)[slot] = (uint32_t)pos;
     }
-    free(array->iter);
-    array->iter = new_iter;
-    array->iter_size = new_size;
 }
 
 /**
- * Resizes the object to twice its current size.
+ * Rebuilds the index table of an array with the given number of slots.
  *
- * This function is called when the load factor of the object exceeds a
- * certain threshold (75%). It allocates a new array of entries with
- * twice the size of the current one, and rehashes all the entries in
- * the object to their new positions in the new array. Finally, it frees
- * the old array and sets the object's size to the new size.
+ * This function allocates new control bytes and positions and inserts every
+ * live entry at the first empty slot of its probe sequence, using the
+ * entry's stored hash. The entries themselves are left untouched.
  *
- * @param object A pointer to the object to resize.
+ * @param array A pointer to the array whose index table is rebuilt.
+ * @param size The new number of slots, a power of two.
  */
-static void object_resize(ApexObject *object) {
-    int new_size = object->size * 2;
-    ApexObjectEntry **new_entries = apexMem_calloc(new_size, sizeof(ApexObjectEntry *));
-    for (int i = 0; i < object->size; i++) {
-        ApexObjectEntry *entry = object->entries[i];
-        while (entry) {
-            unsigned int index = apexUtil_hash(entry->key) % new_size;
-            ApexObjectEntry *next = entry->next;
-            entry->next = new_entries[index];
-            new_entries[index] = entry;
-            entry = next;
+static void array_build_index(ApexArray *array, int size) {
+    free(array->ctrl);
+    free(array->index);
+    array->ctrl = ctrl_new(size);
+    array->index = apexMem_alloc(index_width(size) * size);
+    array->index_size = size;
+    for (int i = 0; i < array->entry_used; i++) {
+        ApexArrayEntry *entry = &array->entries[i];
+        if (entry->deleted) {
+            continue;
         }
+        int slot = ctrl_find_empty(array->ctrl, size, entry->hash);
+        ctrl_set(array->ctrl, size, slot, HASH_H2(entry->hash));
+        index_set(array, slot, i);
     }
-    free(object->entries);
-    object->entries = new_entries;
-    object->size = new_size;
 }
 
 /**
- * Sets a key-value pair in the array.
+ * Removes the deleted entries from the hash part of an array.
  *
- * This function inserts or updates a key-value pair in the given array. If the
- * key already exists, the corresponding value is updated. If the key does not
- * exist, a new entry is created and added to the array. The array is resized
- * if its load factor exceeds the defined threshold.
+ * The live entries are moved to the front in their insertion order, and
+ * the entries are reallocated with the given capacity, which must hold
+ * every live entry. Since positions change, the index table has to be
+ * rebuilt afterwards.
  *
- * @param array A pointer to the array where the key-value pair will be set.
- * @param key The key to identify the value.
- * @param value The value to be associated with the key.
+ * @param array A pointer to the array to compact.
+ * @param capacity The new capacity of the entries.
  */
-void apexVal_arrayset(ApexArray *array, ApexValue key, ApexValue value) {
-    unsigned int index = get_array_index(key) % array->entry_size;
-    ApexArrayEntry *entry = array->entries[index];
-    while (entry) {
-        if (value_equals(entry->key, key)) {
-            apexVal_release(entry->value);
-            apexVal_retain(value);
-            array->iter[entry->index]->value = value;
-            entry->value = value;
-            return;
+static void array_compact(ApexArray *array, int capacity) {
+    int count = 0;
+    for (int i = 0; i < array->entry_used; i++) {
+        if (!array->entries[i].deleted) {
+            array->entries[count++] = array->entries[i];
         }
-        entry = entry->next;
     }
+    array->entries = apexMem_realloc(array->entries, sizeof(ApexArrayEntry) * capacity);
+    array->entry_size = capacity;
+    array->entry_used = count;
+}
 
-    apexVal_setassigned(value, true);
-    apexVal_retain(value);
 
-    entry = apexMem_alloc(sizeof(ApexArrayEntry));
-    entry->key = key;
-    entry->value = value;
-    entry->next = array->entries[index];
-    entry->index = array->iter_count;
-    array->entries[index] = entry;
-    array->iter[array->iter_count++] = entry;
-    array->entry_count++;
+/**
+ * Allocates the hash part of an array.
+ *
+ * @param array A pointer to the array whose hash part is allocated.
+ */
+static void array_init_hash(ApexArray *array) {
+    array->entries = apexMem_alloc(sizeof(ApexArrayEntry) * ARR_ENTRY_INIT_SIZE);
+    array->entry_size = ARR_ENTRY_INIT_SIZE;
+    array->entry_used = 0;
+    array->entry_count = 0;
+    array_build_index(array, ARR_INIT_SIZE);
+}
 
-    if ((float)array->entry_count / array->entry_size > ARR_LOAD_FACTOR) {
-        array_resize_entries(array);
+/**
+ * Finds the slot holding a key in the hash part of an array.
+ *
+ * The probe compares the 7-bit hash fragment of a whole group of slots at
+ * once and only looks at the entries whose fragment matches. Since probing
+ * is linear and deletion never leaves tombstones, the key cannot be past
+ * the first group that contains an empty slot.
+ *
+ * @param array A pointer to the array to search.
+ * @param key The key to look for.
+ * @param hash The hash of the key.
+ * @return The slot holding the key, or -1 if the key is not present.
+ */
+static int array_find_slot(ApexArray *array, ApexValue key, unsigned int hash) {
+    int mask = array->index_size - 1;
+    int pos = HASH_H1(hash) & mask;
+    uint8_t h2 = HASH_H2(hash);
+    for (;;) {
+        const uint8_t *group = array->ctrl + pos;
+        unsigned int match = ctrl_match(group, h2);
+        while (match) {
+            int slot = (pos + ctz(match)) & mask;
+            ApexArrayEntry *entry = &array->entries[index_get(array, slot)];
+            if (entry->hash == hash && value_equals(entry->key, key)) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+        if (ctrl_match_empty(group)) {
+            return -1;
+        }
+        pos = (pos + GROUP_WIDTH) & mask;
     }
-    if ((float)array->iter_count / array->iter_size > ARR_LOAD_FACTOR) {
-        array_resize_iter(array);
+}
+
+
+/**
+ * Appends a value to the dense part of an array, growing it as needed.
+ *
+ * @param array A pointer to the array to append to.
+ * @param value The value to store under the key vec_count.
+ */
+static void array_push_vec(ApexArray *array, ApexValue value) {
+    if (array->vec_count == array->vec_size) {
+        array->vec_size = array->vec_size ? array->vec_size * 2 : ARR_VEC_INIT_SIZE;
+        array->vec = apexMem_realloc(array->vec, sizeof(ApexValue) * array->vec_size);
     }
+    array->vec[array->vec_count++] = value;
 }
 
 /**
- * Sets a key-value pair in the object.
+ * Makes room for one more entry in the hash part of an array.
  *
- * This function inserts or updates a key-value pair in the given object. If the
- * key already exists, the corresponding value is updated. If the key does not
- * exist, a new entry is created and added to the object. The object is resized
- * if its load factor exceeds the defined threshold.
+ * When the entries are full, they are compacted in place if at least a
+ * quarter of them are deleted. Otherwise they grow, up to the load limit of
+ * the index table (75%); past that limit the index table doubles as well.
  *
- * @param object A pointer to the object where the key-value pair will be set.
- * @param key The key to identify the value.
- * @param value The value to be associated with the key.
+ * @param array A pointer to the array to make room in.
  */
-void apexVal_objectset(ApexObject *object, const char *key, ApexValue value) {
-    unsigned int index = apexUtil_hash(key) % object->size;
-    ApexObjectEntry *entry = object->entries[index];
-
-    while (entry) {
-        if (entry->key == key) {
-            apexVal_release(entry->value);
-            apexVal_retain(value);
-            entry->value = value;
-            return;
+static void array_reserve(ApexArray *array) {
+    if (array->entry_used < array->entry_size) {
+        return;
+    }
+    if (array->entry_used - array->entry_count > array->entry_used / 4) {
+        array_compact(array, array->entry_size);
+        array_build_index(array, array->index_size);
+    } else if (array->entry_size < ARR_USABLE(array->index_size)) {
+        int capacity = array->entry_size * 2;
+        if (capacity > ARR_USABLE(array->index_size)) {
+            capacity = ARR_USABLE(array->index_size);
         }
-        entry = entry->next;
+        array->entries = apexMem_realloc(array->entries, sizeof(ApexArrayEntry) * capacity);
+        array->entry_size = capacity;
+    } else {
+        int size = array->index_size * 2;
+        array_compact(array, array->entry_size * 2);
+        array_build_index(array, size);
     }
+}
 
-    entry = apexMem_alloc(sizeof(ApexObjectEntry));
-    apexVal_retain(value);
-    apexVal_setassigned(value, true);
+/**
+ * Inserts a new entry into the hash part of an array.
+ *
+ * The entry is appended to the entries, so that iteration follows insertion
+ * order, and its position is stored in the first empty slot of its probe
+ * sequence. The key must not already be present in the array.
+ *
+ * @param array A pointer to the array to insert into.
+ * @param key The key of the new entry.
+ * @param value The value of the new entry.
+ * @param hash The hash of the key.
+ */
+static void array_insert_hash(ApexArray *array, ApexValue key, ApexValue value, unsigned int hash) {
+    if (!array->entries) {
+        array_init_hash(array);
+    } else {
+        array_reserve(array);
+    }
+    int pos = array->entry_used++;
+    ApexArrayEntry *entry = &array->entries[pos];
     entry->key = key;
     entry->value = value;
-    entry->next = object->entries[index];
-    object->entries[index] = entry;
-    object->count++;
+    entry->hash = hash;
+    entry->deleted = false;
+    array->entry_count++;
 
-    if ((float)object->count / object->size > OBJ_LOAD_FACTOR) {
-        object_resize(object);
-    }
+    int slot = ctrl_find_empty(array->ctrl, array->index_size, hash);
+    ctrl_set(array->ctrl, array->index_size, slot, HASH_H2(hash));
+    index_set(array, slot, pos);
 }
 
+/**
+ * Moves the dense part of an array into its hash part.
+ *
+ * This is needed when a key in the middle of the dense part is deleted,
+ * since the dense part cannot have holes. The dense values come first in
+ * insertion order, so the entries are rebuilt with the dense values
+ * followed by the live hash entries, and the index table is sized to hold
+ * all of them.
+ *
+ * @param array A pointer to the array whose dense part is moved.
+ */
+static void array_spill_vec(ApexArray *array) {
+    int count = array->vec_count + array->entry_count;
+    int size = ARR_INIT_SIZE;
+    while (ARR_USABLE(size) < count) {
+        size *= 2;
+    }
+
+    ApexArrayEntry *entries = apexMem_alloc(sizeof(ApexArrayEntry) * ARR_USABLE(size));
+    for (int i = 0; i < array->vec_count; i++) {
+        entries[i].key = apexVal_makeint(i);
+        entries[i].value = array->vec[i];
+        entries[i].hash = get_array_index(entries[i].key);
+        entries[i].deleted = false;
+    }
+    int pos = array->vec_count;
+    for (int i = 0; i < array->entry_used; i++) {
+        if (!array->entries[i].deleted) {
+            entries[pos++] = array->entries[i];
+        }
+    }
+    free(array->entries);
+    array->entries = entries;
+    array->entry_size = ARR_USABLE(size);
+    array->entry_used = count;
+    array->entry_count = count;
+    array_build_index(array, size);
+
+    free(array->vec);
+    array->vec = NULL;
+    array->vec_size = 0;
+    array->vec_count = 0;
+}
 
 /**
  * Creates a copy of a given ApexFn structure.
@@ -795,7 +1288,7 @@ void apexVal_objectset(ApexObject *object, const char *key, ApexValue value) {
  * @return A pointer to the newly allocated copy of the given ApexFn.
  */
 ApexFn *apexVal_fncpy(ApexFn *fn) {
-    ApexFn *new_fn = apexMem_alloc(sizeof(ApexFn));
+    ApexFn *new_fn = apexMem_poolalloc(APEX_POOL_FN, sizeof(ApexFn));
     new_fn->name = fn->name;
     new_fn->argc = fn->argc;
     new_fn->params = apexMem_alloc(sizeof(char *) * fn->argc);
@@ -809,120 +1302,318 @@ ApexFn *apexVal_fncpy(ApexFn *fn) {
 }
 
 /**
- * Creates a deep copy of a given ApexArray structure.
+ * Copies a value stored in an array or object.
+ *
+ * Objects and arrays are copied with apexVal_objectcpy and apexVal_arrcpy,
+ * which share their storage until it is modified, and functions and typed
+ * arrays are copied with apexVal_fncpy and apexVal_typedcpy. Other values are returned as-is. The result is
+ * retained on behalf of the container that stores it.
+ *
+ * @param value The value to copy.
+ * @return The copied value.
+ */
+static ApexValue array_copy_value(ApexValue value) {
+    ApexValue copy;
+    switch (value.type) {
+    case APEX_VAL_OBJ:
+        copy = apexVal_makeobj(apexVal_objectcpy(value.objval));
+        break;
+    case APEX_VAL_FN:
+        copy = apexVal_makefn(apexVal_fncpy(value.fnval));
+        break;
+    case APEX_VAL_ARR:
+        copy = apexVal_makearr(apexVal_arrcpy(value.arrval));
+        break;
+    case APEX_VAL_TYPED:
+        copy = apexVal_maketyped(apexVal_typedcpy(value.typedval));
+        break;
+    default:
+        copy = value;
+        break;
+    }
+    apexVal_retain(copy);
+    return copy;
+}
+
+/**
+ * Creates a copy of a given ApexArray structure.
  *
- * This function allocates memory for a new ApexArray structure and duplicates
- * the fields of the provided ApexArray, including its size, entries, and
- * iterator. The reference count of the new array is initialized to zero. The
- * entries are copied recursively, so that the new array does not share any
- * memory with the original array.
+ * The copy is a new array header that shares the storage of the original,
+ * and the number of arrays sharing it is incremented. The actual copy is
+ * deferred until either array is modified, so copying is O(1). The
+ * reference count of the new array is initialized to zero.
  *
  * @param array A pointer to the ApexArray structure to be copied.
  * @return A pointer to the newly allocated copy of the given ApexArray.
  */
 ApexArray *apexVal_arrcpy(ApexArray *array) {
-    ApexArray *newarr = apexMem_alloc(sizeof(ApexArray));
-    newarr->entries = apexMem_calloc(sizeof(ApexArrayEntry), array->entry_size);
-    newarr->iter = apexMem_calloc(sizeof(ApexArrayEntry), array->iter_size);
-    newarr->entry_size = array->entry_size;
-    newarr->iter_size = array->iter_size;
-    newarr->entry_count = array->entry_count;
-    newarr->iter_count = array->iter_count;
-    newarr->refcount = 0;
+    ApexArray *newarr = apexVal_newarray();
     newarr->is_assigned = array->is_assigned;
+    if (!array->vec && !array->entries) {
+        return newarr;
+    }
 
-    for (int i = 0; i < array->entry_size; i++) {
-        ApexArrayEntry *entry = array->entries[i];
-        ApexArrayEntry **newentry_ptr = &newarr->entries[i];
-
-        while (entry) {
-            ApexArrayEntry *newentry = apexMem_alloc(sizeof(ApexArrayEntry));
-            switch (entry->value.type) {
-            case APEX_VAL_OBJ: {
-                ApexObject *objcpy = apexVal_objectcpy(entry->value.objval);
-                newentry->value = apexVal_makeobj(objcpy);
-                break;
-            }
-            case APEX_VAL_FN: {
-                ApexFn *fn = apexVal_fncpy(entry->value.fnval);
-                newentry->value = apexVal_makefn(fn);
-                break;
-            } 
-            case APEX_VAL_ARR: {
-                ApexArray *array = apexVal_arrcpy(entry->value.arrval);
-                newentry->value = apexVal_makearr(array);
-                break;
-            }
-            default:
-                newentry->value = entry->value;
-            }
-            newentry->key = entry->key;
-            newentry->index = entry->index;
-            newarr->iter[entry->index] = newentry;
-            *newentry_ptr = newentry;
-            newentry_ptr = &newentry->next;
-            entry = entry->next;
-        }
-        *newentry_ptr = NULL;
+    if (!array->shared) {
+        array->shared = apexMem_alloc(sizeof(int));
+        *array->shared = 1;
     }
+    (*array->shared)++;
+    *newarr = *array;
+    newarr->refcount = 0;
     return newarr;
 }
 
 /**
- * Creates a deep copy of a given object.
+ * Gives an array a private copy of its storage, if it is shared.
  *
- * This function allocates memory for a new ApexObject structure and initializes
- * its fields. The object is then populated with copies of each key-value pair
- * in the given object. If the value in a key-value pair is an object, the
- * function is called recursively to make a deep copy of the object. If the
- * value in a key-value pair is a function, the function is shallow copied.
+ * This must be called before the storage of an array is modified, and
+ * before a container is handed out from it, since the caller may modify
+ * that container in turn. If the other arrays sharing the storage are
+ * gone, the array simply takes it over. Otherwise the dense part, entries
+ * and index table are copied; the values are copied with
+ * array_copy_value, so nested arrays and objects are themselves only
+ * copied once they are modified.
+ *
+ * @param array A pointer to the array to unshare.
+ */
+static void array_unshare(ApexArray *array) {
+    if (!array->shared) {
+        return;
+    }
+    if (*array->shared == 1) {
+        free(array->shared);
+        array->shared = NULL;
+        return;
+    }
+    (*array->shared)--;
+    array->shared = NULL;
+
+    if (array->vec) {
+        ApexValue *vec = array->vec;
+        array->vec = apexMem_alloc(sizeof(ApexValue) * array->vec_size);
+        for (int i = 0; i < array->vec_count; i++) {
+            array->vec[i] = array_copy_value(vec[i]);
+        }
+    }
+    if (!array->entries) {
+        return;
+    }
+
+    size_t index_bytes = index_width(array->index_size) * array->index_size;
+    uint8_t *ctrl = array->ctrl;
+    void *index = array->index;
+    ApexArrayEntry *entries = array->entries;
+    array->ctrl = apexMem_alloc(array->index_size + GROUP_WIDTH);
+    memcpy(array->ctrl, ctrl, array->index_size + GROUP_WIDTH);
+    array->index = apexMem_alloc(index_bytes);
+    memcpy(array->index, index, index_bytes);
+    array->entries = apexMem_alloc(sizeof(ApexArrayEntry) * array->entry_size);
+    memcpy(array->entries, entries, sizeof(ApexArrayEntry) * array->entry_used);
+    for (int i = 0; i < array->entry_used; i++) {
+        if (!entries[i].deleted) {
+            array->entries[i].value = array_copy_value(entries[i].value);
+        }
+    }
+}
+
+/**
+ * Creates a copy of a given object.
+ *
+ * This function allocates memory for a new ApexObject structure that has
+ * the shape of the original and shares its slots, like apexVal_arrcpy does
+ * for arrays. The slots are copied once either object is modified.
  *
  * @param object The object to be copied.
  * @return A pointer to the newly allocated ApexObject.
  */
 ApexObject *apexVal_objectcpy(ApexObject *object) {
-    ApexObject *newobj = apexMem_alloc(sizeof(ApexObject));
-    newobj->entries = apexMem_calloc(sizeof(ApexObjectEntry), object->size);
-    newobj->size = object->size;
-    newobj->count = object->count;
+    ApexObject *newobj = apexMem_poolalloc(APEX_POOL_OBJECT, sizeof(ApexObject));
+    if (object->slots && !object->shared) {
+        object->shared = apexMem_alloc(sizeof(int));
+        *object->shared = 1;
+    }
+    if (object->shared) {
+        (*object->shared)++;
+    }
+    *newobj = *object;
     newobj->refcount = 0;
-    newobj->name = object->name;
-    
-    for (int i = 0; i < object->size; i++) {
-        ApexObjectEntry *entry = object->entries[i];
-        ApexObjectEntry **newentry_ptr = &newobj->entries[i];
-
-        while (entry) {
-            ApexObjectEntry *newentry = apexMem_alloc(sizeof(ApexObjectEntry));
-            newentry->key = entry->key;
-            switch (entry->value.type) {
-            case APEX_VAL_OBJ: {
-                ApexObject *objcpy = apexVal_objectcpy(entry->value.objval);
-                newentry->value = apexVal_makeobj(objcpy);
-                break;
-            } 
-            case APEX_VAL_FN: {
-                ApexFn *fn = apexVal_fncpy(entry->value.fnval);
-                newentry->value = apexVal_makefn(fn);
-                break;
-            } 
-            case APEX_VAL_ARR: {
-                ApexArray *arrcpy = apexVal_arrcpy(entry->value.arrval);
-                newentry->value = apexVal_makearr(arrcpy);
-                break;
-            }
-            default:
-                newentry->value = entry->value;
-                break;
-            }
+    newobj->tmpl = NULL;
+    if (newobj->type) {
+        apexVal_retain(apexVal_maketype(newobj->type));
+    }
+    return newobj;
+}
+
+/**
+ * Gives an object a private copy of its slots, if they are shared.
+ *
+ * This works like array_unshare. Since the template of a type borrows its
+ * values from the slots, the template is dropped when the slots are copied.
+ *
+ * @param object A pointer to the object to unshare.
+ */
+static void object_unshare(ApexObject *object) {
+    if (!object->shared) {
+        return;
+    }
+    if (*object->shared == 1) {
+        free(object->shared);
+        object->shared = NULL;
+        return;
+    }
+    (*object->shared)--;
+    object->shared = NULL;
+    object_drop_template(object);
+
+    ApexValue *slots = object->slots;
+    object->slots = apexMem_alloc(sizeof(ApexValue) * object->slot_size);
+    for (int i = 0; i < object->shape->count; i++) {
+        object->slots[i] = array_copy_value(slots[i]);
+    }
+}
+
+/**
+ * Sets a key-value pair in the array.
+ *
+ * This function inserts or updates a key-value pair in the given array. An
+ * integer key inside the dense part is stored directly in the vector, and
+ * the key vec_count extends the vector as long as the hash part is empty.
+ * Any other key goes to the hash part: if the key already exists, the
+ * corresponding value is updated, otherwise a new entry is created. The
+ * hash part is resized if its load factor would exceed the defined
+ * threshold.
+ *
+ * @param array A pointer to the array where the key-value pair will be set.
+ * @param key The key to identify the value.
+ * @param value The value to be associated with the key.
+ */
+void apexVal_arrayset(ApexArray *array, ApexValue key, ApexValue value) {
+    array_unshare(array);
+    if (key.type == APEX_VAL_INT) {
+        if (key.intval >= 0 && key.intval < array->vec_count) {
+            apexVal_retain(value);
+            apexVal_release(array->vec[key.intval]);
+            array->vec[key.intval] = value;
+            return;
+        }
+        if (key.intval == array->vec_count && array->entry_count == 0) {
+            apexVal_setassigned(value, true);
+            apexVal_retain(value);
+            array_push_vec(array, value);
+            return;
+        }
+    }
 
-            *newentry_ptr = newentry;
-            newentry_ptr = &newentry->next;
-            entry = entry->next;
+    unsigned int hash = get_array_index(key);
+    int slot = array->entries ? array_find_slot(array, key, hash) : -1;
+    if (slot >= 0) {
+        ApexArrayEntry *entry = &array->entries[index_get(array, slot)];
+        apexVal_retain(value);
+        apexVal_release(entry->value);
+        entry->value = value;
+        return;
+    }
+
+    apexVal_setassigned(value, true);
+    apexVal_retain(value);
+    array_insert_hash(array, key, value, hash);
+}
+
+/**
+ * Sets a key-value pair in the object.
+ *
+ * This function inserts or updates a key-value pair in the given object. If
+ * the object's shape already has the key, the value in its slot is updated.
+ * Otherwise the object transitions to the shape with the key added, and the
+ * value is stored in the new last slot, growing the slots as needed. The
+ * instance template of a type is dropped, since it may no longer match.
+ *
+ * @param object A pointer to the object where the key-value pair will be set.
+ * @param key The key to identify the value.
+ * @param value The value to be associated with the key.
+ */
+void apexVal_objectset(ApexObject *object, const char *key, ApexValue value) {
+    object_unshare(object);
+    object_drop_template(object);
+    int slot = shape_lookup(object->shape, key);
+    if (slot >= 0) {
+        apexVal_retain(value);
+        apexVal_release(object->slots[slot]);
+        object->slots[slot] = value;
+        return;
+    }
+
+    object->shape = shape_transition(object->shape, key);
+    slot = object->shape->count - 1;
+    if (slot == object->slot_size) {
+        object->slot_size = object->slot_size ? object->slot_size * 2 : OBJ_INIT_SIZE;
+        object->slots = apexMem_realloc(object->slots, sizeof(ApexValue) * object->slot_size);
+    }
+    apexVal_retain(value);
+    apexVal_setassigned(value, true);
+    object->slots[slot] = value;
+}
+
+/**
+ * Builds the instance template of a type.
+ *
+ * The template keeps the data fields of the type in slot order. Functions
+ * are methods and stay in the type only.
+ *
+ * @param type A pointer to the type whose template is built.
+ */
+static void object_build_template(ApexObject *type) {
+    ApexTemplate *tmpl = apexMem_alloc(sizeof(ApexTemplate));
+    ApexShape *shape = shape_root();
+    int count = 0;
+
+    tmpl->slots = type->shape->count ? apexMem_alloc(sizeof(ApexValue) * type->shape->count) : NULL;
+    for (int i = 0; i < type->shape->count; i++) {
+        ApexValue value = type->slots[i];
+        if (value.type == APEX_VAL_FN || value.type == APEX_VAL_CFN) {
+            continue;
         }
-        *newentry_ptr = NULL;
+        shape = shape_transition(shape, type->shape->keys[i]);
+        tmpl->slots[count++] = value;
     }
-    return newobj;
+    tmpl->shape = shape;
+    type->tmpl = tmpl;
+}
+
+/**
+ * Creates a new instance of a type.
+ *
+ * The instance gets the data fields of the type, initialized from the
+ * type's template with a single copy; arrays, objects and typed arrays are
+ * then copied so that the instance does not share them with the type, and
+ * every other value is retained on behalf of the instance. Methods are not
+ * copied: the instance keeps a reference to its type and finds them there.
+ *
+ * @param type A pointer to the type to instantiate.
+ * @return A pointer to the newly allocated instance.
+ */
+ApexObject *apexVal_newinstance(ApexObject *type) {
+    if (!type->tmpl) {
+        object_build_template(type);
+    }
+    ApexTemplate *tmpl = type->tmpl;
+    int count = tmpl->shape->count;
+
+    ApexObject *object = apexVal_newobject(type->name);
+    object->shape = tmpl->shape;
+    object->type = type;
+    apexVal_retain(apexVal_maketype(type));
+    if (!count) {
+        return object;
+    }
+
+    object->slots = apexMem_alloc(sizeof(ApexValue) * count);
+    object->slot_size = count;
+    memcpy(object->slots, tmpl->slots, sizeof(ApexValue) * count);
+    for (int i = 0; i < count; i++) {
+        object->slots[i] = array_copy_value(object->slots[i]);
+    }
+    return object;
 }
 
 /**
@@ -930,7 +1621,8 @@ ApexObject *apexVal_objectcpy(ApexObject *object) {
  *
  * This function searches for the specified key in the array and, if found,
  * assigns the corresponding value to the output parameter. If the key is
- * not present in the array, the function returns false.
+ * not present in the array, the function returns false. A shared array is
+ * unshared before an array or object is handed out from it.
  *
  * @param value A pointer to an ApexValue where the result will be stored if
  *              the key is found.
@@ -939,26 +1631,35 @@ ApexObject *apexVal_objectcpy(ApexObject *object) {
  * @return true if the key is found and the value is retrieved, otherwise false.
  */
 bool apexVal_arrayget(ApexValue *value, ApexArray *array, const ApexValue key) {
-    unsigned int index = get_array_index(key) % array->entry_size;
-    ApexArrayEntry *entry = array->entries[index];
-
-    while (entry) {
-        if (value_equals(entry->key, key)) {
-            *value = entry->value;
-            return true;
+    if (key.type == APEX_VAL_INT && (unsigned int)key.intval < (unsigned int)array->vec_count) {
+        *value = array->vec[key.intval];
+    } else {
+        if (!array->entries) {
+            return false;
+        }
+        int slot = array_find_slot(array, key, get_array_index(key));
+        if (slot < 0) {
+            return false;
         }
-        entry = entry->next;
+        *value = array->entries[index_get(array, slot)].value;
     }
 
-    return false;
+    if (array->shared && is_container(*value)) {
+        array_unshare(array);
+        return apexVal_arrayget(value, array, key);
+    }
+    return true;
 }
 
 /**
  * Retrieves the value associated with a given key from the object.
  *
  * This function searches for the specified key in the object and, if found,
- * assigns the corresponding value to the output parameter. If the key is
- * not present in the object, the function returns false.
+ * assigns the corresponding value to the output parameter. Keys that an
+ * instance does not have itself, such as methods, are searched in its type.
+ * If the key is not present, the function returns false. Like
+ * apexVal_arrayget, shared slots are unshared before an array or object is
+ * handed out from them.
  *
  * @param value A pointer to an ApexValue where the result will be stored if
  *              the key is found.
@@ -967,56 +1668,317 @@ bool apexVal_arrayget(ApexValue *value, ApexArray *array, const ApexValue key) {
  * @return true if the key is found and the value is retrieved, otherwise false.
  */
 bool apexVal_objectget(ApexValue *value, ApexObject *object, const char *key) {
-    unsigned int index = apexUtil_hash(key) % object->size;
-    ApexObjectEntry *entry = object->entries[index];
-    
-    while (entry) {
-        if (entry->key == key) {
-            *value = entry->value;
-            return true;
-        }
-        entry = entry->next;
+    int slot = shape_lookup(object->shape, key);
+    if (slot < 0) {
+        return object->type && apexVal_objectget(value, object->type, key);
     }
+    if (object->shared && is_container(object->slots[slot])) {
+        object_unshare(object);
+    }
+    *value = object->slots[slot];
+    return true;
+}
 
-    return false;
+/**
+ * Removes the entry in a slot of an array's hash part.
+ *
+ * Deletion does not leave a tombstone. Instead, the entries that follow in
+ * the same run of occupied slots are shifted back into the hole whenever
+ * their home slot allows it, so lookups can keep stopping at the first
+ * empty slot.
+ *
+ * @param array A pointer to the array to delete from.
+ * @param slot The slot of the entry to remove.
+ */
+static void array_erase_slot(ApexArray *array, int slot) {
+    int mask = array->index_size - 1;
+    int hole = slot;
+    int next = slot;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (array->ctrl[next] == CTRL_EMPTY) {
+            break;
+        }
+        int pos = index_get(array, next);
+        int home = HASH_H1(array->entries[pos].hash) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index_set(array, hole, pos);
+            ctrl_set(array->ctrl, array->index_size, hole, array->ctrl[next]);
+            hole = next;
+        }
+    }
+    ctrl_set(array->ctrl, array->index_size, hole, CTRL_EMPTY);
 }
 
 /**
  * Deletes a key-value pair from the array.
  *
  * This function searches for the specified key in the array and removes
- * the corresponding key-value pair if it exists. The function releases
- * the memory associated with the key and value, and adjusts the linked
- * list to maintain the array's structure. If the key is not found, the
- * array remains unchanged.
+ * the corresponding key-value pair if it exists. Removing the last key of
+ * the dense part shrinks it; removing any other dense key first moves the
+ * dense part into the hash part. A hash entry is erased from the index table
+ * and marked as deleted, so the remaining entries keep their positions and
+ * insertion order; the hash part is compacted and shrinks once it is mostly
+ * empty. If the key is not found, the array remains unchanged.
  *
  * @param array A pointer to the array from which the key-value pair
  *              will be deleted.
  * @param key The key identifying the key-value pair to remove.
  */
 void apexVal_arraydel(ApexArray *array, const ApexValue key) {
-    unsigned int index = get_array_index(key) % array->entry_size;
-    ApexArrayEntry *prev = NULL;
-    ApexArrayEntry *entry = array->entries[index];
-
-    while (entry) {
-        if (value_equals(entry->key, key)) {
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                array->entries[index] = entry->next;
-            }
-            apexVal_release(entry->key);
-            apexVal_release(entry->value);
-            free(entry);
-            array->entry_count--;
+    array_unshare(array);
+    if (key.type == APEX_VAL_INT && key.intval >= 0 && key.intval < array->vec_count) {
+        if (key.intval == array->vec_count - 1) {
+            apexVal_release(array->vec[--array->vec_count]);
             return;
         }
-        prev = entry;
-        entry = entry->next;
+        array_spill_vec(array);
+    }
+    if (!array->entries) {
+        return;
+    }
+
+    int slot = array_find_slot(array, key, get_array_index(key));
+    if (slot < 0) {
+        return;
+    }
+    ApexArrayEntry *entry = &array->entries[index_get(array, slot)];
+    array_erase_slot(array, slot);
+    apexVal_release(entry->key);
+    apexVal_release(entry->value);
+    entry->deleted = true;
+    array->entry_count--;
+    while (array->entry_used > 0 && array->entries[array->entry_used - 1].deleted) {
+        array->entry_used--;
+    }
+
+    if (array->index_size > ARR_INIT_SIZE && array->entry_count < array->index_size / 4) {
+        int size = array->index_size / 2;
+        int capacity = array->entry_size;
+        if (capacity > ARR_USABLE(size)) {
+            capacity = ARR_USABLE(size);
+        }
+        array_compact(array, capacity);
+        array_build_index(array, size);
     }
 }
 
+/**
+ * Fetches the next key-value pair of an array iteration.
+ *
+ * Iteration visits the dense part in index order followed by the hash part
+ * in insertion order, which is a linear scan over the entries that skips
+ * deleted ones. The iterator is an opaque position that starts at 0 and is
+ * advanced by each successful call. Like apexVal_arrayget, a shared array
+ * is unshared before an array or object is handed out from it.
+ *
+ * @param array A pointer to the array being iterated.
+ * @param iter A pointer to the iteration position.
+ * @param key A pointer to an ApexValue that receives the key.
+ * @param value A pointer to an ApexValue that receives the value.
+ * @return true if a pair was fetched, or false if the iteration is done.
+ */
+bool apexVal_arraynext(ApexArray *array, int *iter, ApexValue *key, ApexValue *value) {
+    int pos = *iter;
+    if (pos < array->vec_count) {
+        *key = apexVal_makeint(pos);
+        *value = array->vec[pos];
+        *iter = pos + 1;
+    } else {
+        int i = pos - array->vec_count;
+        while (i < array->entry_used && array->entries[i].deleted) {
+            i++;
+        }
+        if (i >= array->entry_used) {
+            return false;
+        }
+        *key = array->entries[i].key;
+        *value = array->entries[i].value;
+        *iter = array->vec_count + i + 1;
+    }
+
+    if (array->shared && is_container(*value)) {
+        array_unshare(array);
+        *iter = pos;
+        return apexVal_arraynext(array, iter, key, value);
+    }
+    return true;
+}
+
+/**
+ * Returns the size in bytes of an element of a typed array.
+ *
+ * @param kind The element type.
+ * @return The size of an element.
+ */
+size_t apexVal_typedsize(ApexTypedKind kind) {
+    switch (kind) {
+    case APEX_TYPED_I32:
+        return sizeof(int32_t);
+    case APEX_TYPED_I64:
+        return sizeof(int64_t);
+    case APEX_TYPED_F64:
+        return sizeof(double);
+    case APEX_TYPED_U8:
+        return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+/**
+ * Returns the name of the element type of a typed array.
+ *
+ * @param kind The element type.
+ * @return The name of the element type: i32, i64, f64 or u8.
+ */
+const char *apexVal_typedkindstr(ApexTypedKind kind) {
+    switch (kind) {
+    case APEX_TYPED_I32:
+        return "i32";
+    case APEX_TYPED_I64:
+        return "i64";
+    case APEX_TYPED_F64:
+        return "f64";
+    case APEX_TYPED_U8:
+        return "u8";
+    }
+    return "";
+}
+
+/**
+ * Creates a new typed array.
+ *
+ * All elements of the new typed array are zero, and its reference count is
+ * set to zero.
+ *
+ * @param kind The element type.
+ * @param length The number of elements.
+ * @return A pointer to the newly created typed array.
+ */
+ApexTypedArray *apexVal_newtyped(ApexTypedKind kind, int length) {
+    ApexTypedArray *typed = apexMem_poolalloc(APEX_POOL_TYPED, sizeof(ApexTypedArray));
+    typed->kind = kind;
+    typed->length = length;
+    typed->data = apexMem_calloc(length ? length : 1, apexVal_typedsize(kind));
+    typed->refcount = 0;
+    return typed;
+}
+
+/**
+ * Creates a copy of a typed array.
+ *
+ * @param typed A pointer to the typed array to copy.
+ * @return A pointer to the newly allocated copy.
+ */
+ApexTypedArray *apexVal_typedcpy(ApexTypedArray *typed) {
+    ApexTypedArray *newtyped = apexVal_newtyped(typed->kind, typed->length);
+    memcpy(newtyped->data, typed->data, apexVal_typedsize(typed->kind) * typed->length);
+    return newtyped;
+}
+
+/**
+ * Frees all memory allocated for the given typed array.
+ *
+ * @param typed The typed array to free.
+ */
+void apexVal_freetyped(ApexTypedArray *typed) {
+    free(typed->data);
+    apexMem_poolfree(APEX_POOL_TYPED, typed, sizeof(ApexTypedArray));
+}
+
+/**
+ * Retrieves an element of a typed array.
+ *
+ * Elements of i32 and u8 arrays are returned as integers and elements of
+ * f64 arrays as doubles. Elements of i64 arrays are returned as integers
+ * when they fit, and as doubles otherwise.
+ *
+ * @param value A pointer to an ApexValue that receives the element.
+ * @param typed A pointer to the typed array.
+ * @param index The index of the element.
+ * @return true if the index is in range, otherwise false.
+ */
+bool apexVal_typedget(ApexValue *value, ApexTypedArray *typed, int index) {
+    if ((unsigned int)index >= (unsigned int)typed->length) {
+        return false;
+    }
+    switch (typed->kind) {
+    case APEX_TYPED_I32:
+        *value = apexVal_makeint(((int32_t *)typed->data)[index]);
+        break;
+    case APEX_TYPED_I64: {
+        int64_t n = ((int64_t *)typed->data)[index];
+        if (n >= INT_MIN && n <= INT_MAX) {
+            *value = apexVal_makeint((int)n);
+        } else {
+            *value = apexVal_makedbl((double)n);
+        }
+        break;
+    }
+    case APEX_TYPED_F64:
+        *value = apexVal_makedbl(((double *)typed->data)[index]);
+        break;
+    case APEX_TYPED_U8:
+        *value = apexVal_makeint(((uint8_t *)typed->data)[index]);
+        break;
+    }
+    return true;
+}
+
+/**
+ * Stores a number in an element of a typed array.
+ *
+ * The number is converted to the element type: floating-point numbers
+ * stored in an integer array are truncated, and integers stored in a u8
+ * array wrap around.
+ *
+ * @param typed A pointer to the typed array.
+ * @param index The index of the element.
+ * @param value The number to store.
+ * @return true if the number was stored, or false if the index is out of
+ *         range or the value is not a number.
+ */
+bool apexVal_typedset(ApexTypedArray *typed, int index, ApexValue value) {
+    int64_t num;
+    double dbl;
+
+    if ((unsigned int)index >= (unsigned int)typed->length) {
+        return false;
+    }
+    switch (value.type) {
+    case APEX_VAL_INT:
+        num = value.intval;
+        dbl = value.intval;
+        break;
+    case APEX_VAL_FLT:
+        dbl = value.fltval;
+        num = (int64_t)dbl;
+        break;
+    case APEX_VAL_DBL:
+        dbl = value.dblval;
+        num = (int64_t)dbl;
+        break;
+    default:
+        return false;
+    }
+
+    switch (typed->kind) {
+    case APEX_TYPED_I32:
+        ((int32_t *)typed->data)[index] = (int32_t)num;
+        break;
+    case APEX_TYPED_I64:
+        ((int64_t *)typed->data)[index] = num;
+        break;
+    case APEX_TYPED_F64:
+        ((double *)typed->data)[index] = dbl;
+        break;
+    case APEX_TYPED_U8:
+        ((uint8_t *)typed->data)[index] = (uint8_t)num;
+        break;
+    }
+    return true;
+}
+
 /**
  * Creates an ApexValue representing an integer.
  *
@@ -1188,6 +2150,19 @@ ApexValue apexVal_makeptr(void *ptr) {
     return v;
 }
 
+/**
+ * Creates an ApexValue representing a typed array.
+ *
+ * @param typed A pointer to the ApexTypedArray to represent in an ApexValue.
+ * @return An ApexValue of type APEX_VAL_TYPED with the specified typed array.
+ */
+ApexValue apexVal_maketyped(ApexTypedArray *typed) {
+    ApexValue v;
+    v.type = APEX_VAL_TYPED;
+    v.typedval = typed;
+    return v;
+}
+
 /**
  * Creates an ApexValue with the given null value.
  *
@@ -1213,8 +2188,11 @@ ApexValue apexVal_makenull(void) {
  * @return The length of the array.
  */
 int apexVal_arrlen(ApexValue value) {
+    if (value.type == APEX_VAL_TYPED) {
+        return value.typedval->length;
+    }
     ApexArray *arr = value.arrval;
-    return arr->entry_count;
+    return arr->vec_count + arr->entry_count;
 }
 
 /**
@@ -1258,6 +2236,7 @@ bool apexVal_tobool(ApexValue value) {
     case APEX_VAL_OBJ:
     case APEX_VAL_CFN:
     case APEX_VAL_PTR:
+    case APEX_VAL_TYPED:
         value = apexVal_makebool(true);
         break;
 
@@ -1266,4 +2245,4 @@ bool apexVal_tobool(ApexValue value) {
         break;
     }
     return value.boolval;
-}
\ No newline at end of file
+}
\ No newline at end of file
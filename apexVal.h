@@ -2,6 +2,7 @@
 #define VALUE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "apexStr.h"
 
 struct ApexVM; 
@@ -22,6 +23,7 @@ typedef enum {
     APEX_VAL_ARR, /** Array value */
     APEX_VAL_TYPE, /** Type value */
     APEX_VAL_OBJ, /** Object value */
+    APEX_VAL_TYPED, /** Typed array value */
     APEX_VAL_NULL /** Null value */
 } ApexValueType;
 
@@ -53,6 +55,10 @@ typedef struct ApexArray ApexArray;
  * Object struct to represent an object value
  */
 typedef struct ApexObject ApexObject;
+/**
+ * TypedArray struct to represent a packed array of numbers
+ */
+typedef struct ApexTypedArray ApexTypedArray;
 
 /**
  * Union to represent a value of any type
@@ -70,6 +76,7 @@ typedef struct {
         void *ptrval; /** Pointer value */
         ApexArray *arrval; /** Array value */
         ApexObject *objval; /** Object value */
+        ApexTypedArray *typedval; /** Typed array value */
     };
 } ApexValue;
 
@@ -79,46 +86,133 @@ typedef struct {
 typedef struct ApexArrayEntry {
     ApexValue key; /** The key of the entry */
     ApexValue value; /** The value of the entry */
-    struct ApexArrayEntry *next; /** The next entry */
-    int index; /** The index of the entry */
+    unsigned int hash; /** The hash of the key */
+    bool deleted; /** Whether the entry has been deleted */
 } ApexArrayEntry;
 
 /**
  * ApexArray struct to represent an array
+ *
+ * An array has two parts. Integer keys 0..vec_count-1 are stored in a dense
+ * vector of values; every other key lives in the hash part. The vector only
+ * grows while the hash part is empty, so iterating the vector and then the
+ * hash part in insertion order preserves the overall insertion order.
+ *
+ * The hash part is a compact ordered dictionary. The entries are stored in
+ * a dense array in insertion order, and deleted entries are only marked
+ * until the array is compacted. Lookups go through an open-addressing index
+ * table: ctrl holds one control byte per slot (7 bits of the key's hash, or
+ * empty), followed by a copy of the first group of control bytes so that a
+ * group can be probed past the end of the table without wrapping, and index
+ * holds the position of each slot's entry, using 1, 2 or 4 bytes per slot
+ * depending on the size of the table.
+ *
+ * Copies of an array share its storage until one of them is modified, at
+ * which point that array gets a private copy (copy-on-write).
  */
 struct ApexArray {
-    ApexArrayEntry **entries; /** The entries of the array */
-    ApexArrayEntry **iter; /** The iterator of the array */
-    int entry_size; /** The number of entries */
-    int entry_count; /** The number of entries */
-    int iter_size; /** The number of entries in the iterator */
-    int iter_count; /** The number of entries in the iterator */
+    ApexValue *vec; /** The values of the dense part, indexed by key */
+    int vec_size; /** The capacity of the dense part */
+    int vec_count; /** The number of values in the dense part */
+    uint8_t *ctrl; /** The control bytes of the index table */
+    void *index; /** The entry positions of the index table */
+    ApexArrayEntry *entries; /** The entries of the hash part */
+    int index_size; /** The number of slots in the index table */
+    int entry_size; /** The capacity of the entries */
+    int entry_used; /** The number of used entries, including deleted ones */
+    int entry_count; /** The number of live entries */
+    int *shared; /** The number of arrays sharing the storage, or NULL */
     int refcount; /** The number of references to the array */
     bool is_assigned; /** Whether the array has been assigned */
 };
 
 /**
- * ObjectEntry struct to represent an entry in an object
+ * Shape struct to describe the layout of an object
+ *
+ * A shape maps the field names of an object to slot indices. Shapes are
+ * shared by all objects whose fields were added in the same order, and form
+ * a transition tree rooted at the empty shape: adding a field moves an
+ * object to the child shape for that field, which is created on first use.
+ * Shapes with many fields also have an open-addressing lookup table laid out
+ * like the hash part of an ApexArray.
  */
-typedef struct ApexObjectEntry {
-    const char *key; /** The key of the entry */
-    ApexValue value; /** The value of the entry */
-    struct ApexObjectEntry *next; /** The next entry */
-} ApexObjectEntry;
+typedef struct ApexShape ApexShape;
+struct ApexShape {
+    const char **keys; /** The field names, indexed by slot */
+    int count; /** The number of fields */
+    uint8_t *ctrl; /** The control bytes of the lookup table, or NULL */
+    int *table; /** The slot of each entry of the lookup table */
+    int table_size; /** The number of entries in the lookup table */
+    ApexShape **children; /** The shapes with one more field */
+    int child_count; /** The number of child shapes */
+    int child_size; /** The capacity of the child shapes */
+};
+
+/**
+ * Template struct to describe the instances of a type
+ *
+ * A template holds the shape and the initial values of the data fields of
+ * a type. Methods are left out, since instances find them through their
+ * type. The values are borrowed from the type, and the template is dropped
+ * whenever the type is modified.
+ */
+typedef struct {
+    ApexShape *shape; /** The shape of new instances */
+    ApexValue *slots; /** The initial field values of new instances */
+} ApexTemplate;
 
 /**
  * ApexObject struct to represent an object
+ *
+ * An object stores its field values in a dense slot vector, laid out as
+ * described by its shape. Fields that an instance does not have itself are
+ * looked up in its type. Like arrays, copies of an object share its slots
+ * until one of them is modified.
  */
 struct ApexObject {
-    ApexObjectEntry **entries; /** The entries of the object */
-    int size; /** The size of the object */
-    int count; /** The number of entries */
+    ApexShape *shape; /** The shape of the object */
+    ApexValue *slots; /** The field values, indexed by slot */
+    int slot_size; /** The capacity of the slots */
+    int *shared; /** The number of objects sharing the slots, or NULL */
     int refcount; /** The number of references to the object */
     const char *name; /** The name of the object */
+    ApexObject *type; /** The type of an instance, or NULL */
+    ApexTemplate *tmpl; /** The instance template of a type, or NULL */
+};
+
+/**
+ * Enum type to represent the element type of a typed array.
+ */
+typedef enum {
+    APEX_TYPED_I32, /** 32-bit signed integers */
+    APEX_TYPED_I64, /** 64-bit signed integers */
+    APEX_TYPED_F64, /** 64-bit floating-point numbers */
+    APEX_TYPED_U8 /** 8-bit unsigned integers */
+} ApexTypedKind;
+
+/**
+ * ApexTypedArray struct to represent a typed array
+ *
+ * A typed array holds a fixed number of elements of a single numeric type,
+ * stored untagged in a contiguous buffer and indexed from 0 to length-1, so
+ * that native kernels can process them with vector instructions.
+ */
+struct ApexTypedArray {
+    ApexTypedKind kind; /** The element type */
+    int length; /** The number of elements */
+    void *data; /** The elements */
+    int refcount; /** The number of references to the typed array */
 };
 
-#define apexArray_each(arr) for (int _iter = 0; _iter < arr->iter_count;)
-#define apexArray_next(arr) (arr->iter[_iter++])
+/**
+ * Iterates over the key-value pairs of an array in insertion order.
+ *
+ * @param arr The array to iterate over.
+ * @param key An ApexValue lvalue that receives each key.
+ * @param value An ApexValue lvalue that receives each value.
+ */
+#define apexArray_each(arr, key, value) \
+    for (int _iter = 0; apexVal_arraynext(arr, &_iter, &key, &value);)
 
 /**
  * Get the integer value from an ApexValue.
@@ -176,6 +270,14 @@ struct ApexObject {
  */
 #define apexVal_fn(v) (v.fnval)
 
+/**
+ * Get the ApexTypedArray from an ApexValue.
+ *
+ * @param v ApexValue containing an ApexTypedArray.
+ * @return The ApexTypedArray contained in the ApexValue.
+ */
+#define apexVal_typed(v) (v.typedval)
+
 /**
  * Get the ApexValueType from an ApexValue.
  *
@@ -187,6 +289,7 @@ struct ApexObject {
 extern ApexFn *apexVal_newfn(const char *name, char **params, int argc, bool have_variadic, int addr);
 extern ApexCfn apexVal_newcfn(char *name, int (*fn)(ApexVM *, int));
 extern const char *apexVal_typestr(ApexValue value);
+extern const char *apexVal_typename(ApexValueType type);
 extern ApexString *apexVal_tostr(ApexValue value);
 extern void apexVal_setassigned(ApexValue value, bool is_assigned);
 extern bool apexVal_isassigned(ApexValue value);
@@ -201,6 +304,7 @@ extern ApexValue apexVal_makearr(ApexArray *arr);
 extern ApexValue apexVal_maketype(ApexObject *obj);
 extern ApexValue apexVal_makeobj(ApexObject *obj);
 extern ApexValue apexVal_makeptr(void *ptr);
+extern ApexValue apexVal_maketyped(ApexTypedArray *typed);
 extern ApexValue apexVal_makenull(void);
 extern bool apexVal_tobool(ApexValue value);
 extern int apexVal_arrlen(ApexValue value);
@@ -208,13 +312,25 @@ extern void apexVal_retain(ApexValue value);
 extern void apexVal_release(ApexValue value);
 extern ApexArray *apexVal_newarray(void);
 extern ApexObject *apexVal_newobject(const char *name);
+extern ApexFn *apexVal_fncpy(ApexFn *fn);
+extern ApexArray *apexVal_arrcpy(ApexArray *array);
 extern ApexObject *apexVal_objectcpy(ApexObject *object);
+extern ApexObject *apexVal_newinstance(ApexObject *type);
 extern void apexVal_freearray(ApexArray *array);
 extern void apexVal_freeobject(ApexObject *object);
+extern void apexVal_freeshapes(void);
 extern void apexVal_arrayset(ApexArray *array, ApexValue key, ApexValue value);
 extern void apexVal_objectset(ApexObject *object, const char *key, ApexValue value);
 extern bool apexVal_arrayget(ApexValue *value, ApexArray *array, const ApexValue key);
 extern bool apexVal_objectget(ApexValue *value, ApexObject *object, const char *key);
 extern void apexVal_arraydel(ApexArray *array, const ApexValue key);
+extern bool apexVal_arraynext(ApexArray *array, int *iter, ApexValue *key, ApexValue *value);
+extern ApexTypedArray *apexVal_newtyped(ApexTypedKind kind, int length);
+extern ApexTypedArray *apexVal_typedcpy(ApexTypedArray *typed);
+extern void apexVal_freetyped(ApexTypedArray *typed);
+extern size_t apexVal_typedsize(ApexTypedKind kind);
+extern const char *apexVal_typedkindstr(ApexTypedKind kind);
+extern bool apexVal_typedget(ApexValue *value, ApexTypedArray *typed, int index);
+extern bool apexVal_typedset(ApexTypedArray *typed, int index, ApexValue value);
 
 #endif
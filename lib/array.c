@@ -9,37 +9,21 @@
  * Checks if a given key exists in an array.
  *
  * This function expects two arguments: an array and a key. It checks whether
- * the specified key is present in the provided array and pushes a boolean
- * result onto the virtual machine's stack indicating the presence of the key.
+ * the specified key is present in the provided array and returns a boolean
+ * indicating the presence of the key.
  *
  * If the number of arguments is not exactly two, or if the key is not a string,
- * or if the first argument is not an array, a runtime error is raised.
+ * or if the first argument is not an array, the VM raises a runtime error.
  *
  * @param vm A pointer to the virtual machine.
- * @param argc The number of arguments passed to the function.
- * @return Returns 0 on success, or 1 if an error occurs.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
+ * @return Always returns 0.
  */
-int array_key_exists(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "array:key_exists expects exactly 2 arguments");
-        return 1;
-    }
-    ApexValue key_val = apexVM_pop(vm);
-
-    if (apexVal_type(key_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s must be a string", apexVal_typestr(key_val));
-        return 1;
-    }
-
-    ApexValue array_val = apexVM_pop(vm);
-    if (apexVal_type(array_val) != APEX_VAL_ARR) {
-        apexErr_runtime(vm, "argument %s must be an array", apexVal_typestr(array_val));
-        return 1;
-    }
-
+int array_key_exists(ApexVM *vm, ApexValue *args, ApexValue *result) {
     ApexValue value;
-    bool key_exists = apexVal_arrayget(&value, array_val.arrval, key_val);
-    apexVM_pushbool(vm, key_exists);
+    bool key_exists = apexVal_arrayget(&value, args[0].arrval, args[1]);
+    *result = apexVal_makebool(key_exists);
     return 0;
 }
 
@@ -82,10 +66,10 @@ int array_join(ApexVM *vm, int argc) {
     char *joined = apexMem_alloc(joined_size);
     *joined = '\0';
     bool first = true;    
+    ApexValue key, elem;
 
-    apexArray_each(array) {
-        ApexArrayEntry *entry = apexArray_next(array);
-        char *value = apexVal_tostr(entry->value)->value;
+    apexArray_each(array, key, elem) {
+        char *value = apexVal_tostr(elem)->value;
         size_t len = strlen(value);
         
         joined_len += len + (first ? 0 : delim_len);
@@ -115,8 +99,8 @@ int array_join(ApexVM *vm, int argc) {
  * collects the results in a new array. The function must accept a single argument
  * and return a value that will be included in the resulting array.
  *
- * If the number of arguments is not exactly two, or if the provided function is not
- * of type APEX_VAL_FN, or if the first argument is not an array, a runtime error
+ * If the number of arguments is not exactly two, or if the second argument is not
+ * a function, or if the first argument is not an array, a runtime error
  * is raised.
  *
  * @param vm A pointer to the virtual machine.
@@ -130,7 +114,7 @@ int array_map(ApexVM *vm, int argc) {
     }
 
     ApexValue fn_val = apexVM_pop(vm);
-    if (apexVal_type(fn_val) != APEX_VAL_FN) {
+    if (apexVal_type(fn_val) != APEX_VAL_FN && apexVal_type(fn_val) != APEX_VAL_CFN) {
         apexErr_runtime(vm, "second argument to array:map must be a function");
         return 1;
     }
@@ -141,26 +125,32 @@ int array_map(ApexVM *vm, int argc) {
         return 1;
     }
 
+    ApexCallSite site;
+    if (!apexVM_prepare(vm, &site, fn_val, 1)) {
+        return 1;
+    }
     ApexArray *array = apexVal_array(array_val);
     ApexArray *new_array = apexVal_newarray();
     int array_index = 0;
-    apexArray_each(array) {
-        ApexArrayEntry *entry = apexArray_next(array);
-        apexVM_pushval(vm, entry->value);
-        if (!apexVM_call(vm, apexVal_fn(fn_val), 1)) {
+    ApexValue key, value, result;
+    apexArray_each(array, key, value) {
+        if (!apexVM_invokesite(vm, &site, &value, &result)) {
+            apexVM_freesite(&site);
             return 1;
         }
-        if (vm->stack_top > 0) {
-            apexVal_arrayset(new_array, apexVal_makeint(array_index++), apexVM_pop(vm));
+        // Functions that return nothing add nothing to the new array.
+        if (apexVal_type(result) != APEX_VAL_NULL) {
+            apexVal_arrayset(new_array, apexVal_makeint(array_index++), result);
         }
     }
+    apexVM_freesite(&site);
     apexVM_pusharr(vm, new_array);
-    apexVal_release(fn_val);
     return 0;
 }
 
 apex_reglib(array,
-    apex_regfn("key_exists", array_key_exists),
-    apex_regfn("join", array_join),
+    apex_regfast("key_exists", array_key_exists, APEX_LIB_PURE,
+                 APEX_ARG(APEX_VAL_ARR), APEX_ARG(APEX_VAL_STR)),
+    apex_regfnx("join", array_join, APEX_LIB_PURE),
     apex_regfn("map", array_map)
 );
\ No newline at end of file
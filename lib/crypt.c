@@ -384,23 +384,9 @@ void aes_inv_block(const uint8_t *input, uint8_t *output, const uint8_t *key) {
  *
  * The function returns the encrypted string in hexadecimal format.
  */
-int crypt_aes(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "crypt:aes expects exactly 2 arguments");
-        return 1;
-    }
-    ApexValue key_val = apexVM_pop(vm);
-    if (apexVal_type(key_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "second argument to crypt:aes must be a string");
-        return 1;
-    }
-    ApexValue str_val = apexVM_pop(vm);
-    if (apexVal_type(str_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "first argument to crypt:aes must be a string");
-        return 1;
-    }
-    char *key = apexVal_str(key_val)->value;
-    char *str = apexVal_str(str_val)->value;
+int crypt_aes(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    char *key = apexVal_str(args[1])->value;
+    char *str = apexVal_str(args[0])->value;
     size_t len = strlen(str);
     size_t padded_len = ((len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
     uint8_t *input = calloc(padded_len, sizeof(uint8_t));
@@ -422,8 +408,7 @@ int crypt_aes(ApexVM *vm, int argc) {
     }
     free(input);
     free(output);
-    ApexString *enc_str = apexStr_save(enc, strlen(enc));
-    apexVM_pushstr(vm, enc_str);
+    *result = apexVal_makestr(apexStr_save(enc, strlen(enc)));
     return 0;
 }
 
@@ -436,23 +421,9 @@ int crypt_aes(ApexVM *vm, int argc) {
  *
  * The function returns the decrypted string.
  */
-int crypt_aes_inv(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "crypt:aes_inv expects exactly 2 arguments");
-        return 1;
-    }
-    ApexValue key_val = apexVM_pop(vm);
-    if (apexVal_type(key_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "second argument to crypt:aes_inv must be a string");
-        return 1;
-    }
-    ApexValue enc_val = apexVM_pop(vm);
-    if (apexVal_type(enc_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "first argument to crypt:aes_inv must be a string");
-        return 1;
-    }
-    char *key = apexVal_str(key_val)->value;
-    char *enc = apexVal_str(enc_val)->value;
+int crypt_aes_inv(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    char *key = apexVal_str(args[1])->value;
+    char *enc = apexVal_str(args[0])->value;
 
     size_t len = strlen(enc) / 2;
 
@@ -473,8 +444,7 @@ int crypt_aes_inv(ApexVM *vm, int argc) {
 
     free(input);
     free(output);
-    ApexString *dec_str = apexStr_save(dec, strlen(dec));
-    apexVM_pushstr(vm, dec_str);
+    *result = apexVal_makestr(apexStr_save(dec, strlen(dec)));
     return 0;
 }
 
@@ -522,7 +492,7 @@ int crypt_hash(ApexVM *vm, int argc) {
 }
 
 apex_reglib(crypt,
-    apex_regfn("hash", crypt_hash),
-    apex_regfn("aes", crypt_aes),
-    apex_regfn("aes_inv", crypt_aes_inv)
+    apex_regfnx("hash", crypt_hash, APEX_LIB_NOMUTATE),
+    apex_regfast("aes", crypt_aes, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR), APEX_ARG(APEX_VAL_STR)),
+    apex_regfast("aes_inv", crypt_aes_inv, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR), APEX_ARG(APEX_VAL_STR))
 );
\ No newline at end of file
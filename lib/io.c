@@ -205,8 +205,8 @@ int io_open(ApexVM *vm, int argc) {
 }
 
 apex_reglib(io,
-    apex_regfn("write", io_write),
-    apex_regfn("print", io_print),
-    apex_regfn("read", io_read),
-    apex_regfn("open", io_open)
+    apex_regfnx("write", io_write, APEX_LIB_NOMUTATE),
+    apex_regfnx("print", io_print, APEX_LIB_NOMUTATE),
+    apex_regfnx("read", io_read, APEX_LIB_NOMUTATE),
+    apex_regfnx("open", io_open, APEX_LIB_NOMUTATE)
 );
\ No newline at end of file
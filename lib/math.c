@@ -17,6 +17,24 @@ ApexValue math_huge = {
     .dblval = HUGE_VAL
 };
 
+/**
+ * Returns the value of a numeric argument as a double. The VM has already
+ * checked that the argument is an int, flt or dbl.
+ *
+ * @param value The argument.
+ * @return The value of the argument.
+ */
+static double number(ApexValue value) {
+    switch (apexVal_type(value)) {
+    case APEX_VAL_INT:
+        return (double)apexVal_int(value);
+    case APEX_VAL_FLT:
+        return (double)apexVal_flt(value);
+    default:
+        return apexVal_dbl(value);
+    }
+}
+
 /**
  * Returns a random integer or double value
  *
@@ -92,24 +110,12 @@ int math_random(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_abs(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:abs expects exactly 1 argument");
-        return 1;
-    }
-
-    ApexValue value = apexVM_pop(vm);
-    if (apexVal_type(value) != APEX_VAL_INT) {
-        apexErr_runtime(vm, "math:abs expects argument to be int");
-        return 1;
-    }
-
-    int x = apexVal_int(value);
-    int result = abs(x);
-    apexVM_pushint(vm, result);
+int math_abs(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makeint(abs(apexVal_int(args[0])));
     return 0;
 }
 
@@ -122,32 +128,12 @@ int math_abs(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_fabs(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:fabs expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:fabs expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = fabs(x);
-    apexVM_pushdbl(vm, result);
+int math_fabs(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(fabs(number(args[0])));
     return 0;
 }
 
@@ -160,32 +146,12 @@ int math_fabs(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_cos(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:cos expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:cos expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = cos(x);
-    apexVM_pushdbl(vm, result);
+int math_cos(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(cos(number(args[0])));
     return 0;
 }
 
@@ -198,32 +164,12 @@ int math_cos(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_cosh(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:cosh expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:cosh expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = cosh(x);
-    apexVM_pushdbl(vm, result);
+int math_cosh(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(cosh(number(args[0])));
     return 0;
 }
 
@@ -236,32 +182,12 @@ int math_cosh(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_acos(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:acos expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:acos expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = acos(x);
-    apexVM_pushdbl(vm, result);
+int math_acos(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(acos(number(args[0])));
     return 0;
 }
 
@@ -274,32 +200,12 @@ int math_acos(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_sin(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:sin, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:sin expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = sin(x);
-    apexVM_pushdbl(vm, result);
+int math_sin(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(sin(number(args[0])));
     return 0;
 }
 
@@ -312,32 +218,12 @@ int math_sin(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_asin(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:asin, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:asin expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = asin(x);
-    apexVM_pushdbl(vm, result);
+int math_asin(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(asin(number(args[0])));
     return 0;
 }
 
@@ -350,32 +236,12 @@ int math_asin(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_tan(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:tan, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:tan expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = tan(x);
-    apexVM_pushdbl(vm, result);
+int math_tan(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(tan(number(args[0])));
     return 0;
 }
 
@@ -388,32 +254,12 @@ int math_tan(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_atan(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:atan, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:atan expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = atan(x);
-    apexVM_pushdbl(vm, result);
+int math_atan(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(atan(number(args[0])));
     return 0;
 }
 
@@ -426,48 +272,12 @@ int math_atan(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 2.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_atan2(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "math:atan2, expects exactly 2 arguments");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:atan2 expects second argument to be int, flt or dbl");
-        return 1;
-    }
-    double y;
-    value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        y = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        y = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        y = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:atan2 expects first argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = atan2(x, y);
-    apexVM_pushdbl(vm, result);
+int math_atan2(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(atan2(number(args[1]), number(args[0])));
     return 0;
 }
 
@@ -480,32 +290,12 @@ int math_atan2(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_ceil(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:ceil, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:ceil expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = ceil(x);
-    apexVM_pushdbl(vm, result);
+int math_ceil(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(ceil(number(args[0])));
     return 0;
 }
 
@@ -518,32 +308,12 @@ int math_ceil(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_floor(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:floor, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:floor expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = floor(x);
-    apexVM_pushdbl(vm, result);
+int math_floor(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(floor(number(args[0])));
     return 0;
 }
 
@@ -556,32 +326,12 @@ int math_floor(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_exp(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:exp, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:exp expects argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = exp(x);
-    apexVM_pushdbl(vm, result);
+int math_exp(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(exp(number(args[0])));
     return 0;
 }
 
@@ -594,48 +344,12 @@ int math_exp(ApexVM *vm, int argc) {
  * is not exactly two, a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 2.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_fmod(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "math:fmod, expects exactly 2 arguments");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:fmod expects second argument to be int, flt or dbl");
-        return 1;
-    }
-    double y;
-    value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        y = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        y = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        y = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:fmod expects first argument to be int, flt or dbl");
-        return 1;
-    }
-    double result = fmod(x, y);
-    apexVM_pushdbl(vm, result);
+int math_fmod(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(fmod(number(args[1]), number(args[0])));
     return 0;
 }
 
@@ -649,36 +363,17 @@ int math_fmod(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_frexp(ApexVM *vm, int argc) {
-     if (argc != 1) {
-        apexErr_runtime(vm, "math:frexp, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:frexp expects argument to be int, flt or dbl");
-        return 1;
-    }
+int math_frexp(ApexVM *vm, ApexValue *args, ApexValue *result) {
     int intpart;
-    double fractpart = frexp(x, &intpart);
+    double fractpart = frexp(number(args[0]), &intpart);
     ApexArray *array = apexVal_newarray();
     apexVal_arrayset(array, apexVal_makeint(0), apexVal_makeint(intpart));
     apexVal_arrayset(array, apexVal_makeint(1), apexVal_makedbl(fractpart));
-    apexVM_pusharr(vm, array);
+    *result = apexVal_makearr(array);
     return 0;
 }
 
@@ -693,39 +388,12 @@ int math_frexp(ApexVM *vm, int argc) {
  * a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 2.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_ldexp(ApexVM *vm, int argc) {
-    if (argc != 2) {
-        apexErr_runtime(vm, "math:ldexp, expects exactly 2 arguments");
-        return 1;
-    }    
-    ApexValue value = apexVM_pop(vm);
-    if (apexVal_type(value) != APEX_VAL_INT) {   
-        apexErr_runtime(vm, "math:ldexp expects second argument to be int, flt or dbl");
-        return 1;
-    }
-    int exponent = apexVal_int(value);
-    double x;
-    value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:ldexp expects first argument to be int, flt or dbl");
-        return 1;
-    }
-
-    double result = ldexp(x, exponent);
-    apexVM_pushdbl(vm, result);
+int math_ldexp(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    *result = apexVal_makedbl(ldexp(number(args[0]), apexVal_int(args[1])));
     return 0;
 }
 
@@ -739,36 +407,17 @@ int math_ldexp(ApexVM *vm, int argc) {
  * is not exactly one, a runtime error is raised.
  *
  * @param vm The virtual machine to use.
- * @param argc The number of arguments to the function, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return 0 on success, 1 on error.
  */
-int math_modf(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "math:modf, expects exactly 1 argument");
-        return 1;
-    }
-    double x;
-    ApexValue value = apexVM_pop(vm);
-    switch (apexVal_type(value)) {
-    case APEX_VAL_INT:
-        x = (double)apexVal_int(value);
-        break;
-    case APEX_VAL_FLT:
-        x = (double)apexVal_flt(value);
-        break;
-    case APEX_VAL_DBL:
-        x = apexVal_dbl(value);
-        break;
-    default:
-        apexErr_runtime(vm, "math:modf expects argument to be int, flt or dbl");
-        return 1;
-    }
+int math_modf(ApexVM *vm, ApexValue *args, ApexValue *result) {
     double intpart;
-    double fractpart = modf(x, &intpart);
+    double fractpart = modf(number(args[0]), &intpart);
     ApexArray *array = apexVal_newarray();
     apexVal_arrayset(array, apexVal_makeint(0), apexVal_makeint((int)intpart));
     apexVal_arrayset(array, apexVal_makeint(1), apexVal_makedbl(fractpart));
-    apexVM_pusharr(vm, array);
+    *result = apexVal_makearr(array);
     return 0;
 }
 
@@ -834,9 +483,21 @@ int math_max(ApexVM *vm, int argc) {
     return 0;
 }
 
+/**
+ * Returns the minimum value from a list of numbers.
+ *
+ * This function takes one or more arguments and returns the minimum value among them.
+ * The arguments can be integers, floats, or doubles.
+ * If any argument is not of one of the above types, or if no arguments are provided,
+ * a runtime error is raised.
+ *
+ * @param vm The virtual machine to use.
+ * @param argc The number of arguments to the function, expected to be at least 1.
+ * @return 0 on success, 1 on error.
+ */
 int math_min(ApexVM *vm, int argc) {
     if (argc < 1) {
-        apexErr_runtime(vm, "math:max, expects at least 1 argument");
+        apexErr_runtime(vm, "math:min, expects at least 1 argument");
         return 1;
     }
     int numbers[argc];
@@ -858,7 +519,7 @@ int math_min(ApexVM *vm, int argc) {
             num = apexVal_dbl(value);
             break;
         default:
-            apexErr_runtime(vm, "math:max expects arguments to be int, flt or dbl");
+            apexErr_runtime(vm, "math:min expects arguments to be int, flt or dbl");
             return 1;
         }
         if (!min_set || num < min) {
@@ -887,23 +548,24 @@ int math_min(ApexVM *vm, int argc) {
 apex_reglib(math,
     apex_regvar("pi", math_pi),
     apex_regvar("huge", math_huge),
-    apex_regfn("random", math_random),
-    apex_regfn("abs", math_abs),
-    apex_regfn("fabs", math_fabs),
-    apex_regfn("cos", math_cos),
-    apex_regfn("cosh", math_cosh),
-    apex_regfn("acos", math_acos),
-    apex_regfn("sin", math_sin),
-    apex_regfn("asin", math_asin),
-    apex_regfn("tan", math_tan),
-    apex_regfn("atan", math_atan),
-    apex_regfn("atan2", math_atan2),
-    apex_regfn("ceil", math_ceil),
-    apex_regfn("floor", math_floor),
-    apex_regfn("exp", math_exp),
-    apex_regfn("fmod", math_fmod),
-    apex_regfn("frexp", math_frexp),
-    apex_regfn("ldexp", math_ldexp),
-    apex_regfn("modf", math_modf),
-    apex_regfn("max", math_max)
+    apex_regfnx("random", math_random, APEX_LIB_NOMUTATE),
+    apex_regfast("abs", math_abs, APEX_LIB_PURE, APEX_ARG(APEX_VAL_INT)),
+    apex_regfast("fabs", math_fabs, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("cos", math_cos, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("cosh", math_cosh, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("acos", math_acos, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("sin", math_sin, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("asin", math_asin, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("tan", math_tan, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("atan", math_atan, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("atan2", math_atan2, APEX_LIB_PURE, APEX_ARG_NUM, APEX_ARG_NUM),
+    apex_regfast("ceil", math_ceil, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("floor", math_floor, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("exp", math_exp, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("fmod", math_fmod, APEX_LIB_PURE, APEX_ARG_NUM, APEX_ARG_NUM),
+    apex_regfast("frexp", math_frexp, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfast("ldexp", math_ldexp, APEX_LIB_PURE, APEX_ARG_NUM, APEX_ARG(APEX_VAL_INT)),
+    apex_regfast("modf", math_modf, APEX_LIB_PURE, APEX_ARG_NUM),
+    apex_regfnx("max", math_max, APEX_LIB_PURE),
+    apex_regfnx("min", math_min, APEX_LIB_PURE)
 )
\ No newline at end of file
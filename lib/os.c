@@ -248,9 +248,9 @@ int os_date(ApexVM *vm, int argc) {
 }
 
 apex_reglib(os,
-    apex_regfn("exit", os_exit),
-    apex_regfn("remove", os_remove),
-    apex_regfn("rename", os_rename),
-    apex_regfn("time", os_time),
-    apex_regfn("date", os_date)
+    apex_regfnx("exit", os_exit, APEX_LIB_NOMUTATE),
+    apex_regfnx("remove", os_remove, APEX_LIB_NOMUTATE),
+    apex_regfnx("rename", os_rename, APEX_LIB_NOMUTATE),
+    apex_regfnx("time", os_time, APEX_LIB_NOMUTATE),
+    apex_regfnx("date", os_date, APEX_LIB_NOMUTATE)
 )
\ No newline at end of file
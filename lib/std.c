@@ -24,36 +24,33 @@
  * If the conversion is not possible, a runtime error is raised.
  *
  * @param vm A pointer to the virtual machine instance.
- * @param argc The number of arguments, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the converted value is stored.
  * @return Returns 0 on successful conversion, or 1 if an error occurs.
  */
-int std_int(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:int expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
+int std_int(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
     switch (apexVal_type(value)) {
     case APEX_VAL_BOOL:
-        apexVM_pushint(vm, apexVal_bool(value));
+        *result = apexVal_makeint(apexVal_bool(value));
         break;
 
     case APEX_VAL_INT:
-        apexVM_pushint(vm, apexVal_int(value));
+        *result = apexVal_makeint(apexVal_int(value));
         break;
 
     case APEX_VAL_FLT:
-        apexVM_pushint(vm, (int)apexVal_flt(value));
+        *result = apexVal_makeint((int)apexVal_flt(value));
         break;
 
     case APEX_VAL_DBL:
-        apexVM_pushint(vm, (int)apexVal_dbl(value));
+        *result = apexVal_makeint((int)apexVal_dbl(value));
         break;
 
     case APEX_VAL_STR: {
         int i;
         if (apexUtil_stoi(&i, apexVal_str(value)->value)) {
-            apexVM_pushint(vm, i);
+            *result = apexVal_makeint(i);
         } else {
             apexErr_runtime(vm, "cannot convert string \"%s\" to int", apexVal_str(value)->value);
             return 1;
@@ -76,17 +73,13 @@ int std_int(ApexVM *vm, int argc) {
  * If the value cannot be converted to a string, a runtime error is raised.
  *
  * @param vm A pointer to the virtual machine.
- * @param argc The number of arguments passed to the function.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return Returns 0 on success, or 1 if an error occurs.
  */
-int std_str(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:str expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
-    ApexString *str = apexVal_tostr(value);
-    apexVM_pushstr(vm, str);
+int std_str(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
+    *result = apexVal_makestr(apexVal_tostr(value));
     return 0;
 }
 
@@ -105,29 +98,26 @@ int std_str(ApexVM *vm, int argc) {
  * If the conversion is not possible, a runtime error is raised.
  *
  * @param vm A pointer to the virtual machine instance.
- * @param argc The number of arguments, expected to be 1.
+ * @param args The arguments of the call.
+ * @param result Where the converted value is stored.
  * @return Returns 0 on successful conversion, or 1 if an error occurs.
  */
-int std_flt(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:flt expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
+int std_flt(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
     switch (apexVal_type(value)) {
     case APEX_VAL_INT:
-        apexVM_pushflt(vm, (float)apexVal_int(value));
+        *result = apexVal_makeflt((float)apexVal_int(value));
         break;
     case APEX_VAL_FLT:
-        apexVM_pushval(vm, value);
+        *result = value;
         break;
     case APEX_VAL_DBL:
-        apexVM_pushflt(vm, (float)apexVal_dbl(value));
+        *result = apexVal_makeflt((float)apexVal_dbl(value));
         break;
     case APEX_VAL_STR: {
         float f;
         if (apexUtil_stof(&f, apexVal_str(value)->value)) {
-            apexVM_pushflt(vm, f);
+            *result = apexVal_makeflt(f);
         } else {
             apexErr_runtime(vm, "cannot convert string \"%s\" to flt", apexVal_str(value)->value);
             return 1;
@@ -135,7 +125,7 @@ int std_flt(ApexVM *vm, int argc) {
         break;
     }
    case APEX_VAL_BOOL:
-        apexVM_pushflt(vm, apexVal_bool(value));
+        *result = apexVal_makeflt(apexVal_bool(value));
         break;
 
     default:
@@ -156,29 +146,27 @@ int std_flt(ApexVM *vm, int argc) {
  *
  * All other values are considered true.
  *
- * @param value The value to convert to a double.
- * @return The double value of the given argument.
+ * @param vm A pointer to the virtual machine instance.
+ * @param args The arguments of the call.
+ * @param result Where the converted value is stored.
+ * @return Returns 0 on successful conversion, or 1 if an error occurs.
  */
-int std_dbl(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:dbl expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
+int std_dbl(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
     switch (apexVal_type(value)) {
     case APEX_VAL_INT:
-        apexVM_pushdbl(vm, (double)apexVal_int(value));
+        *result = apexVal_makedbl((double)apexVal_int(value));
         break;
     case APEX_VAL_FLT:
-        apexVM_pushdbl(vm, (double)apexVal_flt(value));
+        *result = apexVal_makedbl((double)apexVal_flt(value));
         break;
     case APEX_VAL_DBL:
-        apexVM_pushval(vm, value);
+        *result = value;
         break;
     case APEX_VAL_STR: {
         double d;
         if (apexUtil_stod(&d, apexVal_str(value)->value)) {
-            apexVM_pushdbl(vm, d);
+            *result = apexVal_makedbl(d);
         } else {
             apexErr_runtime(vm, "cannot convert string \"%s\" to dbl", apexVal_str(value)->value);
             return 1;
@@ -186,7 +174,7 @@ int std_dbl(ApexVM *vm, int argc) {
         break;
     }
    case APEX_VAL_BOOL:
-        apexVM_pushdbl(vm, apexVal_bool(value));
+        *result = apexVal_makedbl(apexVal_bool(value));
         break;
     default:
         apexErr_runtime(vm, "cannot convert %s to dbl", apexVal_typestr(value));
@@ -206,15 +194,13 @@ int std_dbl(ApexVM *vm, int argc) {
  *
  * All other values are considered true.
  *
- * @param value The value to convert to a boolean.
- * @return The boolean value of the given argument.
+ * @param vm A pointer to the virtual machine instance.
+ * @param args The arguments of the call.
+ * @param result Where the converted value is stored.
+ * @return Always returns 0.
  */
-int std_bool(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:bool expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
+int std_bool(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
     switch (apexVal_type(value)) {
     case APEX_VAL_INT:
     case APEX_VAL_FLT:
@@ -224,15 +210,16 @@ int std_bool(ApexVM *vm, int argc) {
     case APEX_VAL_ARR:
     case APEX_VAL_TYPE:
     case APEX_VAL_OBJ:
-        apexVM_pushbool(vm, true);
+    case APEX_VAL_TYPED:
+        *result = apexVal_makebool(true);
         break;
 
     case APEX_VAL_BOOL:
-        apexVM_pushval(vm, value);
+        *result = value;
         break;
 
     case APEX_VAL_NULL:
-        apexVM_pushbool(vm, false);
+        *result = apexVal_makebool(false);
         break;
     }
     return 0;
@@ -241,42 +228,38 @@ int std_bool(ApexVM *vm, int argc) {
 /**
  * Returns the length of the provided value.
  *
- * If the value is an array, this is the number of elements in the array.
+ * If the value is an array or a typed array, this is the number of elements
+ * in the array.
  * If the value is a string, this is the length of the string.
  *
- * If the value is of any other type, a runtime error is raised.
+ * The VM raises a runtime error if the value is of any other type.
  *
  * @param vm A pointer to the virtual machine.
- * @param argc The number of arguments passed to the function.
+ * @param args The arguments of the call.
+ * @param result Where the result is stored.
  * @return Returns 0 on success, or 1 if an error occurs.
  */
-static int std_len(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "std:len expects exactly 1 argument");
-        return 1;
-    }
-    ApexValue value = apexVM_pop(vm);
+static int std_len(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexValue value = args[0];
     switch (apexVal_type(value)) {
     case APEX_VAL_ARR:
-        apexVM_pushint(vm, value.arrval->entry_count);
-        break;
-
-    case APEX_VAL_STR:
-        apexVM_pushint(vm, apexVal_str(value)->len);
+    case APEX_VAL_TYPED:
+        *result = apexVal_makeint(apexVal_arrlen(value));
         break;
 
     default:
-        apexErr_runtime(vm, "cannot get length of %s", apexVal_typestr(value));
-        return 1;
+        *result = apexVal_makeint(apexVal_str(value)->len);
+        break;
     }
     return 0;
 }
 
 apex_reglib(std, 
-    apex_regfn("int", std_int),
-    apex_regfn("str", std_str),
-    apex_regfn("flt", std_flt),
-    apex_regfn("dbl", std_dbl),
-    apex_regfn("bool", std_bool),
-    apex_regfn("len", std_len)
+    apex_regfast("int", std_int, APEX_LIB_PURE, APEX_ARG_ANY),
+    apex_regfast("str", std_str, APEX_LIB_PURE, APEX_ARG_ANY),
+    apex_regfast("flt", std_flt, APEX_LIB_PURE, APEX_ARG_ANY),
+    apex_regfast("dbl", std_dbl, APEX_LIB_PURE, APEX_ARG_ANY),
+    apex_regfast("bool", std_bool, APEX_LIB_PURE, APEX_ARG_ANY),
+    apex_regfast("len", std_len, APEX_LIB_PURE,
+                 APEX_ARG(APEX_VAL_ARR) | APEX_ARG(APEX_VAL_TYPED) | APEX_ARG(APEX_VAL_STR))
 );
\ No newline at end of file
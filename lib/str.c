@@ -74,23 +74,9 @@ int str_split(ApexVM *vm, int argc) {
  * The regex pattern is not anchored to the start of the string, meaning that
  * it may match anywhere in the string.
  */
-int str_match(ApexVM *vm, int argc) {
-    // Retrieve arguments from the stack
-    ApexValue patternval = apexVM_pop(vm);
-    ApexValue strval = apexVM_pop(vm);
-
-    // Validate argument types
-    if (apexVal_type(strval) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s is not a string", apexVal_typestr(strval));
-        return 1;
-    }
-    if (apexVal_type(patternval) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s is not a string", apexVal_typestr(patternval));
-        return 1;
-    }
-
-    const char *str = apexVal_str(strval)->value;
-    const char *pattern = apexVal_str(patternval)->value;
+int str_match(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    const char *str = apexVal_str(args[0])->value;
+    const char *pattern = apexVal_str(args[1])->value;
 
     // Initialize regex
     regex_t regex;
@@ -104,7 +90,7 @@ int str_match(ApexVM *vm, int argc) {
     }
 
     // Create result array
-    ApexArray *result = apexVal_newarray();
+    ApexArray *matches = apexVal_newarray();
     size_t idx = 0;
 
     // Perform regex matching
@@ -124,7 +110,7 @@ int str_match(ApexVM *vm, int argc) {
 
         // Add to result array
         ApexString *match_str = apexStr_new(search_start + match_start, match_len);
-        apexVal_arrayset(result, apexVal_makeint(idx++), apexVal_makestr(match_str));
+        apexVal_arrayset(matches, apexVal_makeint(idx++), apexVal_makestr(match_str));
 
         // Move search_start to after the last match
         search_start += match_end;
@@ -132,8 +118,7 @@ int str_match(ApexVM *vm, int argc) {
 
     regfree(&regex);
 
-    // Push result array onto the VM stack
-    apexVM_pusharr(vm, result);
+    *result = apexVal_makearr(matches);
     return 0;
 }
 
@@ -143,45 +128,25 @@ int str_match(ApexVM *vm, int argc) {
  * This function takes a string, a regex pattern, and a replacement string as input.
  * It searches for occurrences of the pattern within the string and replaces each
  * occurrence with the provided replacement string. The resulting string with
- * substitutions is pushed onto the virtual machine's stack.
+ * substitutions is the result of the call.
  *
  * The first argument is the string to search.
  * The second argument is the regex pattern to match.
  * The third argument is the replacement string.
  *
- * If any of the arguments are not strings, an error is reported, and the function
- * returns immediately. If the regex pattern is invalid, an error is reported as well.
+ * The VM reports an error if any of the arguments are not strings. If the regex
+ * pattern is invalid, an error is reported as well.
  *
  * @param vm A pointer to the virtual machine instance.
- * @param argc The number of arguments passed to the function.
+ * @param args The arguments of the call.
+ * @param result Where the resulting string is stored.
  * @return 0 on success, or 1 if an error occurs.
  */
-int str_sub(ApexVM *vm, int argc) {
-    // Retrieve arguments from the stack
-    ApexValue repl_val = apexVM_pop(vm);
-    ApexValue ptrn_val = apexVM_pop(vm);
-    ApexValue str_val = apexVM_pop(vm);
-
-    // Validate argument types
-    if (apexVal_type(str_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s is not a string", apexVal_typestr(str_val));
-        return 1;
-    }
-
-    if (apexVal_type(ptrn_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s is not a string", apexVal_typestr(ptrn_val));
-        return 1;
-    }
-
-    if (apexVal_type(repl_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument %s is not a string", apexVal_typestr(repl_val));
-        return 1;
-    }
-
+int str_sub(ApexVM *vm, ApexValue *args, ApexValue *result) {
     // Extract C strings from ApexValue arguments
-    const char *str = apexVal_str(str_val)->value;
-    const char *ptrn = apexVal_str(ptrn_val)->value;
-    const char *repl = apexVal_str(repl_val)->value;
+    const char *str = apexVal_str(args[0])->value;
+    const char *ptrn = apexVal_str(args[1])->value;
+    const char *repl = apexVal_str(args[2])->value;
 
     // Compile the regex pattern
     regex_t regex;
@@ -192,7 +157,7 @@ int str_sub(ApexVM *vm, int argc) {
 
     size_t result_size = strlen(str) * 2;
     size_t result_len = 0;
-    char *result = apexMem_alloc(result_size);
+    char *buffer = apexMem_alloc(result_size);
     
 
     // Traverse the string and replace matches
@@ -204,18 +169,18 @@ int str_sub(ApexVM *vm, int argc) {
         size_t prefix_len = match.rm_so;
         if (result_len + prefix_len >= result_size) {
             result_size *= 2;
-            result = apexMem_realloc(result, result_size);
+            buffer = apexMem_realloc(buffer, result_size);
         }
-        strncpy(result + result_len, cursor, prefix_len);
+        strncpy(buffer + result_len, cursor, prefix_len);
         result_len += prefix_len;
 
         // Copy the replacement
         size_t repl_len = strlen(repl);
         if (result_len + repl_len >= result_size) {
             result_size *= 2;
-            result = apexMem_realloc(result, result_size);
+            buffer = apexMem_realloc(buffer, result_size);
         }
-        strncpy(result + result_len, repl, repl_len);
+        strncpy(buffer + result_len, repl, repl_len);
         result_len += repl_len;
 
         // Move the cursor forward
@@ -226,17 +191,16 @@ int str_sub(ApexVM *vm, int argc) {
     size_t remaining_len = strlen(cursor);
     if (result_len + remaining_len >= result_size) {
         result_size += remaining_len;
-        result = apexMem_realloc(result, result_size);
+        buffer = apexMem_realloc(buffer, result_size);
     }
-    strcpy(result + result_len, cursor);
+    strcpy(buffer + result_len, cursor);
     result_len += remaining_len;
 
     // Clean up regex resources
     regfree(&regex);
 
-    // Create the result string and push it onto the stack
-    ApexString *result_str = apexStr_save(result, result_len);
-    apexVM_pushstr(vm, result_str);
+    // Create the result string
+    *result = apexVal_makestr(apexStr_save(buffer, result_len));
 
     return 0;
 }
@@ -387,16 +351,10 @@ int str_format(ApexVM *vm, int argc) {
  * The result is a new string with the same length as the input, but with all
  * characters converted to lowercase.
  *
- * If the argument is not a string, an error is raised.
+ * If the argument is not a string, the VM raises an error.
  */
-int str_lower(ApexVM *vm, int argc) {
-    ApexValue str_val = apexVM_pop(vm);
-    if (apexVal_type(str_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument to 'str:lower' must be a string");
-        return 1;
-    }
-
-    ApexString *input_str = apexVal_str(str_val);
+int str_lower(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexString *input_str = apexVal_str(args[0]);
     size_t len = input_str->len;
 
     // Allocate memory for the result string
@@ -406,8 +364,7 @@ int str_lower(ApexVM *vm, int argc) {
     }
     lower_str[len] = '\0';
 
-    ApexString *result_str = apexStr_save(lower_str, len);
-    apexVM_pushstr(vm, result_str);
+    *result = apexVal_makestr(apexStr_save(lower_str, len));
     return 0;
 }
 
@@ -419,21 +376,10 @@ int str_lower(ApexVM *vm, int argc) {
  * The result is a new string with the same length as the input, but with all
  * characters converted to uppercase.
  *
- * If the argument is not a string, an error is raised.
+ * If the argument is not a string, the VM raises an error.
  */
-int str_upper(ApexVM *vm, int argc) {
-    if (argc != 1) {
-        apexErr_runtime(vm, "function 'str:upper' expects exactly 1 argument");
-        return 1;
-    }
-
-    ApexValue str_val = apexVM_pop(vm);
-    if (apexVal_type(str_val) != APEX_VAL_STR) {
-        apexErr_runtime(vm, "argument to 'str:upper' must be a string");
-        return 1;
-    }
-
-    ApexString *input_str = apexVal_str(str_val);
+int str_upper(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexString *input_str = apexVal_str(args[0]);
     size_t len = input_str->len;
 
     // Allocate memory for the result string
@@ -443,16 +389,15 @@ int str_upper(ApexVM *vm, int argc) {
     }
     upper_str[len] = '\0';
 
-    ApexString *result_str = apexStr_save(upper_str, len);
-    apexVM_pushstr(vm, result_str);
+    *result = apexVal_makestr(apexStr_save(upper_str, len));
     return 0;
 }
 
 apex_reglib(str,
-    apex_regfn("split", str_split),
-    apex_regfn("match", str_match),
-    apex_regfn("sub", str_sub),
-    apex_regfn("format", str_format),
-    apex_regfn("upper", str_upper),
-    apex_regfn("lower", str_lower)
+    apex_regfnx("split", str_split, APEX_LIB_PURE),
+    apex_regfast("match", str_match, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR), APEX_ARG(APEX_VAL_STR)),
+    apex_regfast("sub", str_sub, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR), APEX_ARG(APEX_VAL_STR), APEX_ARG(APEX_VAL_STR)),
+    apex_regfnx("format", str_format, APEX_LIB_PURE),
+    apex_regfast("upper", str_upper, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR)),
+    apex_regfast("lower", str_lower, APEX_LIB_PURE, APEX_ARG(APEX_VAL_STR))
 );
\ No newline at end of file
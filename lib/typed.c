@@ -0,0 +1,1193 @@
+#include <stdint.h>
+#include <limits.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#  define TYPED_AVX2
+#  define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#include "apexVM.h"
+#include "apexVal.h"
+#include "apexErr.h"
+#include "apexLib.h"
+
+/*
+ * Kernels
+ *
+ * Every kernel has a scalar implementation, an SSE2 fast path when the
+ * library is built for a target with SSE2, and an AVX2 version that is
+ * selected at runtime when the processor supports it. The vector loops
+ * process whole vectors and leave the remaining elements to the scalar
+ * loop. Kernels that find a minimum or maximum expect at least one element.
+ */
+
+#ifdef TYPED_AVX2
+/**
+ * Checks whether the processor supports AVX2. The result is computed once.
+ *
+ * @return true if AVX2 kernels can be used, otherwise false.
+ */
+static bool have_avx2(void) {
+    static int avx2 = -1;
+    if (avx2 < 0) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2;
+}
+
+AVX2_TARGET static double f64_sum_avx2(const double *x, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    double lanes[4];
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(x + i));
+    }
+    _mm256_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+AVX2_TARGET static double f64_min_avx2(const double *x, int n) {
+    double min = x[0];
+    int i = 0;
+    if (n >= 4) {
+        __m256d acc = _mm256_loadu_pd(x);
+        double lanes[4];
+        for (i = 4; i + 4 <= n; i += 4) {
+            acc = _mm256_min_pd(acc, _mm256_loadu_pd(x + i));
+        }
+        _mm256_storeu_pd(lanes, acc);
+        for (int j = 0; j < 4; j++) {
+            if (lanes[j] < min) {
+                min = lanes[j];
+            }
+        }
+    }
+    for (; i < n; i++) {
+        if (x[i] < min) {
+            min = x[i];
+        }
+    }
+    return min;
+}
+
+AVX2_TARGET static double f64_max_avx2(const double *x, int n) {
+    double max = x[0];
+    int i = 0;
+    if (n >= 4) {
+        __m256d acc = _mm256_loadu_pd(x);
+        double lanes[4];
+        for (i = 4; i + 4 <= n; i += 4) {
+            acc = _mm256_max_pd(acc, _mm256_loadu_pd(x + i));
+        }
+        _mm256_storeu_pd(lanes, acc);
+        for (int j = 0; j < 4; j++) {
+            if (lanes[j] > max) {
+                max = lanes[j];
+            }
+        }
+    }
+    for (; i < n; i++) {
+        if (x[i] > max) {
+            max = x[i];
+        }
+    }
+    return max;
+}
+
+AVX2_TARGET static double f64_dot_avx2(const double *x, const double *y, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    double lanes[4];
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d prod = _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        acc = _mm256_add_pd(acc, prod);
+    }
+    _mm256_storeu_pd(lanes, acc);
+    double dot = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) {
+        dot += x[i] * y[i];
+    }
+    return dot;
+}
+
+AVX2_TARGET static void f64_axpy_avx2(double a, const double *x, double *y, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d prod = _mm256_mul_pd(va, _mm256_loadu_pd(x + i));
+        _mm256_storeu_pd(y + i, _mm256_add_pd(prod, _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+AVX2_TARGET static void f64_scale_avx2(double *x, double a, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), va));
+    }
+    for (; i < n; i++) {
+        x[i] *= a;
+    }
+}
+
+AVX2_TARGET static void f64_add_avx2(double *z, const double *x, const double *y, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(z + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) {
+        z[i] = x[i] + y[i];
+    }
+}
+
+AVX2_TARGET static void f64_mul_avx2(double *z, const double *x, const double *y, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(z + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for (; i < n; i++) {
+        z[i] = x[i] * y[i];
+    }
+}
+
+AVX2_TARGET static int64_t i32_sum_avx2(const int32_t *x, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int64_t lanes[4];
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(v));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+AVX2_TARGET static int32_t i32_min_avx2(const int32_t *x, int n) {
+    int32_t min = x[0];
+    int i = 0;
+    if (n >= 8) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)x);
+        int32_t lanes[8];
+        for (i = 8; i + 8 <= n; i += 8) {
+            acc = _mm256_min_epi32(acc, _mm256_loadu_si256((const __m256i *)(x + i)));
+        }
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (int j = 0; j < 8; j++) {
+            if (lanes[j] < min) {
+                min = lanes[j];
+            }
+        }
+    }
+    for (; i < n; i++) {
+        if (x[i] < min) {
+            min = x[i];
+        }
+    }
+    return min;
+}
+
+AVX2_TARGET static int32_t i32_max_avx2(const int32_t *x, int n) {
+    int32_t max = x[0];
+    int i = 0;
+    if (n >= 8) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)x);
+        int32_t lanes[8];
+        for (i = 8; i + 8 <= n; i += 8) {
+            acc = _mm256_max_epi32(acc, _mm256_loadu_si256((const __m256i *)(x + i)));
+        }
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (int j = 0; j < 8; j++) {
+            if (lanes[j] > max) {
+                max = lanes[j];
+            }
+        }
+    }
+    for (; i < n; i++) {
+        if (x[i] > max) {
+            max = x[i];
+        }
+    }
+    return max;
+}
+
+AVX2_TARGET static void i32_add_avx2(int32_t *z, const int32_t *x, const int32_t *y, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+        _mm256_storeu_si256((__m256i *)(z + i), _mm256_add_epi32(vx, vy));
+    }
+    for (; i < n; i++) {
+        z[i] = (int32_t)((uint32_t)x[i] + (uint32_t)y[i]);
+    }
+}
+
+AVX2_TARGET static void i32_mul_avx2(int32_t *z, const int32_t *x, const int32_t *y, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+        _mm256_storeu_si256((__m256i *)(z + i), _mm256_mullo_epi32(vx, vy));
+    }
+    for (; i < n; i++) {
+        z[i] = (int32_t)((uint32_t)x[i] * (uint32_t)y[i]);
+    }
+}
+
+AVX2_TARGET static int64_t u8_sum_avx2(const uint8_t *x, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    __m256i zero = _mm256_setzero_si256();
+    int64_t lanes[4];
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(x + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+AVX2_TARGET static void u8_add_avx2(uint8_t *z, const uint8_t *x, const uint8_t *y, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+        _mm256_storeu_si256((__m256i *)(z + i), _mm256_add_epi8(vx, vy));
+    }
+    for (; i < n; i++) {
+        z[i] = (uint8_t)(x[i] + y[i]);
+    }
+}
+#endif
+
+/**
+ * Returns the sum of the elements of an f64 array.
+ */
+static double f64_sum(const double *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return f64_sum_avx2(x, n);
+    }
+#endif
+    double sum = 0;
+    int i = 0;
+#ifdef __SSE2__
+    __m128d acc = _mm_setzero_pd();
+    double lanes[2];
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_pd(acc, _mm_loadu_pd(x + i));
+    }
+    _mm_storeu_pd(lanes, acc);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+/**
+ * Returns the smallest element of an f64 array.
+ */
+static double f64_min(const double *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return f64_min_avx2(x, n);
+    }
+#endif
+    double min = x[0];
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 2) {
+        __m128d acc = _mm_loadu_pd(x);
+        double lanes[2];
+        for (i = 2; i + 2 <= n; i += 2) {
+            acc = _mm_min_pd(acc, _mm_loadu_pd(x + i));
+        }
+        _mm_storeu_pd(lanes, acc);
+        min = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; i < n; i++) {
+        if (x[i] < min) {
+            min = x[i];
+        }
+    }
+    return min;
+}
+
+/**
+ * Returns the largest element of an f64 array.
+ */
+static double f64_max(const double *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return f64_max_avx2(x, n);
+    }
+#endif
+    double max = x[0];
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 2) {
+        __m128d acc = _mm_loadu_pd(x);
+        double lanes[2];
+        for (i = 2; i + 2 <= n; i += 2) {
+            acc = _mm_max_pd(acc, _mm_loadu_pd(x + i));
+        }
+        _mm_storeu_pd(lanes, acc);
+        max = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    for (; i < n; i++) {
+        if (x[i] > max) {
+            max = x[i];
+        }
+    }
+    return max;
+}
+
+/**
+ * Returns the dot product of two f64 arrays.
+ */
+static double f64_dot(const double *x, const double *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return f64_dot_avx2(x, y, n);
+    }
+#endif
+    double dot = 0;
+    int i = 0;
+#ifdef __SSE2__
+    __m128d acc = _mm_setzero_pd();
+    double lanes[2];
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    }
+    _mm_storeu_pd(lanes, acc);
+    dot = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        dot += x[i] * y[i];
+    }
+    return dot;
+}
+
+/**
+ * Computes y = a * x + y for f64 arrays.
+ */
+static void f64_axpy(double a, const double *x, double *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        f64_axpy_avx2(a, x, y, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    __m128d va = _mm_set1_pd(a);
+    for (; i + 2 <= n; i += 2) {
+        __m128d prod = _mm_mul_pd(va, _mm_loadu_pd(x + i));
+        _mm_storeu_pd(y + i, _mm_add_pd(prod, _mm_loadu_pd(y + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+/**
+ * Multiplies every element of an f64 array by a.
+ */
+static void f64_scale(double *x, double a, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        f64_scale_avx2(x, a, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    __m128d va = _mm_set1_pd(a);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(x + i, _mm_mul_pd(_mm_loadu_pd(x + i), va));
+    }
+#endif
+    for (; i < n; i++) {
+        x[i] *= a;
+    }
+}
+
+/**
+ * Computes z = x + y element-wise for f64 arrays.
+ */
+static void f64_add(double *z, const double *x, const double *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        f64_add_avx2(z, x, y, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(z + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        z[i] = x[i] + y[i];
+    }
+}
+
+/**
+ * Computes z = x * y element-wise for f64 arrays.
+ */
+static void f64_mul(double *z, const double *x, const double *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        f64_mul_avx2(z, x, y, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(z + i, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        z[i] = x[i] * y[i];
+    }
+}
+
+/**
+ * Returns the sum of the elements of an i32 array, without overflow.
+ */
+static int64_t i32_sum(const int32_t *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return i32_sum_avx2(x, n);
+    }
+#endif
+    int64_t sum = 0;
+    int i = 0;
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    int64_t lanes[2];
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+    }
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+/**
+ * Returns the smallest element of an i32 array.
+ */
+static int32_t i32_min(const int32_t *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return i32_min_avx2(x, n);
+    }
+#endif
+    int32_t min = x[0];
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 4) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)x);
+        int32_t lanes[4];
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+            __m128i gt = _mm_cmpgt_epi32(acc, v);
+            acc = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, acc));
+        }
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        for (int j = 0; j < 4; j++) {
+            if (lanes[j] < min) {
+                min = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (x[i] < min) {
+            min = x[i];
+        }
+    }
+    return min;
+}
+
+/**
+ * Returns the largest element of an i32 array.
+ */
+static int32_t i32_max(const int32_t *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return i32_max_avx2(x, n);
+    }
+#endif
+    int32_t max = x[0];
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 4) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)x);
+        int32_t lanes[4];
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+            __m128i gt = _mm_cmpgt_epi32(v, acc);
+            acc = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, acc));
+        }
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        for (int j = 0; j < 4; j++) {
+            if (lanes[j] > max) {
+                max = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (x[i] > max) {
+            max = x[i];
+        }
+    }
+    return max;
+}
+
+/**
+ * Computes z = x + y element-wise for i32 arrays, wrapping on overflow.
+ */
+static void i32_add(int32_t *z, const int32_t *x, const int32_t *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        i32_add_avx2(z, x, y, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= n; i += 4) {
+        __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+        _mm_storeu_si128((__m128i *)(z + i), _mm_add_epi32(vx, vy));
+    }
+#endif
+    for (; i < n; i++) {
+        z[i] = (int32_t)((uint32_t)x[i] + (uint32_t)y[i]);
+    }
+}
+
+/**
+ * Computes z = x * y element-wise for i32 arrays, wrapping on overflow.
+ *
+ * SSE2 has no 32-bit multiply that keeps the low halves, so only the AVX2
+ * version is vectorised.
+ */
+static void i32_mul(int32_t *z, const int32_t *x, const int32_t *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        i32_mul_avx2(z, x, y, n);
+        return;
+    }
+#endif
+    for (int i = 0; i < n; i++) {
+        z[i] = (int32_t)((uint32_t)x[i] * (uint32_t)y[i]);
+    }
+}
+
+/**
+ * Returns the sum of the elements of a u8 array.
+ */
+static int64_t u8_sum(const uint8_t *x, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        return u8_sum_avx2(x, n);
+    }
+#endif
+    int64_t sum = 0;
+    int i = 0;
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    __m128i zero = _mm_setzero_si128();
+    int64_t lanes[2];
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    }
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+/**
+ * Returns the smallest or largest element of a u8 array.
+ */
+static uint8_t u8_extreme(const uint8_t *x, int n, bool is_max) {
+    uint8_t result = x[0];
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 16) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)x);
+        uint8_t lanes[16];
+        for (i = 16; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(x + i));
+            acc = is_max ? _mm_max_epu8(acc, v) : _mm_min_epu8(acc, v);
+        }
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        for (int j = 0; j < 16; j++) {
+            if (is_max ? lanes[j] > result : lanes[j] < result) {
+                result = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (is_max ? x[i] > result : x[i] < result) {
+            result = x[i];
+        }
+    }
+    return result;
+}
+
+/**
+ * Computes z = x + y element-wise for u8 arrays, wrapping on overflow.
+ */
+static void u8_add(uint8_t *z, const uint8_t *x, const uint8_t *y, int n) {
+#ifdef TYPED_AVX2
+    if (have_avx2()) {
+        u8_add_avx2(z, x, y, n);
+        return;
+    }
+#endif
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+        _mm_storeu_si128((__m128i *)(z + i), _mm_add_epi8(vx, vy));
+    }
+#endif
+    for (; i < n; i++) {
+        z[i] = (uint8_t)(x[i] + y[i]);
+    }
+}
+
+/*
+ * Scalar element access for the integer element types that have no
+ * dedicated kernel.
+ */
+
+/**
+ * Returns an element of an integer typed array as a 64-bit integer.
+ */
+static int64_t get_int(const ApexTypedArray *typed, int i) {
+    switch (typed->kind) {
+    case APEX_TYPED_I32:
+        return ((const int32_t *)typed->data)[i];
+    case APEX_TYPED_I64:
+        return ((const int64_t *)typed->data)[i];
+    case APEX_TYPED_U8:
+        return ((const uint8_t *)typed->data)[i];
+    case APEX_TYPED_F64:
+        return (int64_t)((const double *)typed->data)[i];
+    }
+    return 0;
+}
+
+/**
+ * Stores a 64-bit integer in an element of an integer typed array,
+ * wrapping it to the element type.
+ */
+static void set_int(ApexTypedArray *typed, int i, int64_t value) {
+    switch (typed->kind) {
+    case APEX_TYPED_I32:
+        ((int32_t *)typed->data)[i] = (int32_t)(uint32_t)value;
+        break;
+    case APEX_TYPED_I64:
+        ((int64_t *)typed->data)[i] = value;
+        break;
+    case APEX_TYPED_U8:
+        ((uint8_t *)typed->data)[i] = (uint8_t)value;
+        break;
+    case APEX_TYPED_F64:
+        ((double *)typed->data)[i] = (double)value;
+        break;
+    }
+}
+
+/**
+ * Makes a value of a 64-bit integer, an integer if it fits and a double
+ * otherwise.
+ */
+static ApexValue make_int64(int64_t value) {
+    if (value >= INT_MIN && value <= INT_MAX) {
+        return apexVal_makeint((int)value);
+    }
+    return apexVal_makedbl((double)value);
+}
+
+/**
+ * Pops a typed array off the stack, raising an error if the value is not
+ * a typed array.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param fn The name of the library function, for error messages.
+ * @param typed A pointer that receives the typed array.
+ * @return true on success, false on error.
+ */
+static bool pop_typed(ApexVM *vm, const char *fn, ApexTypedArray **typed) {
+    ApexValue value = apexVM_pop(vm);
+    if (apexVal_type(value) != APEX_VAL_TYPED) {
+        apexErr_runtime(vm, "%s expects a typed array, got %s", fn, apexVal_typestr(value));
+        return false;
+    }
+    *typed = apexVal_typed(value);
+    return true;
+}
+
+/**
+ * Pops a number off the stack, raising an error if the value is not a
+ * number.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param fn The name of the library function, for error messages.
+ * @param num A pointer that receives the number.
+ * @return true on success, false on error.
+ */
+static bool pop_number(ApexVM *vm, const char *fn, double *num) {
+    ApexValue value = apexVM_pop(vm);
+    switch (apexVal_type(value)) {
+    case APEX_VAL_INT:
+        *num = apexVal_int(value);
+        return true;
+    case APEX_VAL_FLT:
+        *num = apexVal_flt(value);
+        return true;
+    case APEX_VAL_DBL:
+        *num = apexVal_dbl(value);
+        return true;
+    default:
+        apexErr_runtime(vm, "%s expects a number, got %s", fn, apexVal_typestr(value));
+        return false;
+    }
+}
+
+/**
+ * Checks that two typed arrays have the same element type and length.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param fn The name of the library function, for error messages.
+ * @return true if the arrays match, otherwise false.
+ */
+static bool check_pair(ApexVM *vm, const char *fn, ApexTypedArray *x, ApexTypedArray *y) {
+    if (x->kind != y->kind) {
+        apexErr_runtime(vm, "%s expects arrays of the same type, got %s and %s", fn,
+            apexVal_typedkindstr(x->kind), apexVal_typedkindstr(y->kind));
+        return false;
+    }
+    if (x->length != y->length) {
+        apexErr_runtime(vm, "%s expects arrays of the same length, got %d and %d", fn,
+            x->length, y->length);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Creates a typed array of the given element type.
+ *
+ * The single argument is either the number of elements, which are all
+ * initialized to zero, or an array whose values are converted to the
+ * element type in iteration order.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the typed array is stored.
+ * @param kind The element type.
+ * @param fn The name of the library function, for error messages.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+static int typed_create(ApexVM *vm, ApexValue *args, ApexValue *result,
+                        ApexTypedKind kind, const char *fn) {
+    ApexValue arg = args[0];
+    ApexTypedArray *typed;
+
+    if (apexVal_type(arg) == APEX_VAL_INT) {
+        if (apexVal_int(arg) < 0) {
+            apexErr_runtime(vm, "%s length must not be negative", fn);
+            return 1;
+        }
+        typed = apexVal_newtyped(kind, apexVal_int(arg));
+    } else {
+        ApexValue key, value;
+        int i = 0;
+        typed = apexVal_newtyped(kind, apexVal_arrlen(arg));
+        apexArray_each(apexVal_array(arg), key, value) {
+            if (!apexVal_typedset(typed, i++, value)) {
+                apexErr_runtime(vm, "cannot store %s in a typed array", apexVal_typestr(value));
+                apexVal_freetyped(typed);
+                return 1;
+            }
+        }
+    }
+    *result = apexVal_maketyped(typed);
+    return 0;
+}
+
+/**
+ * Creates an i32 typed array. See typed_create.
+ */
+int typed_i32(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_create(vm, args, result, APEX_TYPED_I32, "typed:i32");
+}
+
+/**
+ * Creates an i64 typed array. See typed_create.
+ */
+int typed_i64(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_create(vm, args, result, APEX_TYPED_I64, "typed:i64");
+}
+
+/**
+ * Creates an f64 typed array. See typed_create.
+ */
+int typed_f64(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_create(vm, args, result, APEX_TYPED_F64, "typed:f64");
+}
+
+/**
+ * Creates a u8 typed array. See typed_create.
+ */
+int typed_u8(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_create(vm, args, result, APEX_TYPED_U8, "typed:u8");
+}
+
+/**
+ * Returns the sum of the elements of a typed array.
+ *
+ * The sum of an f64 array is a double. The sum of an integer array is
+ * computed without overflow and returned as an integer if it fits.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the sum is stored.
+ * @return Always returns 0.
+ */
+int typed_sum(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexTypedArray *x = apexVal_typed(args[0]);
+
+    switch (x->kind) {
+    case APEX_TYPED_F64:
+        *result = apexVal_makedbl(f64_sum(x->data, x->length));
+        break;
+    case APEX_TYPED_I32:
+        *result = make_int64(i32_sum(x->data, x->length));
+        break;
+    case APEX_TYPED_U8:
+        *result = make_int64(u8_sum(x->data, x->length));
+        break;
+    case APEX_TYPED_I64: {
+        int64_t sum = 0;
+        for (int i = 0; i < x->length; i++) {
+            sum += get_int(x, i);
+        }
+        *result = make_int64(sum);
+        break;
+    }
+    }
+    return 0;
+}
+
+/**
+ * Returns the smallest or largest element of a typed array.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the element is stored.
+ * @param is_max Whether to return the largest element.
+ * @param fn The name of the library function, for error messages.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+static int typed_extreme(ApexVM *vm, ApexValue *args, ApexValue *result,
+                         bool is_max, const char *fn) {
+    ApexTypedArray *x = apexVal_typed(args[0]);
+    if (x->length == 0) {
+        apexErr_runtime(vm, "%s of an empty array", fn);
+        return 1;
+    }
+
+    switch (x->kind) {
+    case APEX_TYPED_F64:
+        *result = apexVal_makedbl(is_max ? f64_max(x->data, x->length) : f64_min(x->data, x->length));
+        break;
+    case APEX_TYPED_I32:
+        *result = apexVal_makeint(is_max ? i32_max(x->data, x->length) : i32_min(x->data, x->length));
+        break;
+    case APEX_TYPED_U8:
+        *result = apexVal_makeint(u8_extreme(x->data, x->length, is_max));
+        break;
+    case APEX_TYPED_I64: {
+        int64_t extreme = get_int(x, 0);
+        for (int i = 1; i < x->length; i++) {
+            int64_t value = get_int(x, i);
+            if (is_max ? value > extreme : value < extreme) {
+                extreme = value;
+            }
+        }
+        *result = make_int64(extreme);
+        break;
+    }
+    }
+    return 0;
+}
+
+/**
+ * Returns the smallest element of a typed array. See typed_extreme.
+ */
+int typed_min(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_extreme(vm, args, result, false, "typed:min");
+}
+
+/**
+ * Returns the largest element of a typed array. See typed_extreme.
+ */
+int typed_max(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_extreme(vm, args, result, true, "typed:max");
+}
+
+/**
+ * Returns the dot product of two typed arrays of the same type and length.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the dot product is stored.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+int typed_dot(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexTypedArray *x = apexVal_typed(args[0]);
+    ApexTypedArray *y = apexVal_typed(args[1]);
+    if (!check_pair(vm, "typed:dot", x, y)) {
+        return 1;
+    }
+
+    if (x->kind == APEX_TYPED_F64) {
+        *result = apexVal_makedbl(f64_dot(x->data, y->data, x->length));
+    } else {
+        int64_t dot = 0;
+        for (int i = 0; i < x->length; i++) {
+            dot += get_int(x, i) * get_int(y, i);
+        }
+        *result = make_int64(dot);
+    }
+    return 0;
+}
+
+/**
+ * Computes y = alpha * x + y in place.
+ *
+ * The arguments are the number alpha and two typed arrays of the same type
+ * and length. For integer arrays, each product is truncated before it is
+ * added.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param argc The number of arguments passed to the function.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+int typed_axpy(ApexVM *vm, int argc) {
+    ApexTypedArray *x, *y;
+    double alpha;
+    if (argc != 3) {
+        apexErr_runtime(vm, "typed:axpy expects exactly 3 arguments");
+        return 1;
+    }
+    if (!pop_typed(vm, "typed:axpy", &y) || !pop_typed(vm, "typed:axpy", &x) ||
+        !pop_number(vm, "typed:axpy", &alpha) || !check_pair(vm, "typed:axpy", x, y)) {
+        return 1;
+    }
+
+    if (x->kind == APEX_TYPED_F64) {
+        f64_axpy(alpha, x->data, y->data, x->length);
+    } else {
+        for (int i = 0; i < x->length; i++) {
+            set_int(y, i, get_int(y, i) + (int64_t)(alpha * get_int(x, i)));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Multiplies every element of a typed array by a number in place.
+ *
+ * For integer arrays, each product is truncated.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param argc The number of arguments passed to the function.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+int typed_scale(ApexVM *vm, int argc) {
+    ApexTypedArray *x;
+    double factor;
+    if (argc != 2) {
+        apexErr_runtime(vm, "typed:scale expects exactly 2 arguments");
+        return 1;
+    }
+    if (!pop_number(vm, "typed:scale", &factor) || !pop_typed(vm, "typed:scale", &x)) {
+        return 1;
+    }
+
+    if (x->kind == APEX_TYPED_F64) {
+        f64_scale(x->data, factor, x->length);
+    } else {
+        for (int i = 0; i < x->length; i++) {
+            set_int(x, i, (int64_t)(factor * get_int(x, i)));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Combines two typed arrays element-wise into a new typed array.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the new typed array is stored.
+ * @param is_mul Whether to multiply rather than add the elements.
+ * @param fn The name of the library function, for error messages.
+ * @return Returns 0 on success, or 1 if an error occurs.
+ */
+static int typed_elementwise(ApexVM *vm, ApexValue *args, ApexValue *result,
+                             bool is_mul, const char *fn) {
+    ApexTypedArray *x = apexVal_typed(args[0]);
+    ApexTypedArray *y = apexVal_typed(args[1]);
+    if (!check_pair(vm, fn, x, y)) {
+        return 1;
+    }
+
+    ApexTypedArray *z = apexVal_newtyped(x->kind, x->length);
+    int n = x->length;
+    switch (x->kind) {
+    case APEX_TYPED_F64:
+        if (is_mul) {
+            f64_mul(z->data, x->data, y->data, n);
+        } else {
+            f64_add(z->data, x->data, y->data, n);
+        }
+        break;
+    case APEX_TYPED_I32:
+        if (is_mul) {
+            i32_mul(z->data, x->data, y->data, n);
+        } else {
+            i32_add(z->data, x->data, y->data, n);
+        }
+        break;
+    case APEX_TYPED_U8:
+        if (!is_mul) {
+            u8_add(z->data, x->data, y->data, n);
+            break;
+        }
+        /* fallthrough */
+    case APEX_TYPED_I64:
+        for (int i = 0; i < n; i++) {
+            uint64_t a = (uint64_t)get_int(x, i);
+            uint64_t b = (uint64_t)get_int(y, i);
+            set_int(z, i, (int64_t)(is_mul ? a * b : a + b));
+        }
+        break;
+    }
+    *result = apexVal_maketyped(z);
+    return 0;
+}
+
+/**
+ * Returns the element-wise sum of two typed arrays. See typed_elementwise.
+ */
+int typed_add(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_elementwise(vm, args, result, false, "typed:add");
+}
+
+/**
+ * Returns the element-wise product of two typed arrays. See
+ * typed_elementwise.
+ */
+int typed_mul(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    return typed_elementwise(vm, args, result, true, "typed:mul");
+}
+
+/**
+ * Returns a new typed array holding the prefix sums of a typed array.
+ *
+ * Each element of the result is the sum of the elements of the input up to
+ * and including the same index. Every element depends on the previous one,
+ * so this kernel is scalar.
+ *
+ * @param vm A pointer to the virtual machine.
+ * @param args The arguments of the call.
+ * @param result Where the new typed array is stored.
+ * @return Always returns 0.
+ */
+int typed_cumsum(ApexVM *vm, ApexValue *args, ApexValue *result) {
+    ApexTypedArray *x = apexVal_typed(args[0]);
+
+    ApexTypedArray *z = apexVal_newtyped(x->kind, x->length);
+    if (x->kind == APEX_TYPED_F64) {
+        const double *src = x->data;
+        double *dst = z->data;
+        double sum = 0;
+        for (int i = 0; i < x->length; i++) {
+            sum += src[i];
+            dst[i] = sum;
+        }
+    } else {
+        uint64_t sum = 0;
+        for (int i = 0; i < x->length; i++) {
+            sum += (uint64_t)get_int(x, i);
+            set_int(z, i, (int64_t)sum);
+        }
+    }
+    *result = apexVal_maketyped(z);
+    return 0;
+}
+
+apex_reglib(typed,
+    apex_regfast("i32", typed_i32, APEX_LIB_PURE, APEX_ARG(APEX_VAL_INT) | APEX_ARG(APEX_VAL_ARR)),
+    apex_regfast("i64", typed_i64, APEX_LIB_PURE, APEX_ARG(APEX_VAL_INT) | APEX_ARG(APEX_VAL_ARR)),
+    apex_regfast("f64", typed_f64, APEX_LIB_PURE, APEX_ARG(APEX_VAL_INT) | APEX_ARG(APEX_VAL_ARR)),
+    apex_regfast("u8", typed_u8, APEX_LIB_PURE, APEX_ARG(APEX_VAL_INT) | APEX_ARG(APEX_VAL_ARR)),
+    apex_regfast("sum", typed_sum, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfast("min", typed_min, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfast("max", typed_max, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfast("dot", typed_dot, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED), APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfn("axpy", typed_axpy),
+    apex_regfn("scale", typed_scale),
+    apex_regfast("add", typed_add, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED), APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfast("mul", typed_mul, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED), APEX_ARG(APEX_VAL_TYPED)),
+    apex_regfast("cumsum", typed_cumsum, APEX_LIB_PURE, APEX_ARG(APEX_VAL_TYPED))
+)
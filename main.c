@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <termios.h>
 #include "apexLex.h"
 #include "apexStr.h"
@@ -11,6 +12,9 @@
 #include "apexVal.h"
 #include "apexCode.h"
 #include "apexLib.h"
+#include "apexCache.h"
+#include "apexLoad.h"
+#include "apexType.h"
 
 #define INPUT_BUFFER_SIZE 1024
 #define HISTORY_INIT_SIZE 32
@@ -23,10 +27,12 @@ static struct termios old_termios;
 static struct termios new_termios;
 
 static void init_terminal() {
+    int saved_errno = errno;
     tcgetattr(0, &old_termios);
     new_termios = old_termios;
     new_termios.c_lflag &= ~(ICANON | ECHO);
     tcsetattr(0, TCSANOW, &new_termios);    
+    errno = saved_errno; // input may not be a terminal
 }
 
 static void reset_terminal() {
@@ -66,7 +72,7 @@ void redraw_prompt(const char *input, const char *prompt) {
     fflush(stdout);
 }
 
-static void read_line(char *input, size_t size, bool is_incomplete) {
+static bool read_line(char *input, size_t size, bool is_incomplete) {
     size_t pos = 0;
     int c;
     memset(input, 0, size);
@@ -74,7 +80,10 @@ static void read_line(char *input, size_t size, bool is_incomplete) {
     for (;;) {
         c = getchar();
 
-        if (c == '\n') {
+        if (c == EOF || (c == 4 && pos == 0)) { // End of input or Ctrl-D
+            putchar('\n');
+            return false;
+        } else if (c == '\n') {
             putchar('\n');
             input[pos] = '\0';
             if (pos > 0) {
@@ -82,7 +91,7 @@ static void read_line(char *input, size_t size, bool is_incomplete) {
             }
             input[pos] = '\n';
             history_index = history_count; // Reset index after enter
-            return;
+            return true;
         } else if (c == 127) { // Backspace
             if (pos > 0) {
                 pos--;
@@ -123,23 +132,11 @@ static void print_usage(void) {
     printf("Usage: apex [file]\n");
 }
 
-static char *read_file(const char *path) {
-    FILE *file = fopen(path, "rb");
-
-    if (!file) {
+static void read_file(ApexSource *source, const char *path) {
+    if (!apexLoad_open(source, path)) {
         fprintf(stderr, "failed to open file: %s\n", path);
         exit(EXIT_FAILURE);
     }
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    rewind(file);
-
-    char *buffer = apexMem_alloc(size + 1);
-    fread(buffer, 1, size, file);
-    fclose(file);
-    buffer[size] = '\0';
-    
-    return buffer;
 }
 
 void start_repl(void) {
@@ -150,10 +147,13 @@ void start_repl(void) {
 
     apexStr_inittable();
     apexLib_init();
-    init_lexer(&lexer, NULL, NULL);
+    init_lexer(&lexer, NULL, NULL, 0);
 
     ApexVM vm;
     init_vm(&vm);
+    ApexArena arena;
+    apexMem_arenainit(&arena, NULL);
+    vm.arena = &arena;
     int lexer_pos = 0;
     bool retain_lexer_pos = false;
 
@@ -161,8 +161,15 @@ void start_repl(void) {
     init_history();
 
     printf("> ");
-    for(;;) {
-        read_line(input, sizeof(input), is_incomplete);
+    while (read_line(input, sizeof(input), is_incomplete)) {
+        // :reset discards every definition made so far.
+        if (!is_incomplete && strcmp(input, ":reset\n") == 0) {
+            apexVM_reset(&vm);
+            free((char *)lexer.source);
+            init_lexer(&lexer, NULL, NULL, 0);
+            printf("> ");
+            continue;
+        }
         apexLex_feedline(&lexer, input);
         
         if (!retain_lexer_pos) {
@@ -170,7 +177,7 @@ void start_repl(void) {
         } else {
             lexer.position = lexer_pos;
         }
-        init_parser(&parser, &lexer);
+        init_parser(&parser, &lexer, &arena);
         parser.allow_incomplete = true;
 
         AST *program = parse_program(&parser);
@@ -180,55 +187,92 @@ void start_repl(void) {
         if (program) {
             is_incomplete = false;
             retain_lexer_pos = false;
-            if (program->type != AST_ERROR) {
-                apexCode_compile(&vm, program);
+            // Each entry is appended to the code of the earlier ones, so
+            // their functions stay defined.
+            if (program->type != AST_ERROR && apexCode_compileentry(&vm, program)) {
                 #ifdef DEBUG
                 print_vm_instructions(&vm);
                 #endif
-                vm_dispatch(&vm);
+                if (!vm_dispatch(&vm)) {
+                    apexVM_unwind(&vm);
+                }
             }
-            free_ast(program);
-            apexVM_reset(&vm);
             printf("> ");
         } else {
             is_incomplete = true;
             retain_lexer_pos = true;
             printf("... "); // Incomplete input; wait for more
         }
+        apexMem_arenafree(&arena);
 
     }
     reset_terminal();
+    free((char *)lexer.source);
     free_vm(&vm);
+    apexVal_freeshapes();
     apexStr_freetable();
+    apexMem_freepools();
     free_history();
 }
 
-static void cleanup(ApexVM *vm, AST *ast, Parser *parser, char *source) {
+/**
+ * Lexes, parses and compiles a script into the virtual machine.
+ *
+ * @param vm The virtual machine to compile the script into.
+ * @param path The path of the script.
+ * @param source The source code of the script.
+ * @return true if the script was compiled, false otherwise.
+ */
+static bool compile_script(ApexVM *vm, const char *path, ApexSource *source) {
+    Lexer lexer;
+    init_lexer(&lexer, path, source->text, source->length);
+
+    Parser parser;
+    init_parser(&parser, &lexer, vm->arena);
+    parser.allow_incomplete = false;
+
+    AST *ast = parse_program(&parser);
+    if (!ast) {
+        return false;
+    }
+    #ifdef DEBUG
+    print_ast(ast, 0);
+    #endif
+
+    // Included files are parsed on worker threads while the program is
+    // compiled; the compiler takes their ASTs from the loader.
+    ApexLoader loader;
+    apexLoad_init(&loader);
+    apexLoad_start(&loader, ast);
+    vm->loader = &loader;
+    bool ok = apexCode_compile(vm, ast);
+    vm->loader = NULL;
+    apexLoad_free(&loader);
+    return ok;
+}
+
+static void cleanup(ApexVM *vm, ApexArena *arena) {
     free_vm(vm);    
-    free_ast(ast);
-    free_parser(parser);
+    apexMem_arenafree(arena);
     apexLib_free();
+    apexVal_freeshapes();
     apexStr_freetable();
-    free(source);
+    apexMem_freepools();
 }
 
 int main(int argc, char *argv[]) {
     if (argc == 1) {
         start_repl();
     } else if (argc >= 2) {
-        char *source = read_file(argv[1]);
         apexStr_inittable();
         apexLib_init();
 
-        Lexer lexer;
-        init_lexer(&lexer, argv[1], source);
-
-        Parser parser;
-        init_parser(&parser, &lexer);
-        parser.allow_incomplete = false;
+        ApexArena arena;
+        apexMem_arenainit(&arena, NULL);
 
         ApexVM vm;
         init_vm(&vm);
+        vm.arena = &arena;
 
         ApexArray *args = apexVal_newarray();
         int argi = 0;
@@ -242,27 +286,37 @@ int main(int argc, char *argv[]) {
             &vm.global_table, 
             apexStr_new("@args", 5)->value, 
             apexVal_makearr(args));
-        
-        AST *ast = parse_program(&parser);    
-        if (!ast) {
-            cleanup(&vm, ast, &parser, source);
-            return EXIT_FAILURE;
-        }
-        #ifdef DEBUG
-        print_ast(ast, 0);
-        #endif
-        if (!apexCode_compile(&vm, ast)) {
-            cleanup(&vm, ast, &parser, source);
-            return EXIT_FAILURE;
+
+        // Run the cached compiled program if it is up to date, otherwise
+        // compile the script and cache the result for the next run.
+        char *cache_path = apexCache_path(argv[1]);
+        if (!cache_path || !apexCache_load(&vm, cache_path)) {
+            // The source is only needed until the script is compiled.
+            ApexSource source;
+            read_file(&source, argv[1]);
+            apexCode_addmodule(&vm, argv[1]);
+            bool ok = compile_script(&vm, argv[1], &source);
+            apexLoad_close(&source);
+            if (!ok) {
+                free(cache_path);
+                cleanup(&vm, &arena);
+                return EXIT_FAILURE;
+            }
+            if (cache_path) {
+                apexCache_save(&vm, cache_path);
+            }
         }
+        free(cache_path);
+        apexMem_arenafree(&arena);
+        apexType_report(vm.chunk);
         #ifdef DEBUG
         print_vm_instructions(&vm);
         #endif
         if (!vm_dispatch(&vm)) {
-            cleanup(&vm, ast, &parser, source);
+            cleanup(&vm, &arena);
             return EXIT_FAILURE;
         }
-        cleanup(&vm, ast, &parser, source);
+        cleanup(&vm, &arena);
     } else {
         print_usage();
         return EXIT_FAILURE;